@@ -0,0 +1,158 @@
+#include "BindlessTextures.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+
+//upper bound of the layout, the variable count lets every set allocate only what it needs below it
+static const uint32_t BINDLESS_MAX_TEXTURES = 1u << 16;
+
+bool BindlessTextures::isSupported(const VkPhysicalDeviceVulkan12Features& features) {
+
+	return features.runtimeDescriptorArray && features.shaderSampledImageArrayNonUniformIndexing &&
+		features.descriptorBindingPartiallyBound && features.descriptorBindingVariableDescriptorCount &&
+		features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingUpdateUnusedWhilePending;
+}
+
+void BindlessTextures::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t capacity, uint32_t framesInFlight) {
+
+	this->device = device;
+	this->framesInFlight = framesInFlight;
+
+	//the update after bind limits are separate from the regular per stage limits and usually far higher
+	VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+	vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &vulkan12Properties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	uint32_t maxTextures = std::min({ BINDLESS_MAX_TEXTURES,
+		vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages, vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers,
+		vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers });
+	this->capacity = std::min(capacity, maxTextures);
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = maxTextures;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	//slots nobody registered are never read, and a slot can be written while other slots are sampled by pending frames
+	VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = this->capacity;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetVariableDescriptorCountAllocateInfo countInfo{};
+	countInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	countInfo.descriptorSetCount = 1;
+	countInfo.pDescriptorCounts = &this->capacity;
+
+	VkDescriptorSetAllocateInfo allocationInfo{};
+	allocationInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocationInfo.pNext = &countInfo;
+	allocationInfo.descriptorPool = pool;
+	allocationInfo.descriptorSetCount = 1;
+	allocationInfo.pSetLayouts = &layout;
+
+	if (vkAllocateDescriptorSets(device, &allocationInfo, &set) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate bindless descriptor set!");
+	}
+
+	freeSlots.clear();
+	for (uint32_t slot = this->capacity; slot > 0; slot--) {
+		freeSlots.push_back(slot - 1);
+	}
+
+	std::cout << "Bindless textures: " << this->capacity << " slots in one update after bind set (device allows " << maxTextures << ")" << std::endl;
+}
+
+void BindlessTextures::destroy() {
+
+	//the set goes with its pool
+	vkDestroyDescriptorPool(device, pool, nullptr);
+	vkDestroyDescriptorSetLayout(device, layout, nullptr);
+	pool = VK_NULL_HANDLE;
+	layout = VK_NULL_HANDLE;
+	set = VK_NULL_HANDLE;
+	freeSlots.clear();
+	retired.clear();
+	count = 0;
+}
+
+uint32_t BindlessTextures::add(VkImageView view, VkSampler sampler) {
+
+	if (freeSlots.empty()) {
+		throw std::runtime_error("Failed to register texture, every bindless slot is taken!");
+	}
+
+	uint32_t slot = freeSlots.back();
+	freeSlots.pop_back();
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = view;
+	imageInfo.sampler = sampler;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 0;
+	write.dstArrayElement = slot;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.descriptorCount = 1;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	count++;
+	return slot;
+}
+
+void BindlessTextures::remove(uint32_t slot) {
+
+	//the descriptor stays as it is, partially bound slots nobody indexes are never read
+	retired.push_back({ slot, frame });
+	count--;
+}
+
+void BindlessTextures::nextFrame() {
+
+	frame++;
+	while (!retired.empty() && retired.front().frame + framesInFlight <= frame) {
+		freeSlots.push_back(retired.front().slot);
+		retired.pop_front();
+	}
+}
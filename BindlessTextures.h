@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+
+//one descriptor set holding a large array of combined image samplers, shaders pick an entry by index so draws never switch sets
+//built on descriptor indexing (VK_EXT_descriptor_indexing, core in Vulkan 1.2): the binding is partially bound, sized when the set
+//is allocated and updated after bind, so registering a texture writes one descriptor while earlier frames are still in flight
+class BindlessTextures {
+
+public:
+
+	//runtime arrays, non uniform indexing, partially bound, variable count and updates after bind and while pending
+	static bool isSupported(const VkPhysicalDeviceVulkan12Features&);
+
+	//capacity is clamped to the update after bind limits of the device
+	void init(VkPhysicalDevice, VkDevice, uint32_t capacity, uint32_t framesInFlight);
+	void destroy();
+
+	//pops a free slot and writes its descriptor, throws when every slot is taken
+	uint32_t add(VkImageView, VkSampler);
+
+	//the slot goes back to the free list once the frames in flight that may still sample it have finished
+	void remove(uint32_t slot);
+
+	//once per frame after waiting for its fence, recycles the slots removed framesInFlight frames ago
+	void nextFrame();
+
+	VkDescriptorSetLayout getLayout() const { return layout; }
+	VkDescriptorSet getSet() const { return set; }
+	uint32_t getCapacity() const { return capacity; }
+	uint32_t getCount() const { return count; }
+
+private:
+
+	struct RetiredSlot {
+		uint32_t slot;
+		uint64_t frame;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	uint32_t capacity = 0;
+	uint32_t count = 0;
+	uint32_t framesInFlight = 1;
+	uint64_t frame = 0;
+
+	//stack of free slots, lowest slot on top so the array fills from the front
+	std::vector<uint32_t> freeSlots;
+
+	//removed slots in removal order, the oldest is always in front
+	std::deque<RetiredSlot> retired;
+
+};
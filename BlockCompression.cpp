@@ -0,0 +1,449 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+//BC7 interpolation weights for 4 bit indices, out of 64
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+//mean and dominant direction of up to 16 points, power iteration on the covariance matrix
+template <int CHANNELS>
+static void principalAxis(const float points[][CHANNELS], int count, float mean[CHANNELS], float axis[CHANNELS]) {
+
+	for (int c = 0; c < CHANNELS; c++) {
+		mean[c] = 0.0f;
+		for (int i = 0; i < count; i++) {
+			mean[c] += points[i][c];
+		}
+		mean[c] /= float(std::max(count, 1));
+	}
+
+	float covariance[CHANNELS][CHANNELS] = {};
+	for (int i = 0; i < count; i++) {
+		for (int a = 0; a < CHANNELS; a++) {
+			for (int b = 0; b < CHANNELS; b++) {
+				covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+			}
+		}
+	}
+
+	for (int c = 0; c < CHANNELS; c++) {
+		axis[c] = 1.0f;
+	}
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[CHANNELS] = {};
+		float length = 0.0f;
+		for (int a = 0; a < CHANNELS; a++) {
+			for (int b = 0; b < CHANNELS; b++) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+			length = std::max(length, std::fabs(next[a]));
+		}
+		//flat blocks have no direction, any axis works
+		if (length < 1e-6f) {
+			return;
+		}
+		for (int c = 0; c < CHANNELS; c++) {
+			axis[c] = next[c] / length;
+		}
+	}
+}
+
+//endpoints at the extreme projections onto the principal axis
+template <int CHANNELS>
+static void fitEndpoints(const float points[][CHANNELS], int count, float low[CHANNELS], float high[CHANNELS]) {
+
+	float mean[CHANNELS];
+	float axis[CHANNELS];
+	principalAxis<CHANNELS>(points, count, mean, axis);
+
+	float minimum = 0.0f;
+	float maximum = 0.0f;
+	for (int i = 0; i < count; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < CHANNELS; c++) {
+			t += (points[i][c] - mean[c]) * axis[c];
+		}
+		minimum = std::min(minimum, t);
+		maximum = std::max(maximum, t);
+	}
+
+	float lengthSquared = 0.0f;
+	for (int c = 0; c < CHANNELS; c++) {
+		lengthSquared += axis[c] * axis[c];
+	}
+	for (int c = 0; c < CHANNELS; c++) {
+		low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minimum / lengthSquared));
+		high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maximum / lengthSquared));
+	}
+}
+
+//endpoints minimizing the squared error for fixed interpolation weights, weight 0 is all low and 1 all high
+//returns false when every point uses the same weight and the system has no unique solution
+template <int CHANNELS>
+static bool refineEndpoints(const float points[][CHANNELS], const float weights[], int count, float low[CHANNELS], float high[CHANNELS]) {
+
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[CHANNELS] = {}, bx[CHANNELS] = {};
+	for (int i = 0; i < count; i++) {
+		float a = 1.0f - weights[i];
+		float b = weights[i];
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < CHANNELS; c++) {
+			ax[c] += a * points[i][c];
+			bx[c] += b * points[i][c];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f) {
+		return false;
+	}
+	for (int c = 0; c < CHANNELS; c++) {
+		low[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+		high[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+	}
+	return true;
+}
+
+static uint16_t packColor565(const float color[3]) {
+	uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+static void unpackColor565(uint16_t packed, int color[3]) {
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = r << 3 | r >> 2;
+	color[1] = g << 2 | g >> 4;
+	color[2] = b << 3 | b >> 2;
+}
+
+//picks the nearest palette entry for every point, returns the summed squared error
+template <int CHANNELS>
+static float assignIndices(const float points[][CHANNELS], int count, const int palette[][CHANNELS], int paletteSize, uint8_t indices[]) {
+
+	float total = 0.0f;
+	for (int i = 0; i < count; i++) {
+		float best = 1e30f;
+		for (int entry = 0; entry < paletteSize; entry++) {
+			float error = 0.0f;
+			for (int c = 0; c < CHANNELS; c++) {
+				float difference = points[i][c] - palette[entry][c];
+				error += difference * difference;
+			}
+			if (error < best) {
+				best = error;
+				indices[i] = static_cast<uint8_t>(entry);
+			}
+		}
+		total += best;
+	}
+	return total;
+}
+
+//BC1 color block, with punchThrough texels below half alpha use the transparent entry of the three color mode
+//BC3 passes false, its color block is always decoded with four colors
+static void encodeColorBlock(const uint8_t pixels[64], uint8_t output[8], bool punchThrough) {
+
+	float points[16][3];
+	bool transparent[16];
+	int opaqueCount = 0;
+	bool anyTransparent = false;
+	for (int i = 0; i < 16; i++) {
+		transparent[i] = punchThrough && pixels[i * 4 + 3] < 128;
+		anyTransparent = anyTransparent || transparent[i];
+		if (!transparent[i]) {
+			for (int c = 0; c < 3; c++) {
+				points[opaqueCount][c] = pixels[i * 4 + c];
+			}
+			opaqueCount++;
+		}
+	}
+
+	uint16_t color0 = 0;
+	uint16_t color1 = 0;
+	uint8_t indices[16] = {};
+
+	if (opaqueCount > 0) {
+		float low[3], high[3];
+		fitEndpoints<3>(points, opaqueCount, low, high);
+
+		float bestError = 1e30f;
+		for (int pass = 0; pass < 2; pass++) {
+			uint16_t packedHigh = packColor565(high);
+			uint16_t packedLow = packColor565(low);
+
+			//four color mode needs color0 > color1, three color mode color0 <= color1
+			uint16_t first = anyTransparent ? std::min(packedHigh, packedLow) : std::max(packedHigh, packedLow);
+			uint16_t second = anyTransparent ? std::max(packedHigh, packedLow) : std::min(packedHigh, packedLow);
+
+			int palette[4][3];
+			unpackColor565(first, palette[0]);
+			unpackColor565(second, palette[1]);
+			int paletteSize = 4;
+			for (int c = 0; c < 3; c++) {
+				if (anyTransparent || first == second) {
+					palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+					paletteSize = 3;
+				}
+				else {
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+			}
+
+			uint8_t opaqueIndices[16];
+			float error = assignIndices<3>(points, opaqueCount, palette, paletteSize, opaqueIndices);
+			if (error < bestError) {
+				bestError = error;
+				color0 = first;
+				color1 = second;
+				for (int i = 0, opaque = 0; i < 16; i++) {
+					indices[i] = transparent[i] ? 3 : opaqueIndices[opaque++];
+				}
+			}
+
+			//least squares on the chosen indices, weights are the position between palette[0] and palette[1]
+			static const float FOUR_COLOR_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			static const float THREE_COLOR_WEIGHTS[3] = { 0.0f, 1.0f, 0.5f };
+			float weights[16];
+			for (int i = 0; i < opaqueCount; i++) {
+				weights[i] = paletteSize == 4 ? FOUR_COLOR_WEIGHTS[opaqueIndices[i]] : THREE_COLOR_WEIGHTS[opaqueIndices[i]];
+			}
+			float first3[3], second3[3];
+			if (!refineEndpoints<3>(points, weights, opaqueCount, first3, second3)) {
+				break;
+			}
+			std::copy(first3, first3 + 3, high);
+			std::copy(second3, second3 + 3, low);
+		}
+	}
+	else {
+		//all transparent, equal endpoints select three color mode
+		std::fill(indices, indices + 16, 3);
+	}
+
+	uint32_t packedIndices = 0;
+	for (int i = 0; i < 16; i++) {
+		packedIndices |= uint32_t(indices[i]) << (2 * i);
+	}
+	memcpy(output, &color0, 2);
+	memcpy(output + 2, &color1, 2);
+	memcpy(output + 4, &packedIndices, 4);
+}
+
+//BC4 style block, eight interpolated values between the extremes
+static void encodeSingleChannel(const uint8_t values[16], uint8_t output[8]) {
+
+	int high = *std::max_element(values, values + 16);
+	int low = *std::min_element(values, values + 16);
+
+	int palette[8];
+	palette[0] = high;
+	palette[1] = low;
+	for (int i = 1; i < 7; i++) {
+		palette[i + 1] = ((7 - i) * high + i * low) / 7;
+	}
+
+	uint64_t bits = uint64_t(high) | uint64_t(low) << 8;
+	for (int i = 0; i < 16; i++) {
+		int best = 0;
+		for (int entry = 1; entry < 8; entry++) {
+			if (std::abs(values[i] - palette[entry]) < std::abs(values[i] - palette[best])) {
+				best = entry;
+			}
+		}
+		bits |= uint64_t(best) << (16 + 3 * i);
+	}
+	memcpy(output, &bits, 8);
+}
+
+void encodeBlockBC1(const uint8_t pixels[64], uint8_t output[8]) {
+	encodeColorBlock(pixels, output, true);
+}
+
+void encodeBlockBC3(const uint8_t pixels[64], uint8_t output[16]) {
+
+	uint8_t alpha[16];
+	for (int i = 0; i < 16; i++) {
+		alpha[i] = pixels[i * 4 + 3];
+	}
+	encodeSingleChannel(alpha, output);
+	encodeColorBlock(pixels, output + 8, false);
+}
+
+void encodeBlockBC5(const uint8_t pixels[64], uint8_t output[16]) {
+
+	uint8_t red[16], green[16];
+	for (int i = 0; i < 16; i++) {
+		red[i] = pixels[i * 4 + 0];
+		green[i] = pixels[i * 4 + 1];
+	}
+	encodeSingleChannel(red, output);
+	encodeSingleChannel(green, output + 8);
+}
+
+//mode 6 block: 7 bit RGBA endpoints, one p bit each, 4 bit indices
+struct Bc7Mode6 {
+	int endpoints[2][4];
+	int pBits[2];
+	uint8_t indices[16];
+	float error;
+};
+
+static Bc7Mode6 quantizeMode6(const float points[16][4], const float low[4], const float high[4]) {
+
+	Bc7Mode6 best{};
+	best.error = 1e30f;
+	const float* ends[2] = { low, high };
+
+	//the p bit is shared by all four channels of an endpoint, so try each combination
+	for (int combination = 0; combination < 4; combination++) {
+		Bc7Mode6 candidate{};
+		int expanded[2][4];
+		for (int end = 0; end < 2; end++) {
+			int p = (combination >> end) & 1;
+			candidate.pBits[end] = p;
+			for (int c = 0; c < 4; c++) {
+				int value = static_cast<int>(std::lround((ends[end][c] - p) / 2.0f));
+				candidate.endpoints[end][c] = std::min(127, std::max(0, value));
+				expanded[end][c] = candidate.endpoints[end][c] << 1 | p;
+			}
+		}
+
+		int palette[16][4];
+		for (int entry = 0; entry < 16; entry++) {
+			for (int c = 0; c < 4; c++) {
+				palette[entry][c] = ((64 - BC7_WEIGHTS[entry]) * expanded[0][c] + BC7_WEIGHTS[entry] * expanded[1][c] + 32) >> 6;
+			}
+		}
+
+		candidate.error = assignIndices<4>(points, 16, palette, 16, candidate.indices);
+		if (candidate.error < best.error) {
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+void encodeBlockBC7(const uint8_t pixels[64], uint8_t output[16]) {
+
+	float points[16][4];
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			points[i][c] = pixels[i * 4 + c];
+		}
+	}
+
+	float low[4], high[4];
+	fitEndpoints<4>(points, 16, low, high);
+	Bc7Mode6 block = quantizeMode6(points, low, high);
+
+	float weights[16];
+	for (int i = 0; i < 16; i++) {
+		weights[i] = BC7_WEIGHTS[block.indices[i]] / 64.0f;
+	}
+	if (refineEndpoints<4>(points, weights, 16, low, high)) {
+		Bc7Mode6 refined = quantizeMode6(points, low, high);
+		if (refined.error < block.error) {
+			block = refined;
+		}
+	}
+
+	//the top index bit of the first texel is implied 0, swapping the endpoints mirrors the indices to get there
+	if (block.indices[0] >= 8) {
+		std::swap(block.endpoints[0], block.endpoints[1]);
+		std::swap(block.pBits[0], block.pBits[1]);
+		for (uint8_t& index : block.indices) {
+			index = static_cast<uint8_t>(15 - index);
+		}
+	}
+
+	uint64_t bits[2] = { 0, 0 };
+	int position = 0;
+	auto write = [&bits, &position](uint64_t value, int count) {
+		for (int bit = 0; bit < count; bit++, position++) {
+			bits[position / 64] |= ((value >> bit) & 1) << (position % 64);
+		}
+	};
+
+	write(1u << 6, 7);
+	for (int c = 0; c < 4; c++) {
+		write(block.endpoints[0][c], 7);
+		write(block.endpoints[1][c], 7);
+	}
+	write(block.pBits[0], 1);
+	write(block.pBits[1], 1);
+	write(block.indices[0], 3);
+	for (int i = 1; i < 16; i++) {
+		write(block.indices[i], 4);
+	}
+	memcpy(output, bits, 16);
+}
+
+bool canCompress(TextureFormat format) {
+
+	switch (format) {
+	case TextureFormat::RGBA8Unorm:
+	case TextureFormat::RGBA8Srgb:
+	case TextureFormat::BC1Unorm:
+	case TextureFormat::BC1Srgb:
+	case TextureFormat::BC3Unorm:
+	case TextureFormat::BC3Srgb:
+	case TextureFormat::BC5Unorm:
+	case TextureFormat::BC7Unorm:
+	case TextureFormat::BC7Srgb:
+		return true;
+	default:
+		return false;
+	}
+}
+
+std::vector<uint8_t> compressImage(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height) {
+
+	const TextureFormatInfo* info = findTextureFormat(format);
+	if (info == nullptr || !canCompress(format)) {
+		return {};
+	}
+	if (info->blockWidth == 1) {
+		return std::vector<uint8_t>(pixels, pixels + size_t(width) * height * 4);
+	}
+
+	void (*encode)(const uint8_t*, uint8_t*) = encodeBlockBC7;
+	if (format == TextureFormat::BC1Unorm || format == TextureFormat::BC1Srgb) {
+		encode = encodeBlockBC1;
+	}
+	else if (format == TextureFormat::BC3Unorm || format == TextureFormat::BC3Srgb) {
+		encode = encodeBlockBC3;
+	}
+	else if (format == TextureFormat::BC5Unorm) {
+		encode = encodeBlockBC5;
+	}
+
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+	std::vector<uint8_t> blocks(size_t(blocksX) * blocksY * info->blockBytes);
+
+	uint8_t block[64];
+	for (uint32_t by = 0; by < blocksY; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			for (uint32_t y = 0; y < 4; y++) {
+				uint32_t sourceY = std::min(by * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; x++) {
+					uint32_t sourceX = std::min(bx * 4 + x, width - 1);
+					memcpy(block + (y * 4 + x) * 4, pixels + (size_t(sourceY) * width + sourceX) * 4, 4);
+				}
+			}
+			encode(block, blocks.data() + (size_t(by) * blocksX + bx) * info->blockBytes);
+		}
+	}
+	return blocks;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TextureFile.h"
+
+
+//CPU block encoders used by tools/TextureConverter, CPU only so the converter runs without a GPU
+//the encoders fit endpoints along the principal axis of each block and refine them once by least squares
+//that is far from what dedicated encoders reach but keeps conversion of a 2048^2 texture at a few hundred milliseconds
+//ETC2 and ASTC have no encoder here, their KTX2 files come from external tools and load the same way
+
+//true for the formats compressImage can produce: RGBA8, BC1, BC3, BC5 and BC7
+bool canCompress(TextureFormat);
+
+//compresses one RGBA8 image into blocks in row order, edge blocks repeat the last row and column
+//BC5 keeps red and green, BC7 only uses mode 6 (one subset, RGBA endpoints)
+std::vector<uint8_t> compressImage(TextureFormat, const uint8_t* pixels, uint32_t width, uint32_t height);
+
+//single 4x4 blocks, pixels are 16 RGBA8 texels in row order
+void encodeBlockBC1(const uint8_t pixels[64], uint8_t output[8]);
+void encodeBlockBC3(const uint8_t pixels[64], uint8_t output[16]);
+void encodeBlockBC5(const uint8_t pixels[64], uint8_t output[16]);
+void encodeBlockBC7(const uint8_t pixels[64], uint8_t output[16]);
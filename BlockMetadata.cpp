@@ -0,0 +1,211 @@
+#include "BlockMetadata.h"
+
+#include <algorithm>
+
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+
+bool LinearBlockMetadata::allocate(uint64_t allocSize, uint64_t alignment, ResourceType type, uint64_t& offset) {
+
+	uint64_t candidate = alignUp(top, alignment);
+
+	//the previous allocation is always live since freed ranges are popped from the top
+	if (!ranges.empty()) {
+		const Range& previous = ranges.back();
+		uint64_t previousPage = (previous.offset + previous.size - 1) / granularity;
+
+		if (previous.type != type && previousPage == candidate / granularity) {
+			candidate = alignUp(candidate, granularity);
+		}
+	}
+
+	if (candidate + allocSize > size) {
+		return false;
+	}
+
+	ranges.push_back({ candidate, allocSize, type, false });
+	top = candidate + allocSize;
+	used += allocSize;
+	allocationCount++;
+
+	offset = candidate;
+	return true;
+}
+
+void LinearBlockMetadata::free(uint64_t offset) {
+
+	//frees are usually in reverse order so search from the top
+	for (auto range = ranges.rbegin(); range != ranges.rend(); range++) {
+		if (range->offset == offset && !range->freed) {
+			range->freed = true;
+			used -= range->size;
+			allocationCount--;
+			break;
+		}
+	}
+
+	//space only becomes reusable once everything above it is freed as well
+	while (!ranges.empty() && ranges.back().freed) {
+		ranges.pop_back();
+	}
+
+	top = ranges.empty() ? 0 : ranges.back().offset + ranges.back().size;
+}
+
+uint64_t LinearBlockMetadata::largestFreeRange() const {
+	return size - top;
+}
+
+
+PoolBlockMetadata::PoolBlockMetadata(uint64_t size, uint64_t granularity, uint64_t slotSize)
+	: BlockMetadata(size, granularity), slotSize(slotSize) {
+
+	uint32_t slotCount = static_cast<uint32_t>(size / slotSize);
+
+	//reverse order so the lowest slot is handed out first
+	freeSlots.reserve(slotCount);
+	for (uint32_t i = slotCount; i > 0; i--) {
+		freeSlots.push_back(i - 1);
+	}
+}
+
+bool PoolBlockMetadata::allocate(uint64_t allocSize, uint64_t alignment, ResourceType /*type*/, uint64_t& offset) {
+
+	//slots are a multiple of the granularity so neighbours never share a page, the type does not matter
+	if (allocSize > slotSize || slotSize % alignment != 0 || freeSlots.empty()) {
+		return false;
+	}
+
+	uint32_t slot = freeSlots.back();
+	freeSlots.pop_back();
+
+	used += slotSize;
+	allocationCount++;
+
+	offset = slot * slotSize;
+	return true;
+}
+
+void PoolBlockMetadata::free(uint64_t offset) {
+
+	freeSlots.push_back(static_cast<uint32_t>(offset / slotSize));
+	used -= slotSize;
+	allocationCount--;
+}
+
+uint64_t PoolBlockMetadata::largestFreeRange() const {
+	return freeSlots.empty() ? 0 : slotSize;
+}
+
+
+BuddyBlockMetadata::BuddyBlockMetadata(uint64_t size, uint64_t granularity, uint64_t minNodeSize)
+	: BlockMetadata(size, granularity) {
+
+	levelCount = 1;
+	while ((size >> levelCount) >= minNodeSize) {
+		levelCount++;
+	}
+
+	freeNodes.resize(levelCount);
+	freeNodes[0].insert(0);
+}
+
+bool BuddyBlockMetadata::allocate(uint64_t allocSize, uint64_t alignment, ResourceType /*type*/, uint64_t& offset) {
+
+	//nodes are aligned to their own size and never smaller than the granularity, so the type does not matter
+	uint64_t required = std::max(allocSize, alignment);
+
+	if (required > size) {
+		return false;
+	}
+
+	//deepest level whose nodes still fit the request
+	uint32_t level = levelCount - 1;
+	while (nodeSize(level) < required) {
+		level--;
+	}
+
+	//walk up until a free node is found
+	int32_t freeLevel = static_cast<int32_t>(level);
+	while (freeLevel >= 0 && freeNodes[freeLevel].empty()) {
+		freeLevel--;
+	}
+
+	if (freeLevel < 0) {
+		return false;
+	}
+
+	uint64_t node = *freeNodes[freeLevel].begin();
+	freeNodes[freeLevel].erase(freeNodes[freeLevel].begin());
+
+	//split down to the requested level, keeping the lower half and freeing the upper buddy
+	for (uint32_t l = static_cast<uint32_t>(freeLevel) + 1; l <= level; l++) {
+		freeNodes[l].insert(node + nodeSize(l));
+	}
+
+	allocatedLevels[node] = level;
+	used += nodeSize(level);
+	allocationCount++;
+
+	offset = node;
+	return true;
+}
+
+void BuddyBlockMetadata::free(uint64_t offset) {
+
+	auto allocated = allocatedLevels.find(offset);
+	if (allocated == allocatedLevels.end()) {
+		return;
+	}
+
+	uint32_t level = allocated->second;
+	allocatedLevels.erase(allocated);
+
+	used -= nodeSize(level);
+	allocationCount--;
+
+	//merge with the buddy for as long as it is free
+	uint64_t node = offset;
+	while (level > 0) {
+		uint64_t buddy = node ^ nodeSize(level);
+		auto freeBuddy = freeNodes[level].find(buddy);
+
+		if (freeBuddy == freeNodes[level].end()) {
+			break;
+		}
+
+		freeNodes[level].erase(freeBuddy);
+		node = std::min(node, buddy);
+		level--;
+	}
+
+	freeNodes[level].insert(node);
+}
+
+uint64_t BuddyBlockMetadata::largestFreeRange() const {
+
+	for (uint32_t level = 0; level < levelCount; level++) {
+		if (!freeNodes[level].empty()) {
+			return nodeSize(level);
+		}
+	}
+	return 0;
+}
+
+float blockFragmentation(const std::vector<const BlockMetadata*>& blocks) {
+
+	uint64_t freeBytes = 0;
+	uint64_t largestFreeBytes = 0;
+	for (const BlockMetadata* block : blocks) {
+		freeBytes += block->size - block->used;
+		largestFreeBytes += block->largestFreeRange();
+	}
+
+	if (freeBytes == 0) {
+		return 0.0f;
+	}
+	return 1.0f - static_cast<float>(largestFreeBytes) / static_cast<float>(freeBytes);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+
+//sizes and offsets are uint64_t, which is what VkDeviceSize is, so the placement logic builds without the Vulkan headers
+
+//buffers and linear images may not share a bufferImageGranularity page with optimal images
+enum class ResourceType {
+	Linear,
+	Optimal
+};
+
+//placement bookkeeping for one block, no vulkan calls so it can be exercised on the CPU alone (tests/BlockMetadataTest.cpp)
+class BlockMetadata {
+
+public:
+
+	BlockMetadata(uint64_t size, uint64_t granularity) : size(size), granularity(granularity) {}
+	virtual ~BlockMetadata() = default;
+
+	//returns false when the request does not fit
+	virtual bool allocate(uint64_t allocSize, uint64_t alignment, ResourceType type, uint64_t& offset) = 0;
+	virtual void free(uint64_t offset) = 0;
+
+	//biggest single request that could still be served, used for fragmentation
+	virtual uint64_t largestFreeRange() const = 0;
+
+	bool empty() const { return allocationCount == 0; }
+
+	uint64_t size;
+	uint64_t granularity;
+	uint64_t used = 0;
+	uint32_t allocationCount = 0;
+
+};
+
+class LinearBlockMetadata : public BlockMetadata {
+
+public:
+
+	using BlockMetadata::BlockMetadata;
+
+	bool allocate(uint64_t allocSize, uint64_t alignment, ResourceType type, uint64_t& offset) override;
+	void free(uint64_t offset) override;
+	uint64_t largestFreeRange() const override;
+
+private:
+
+	struct Range {
+		uint64_t offset;
+		uint64_t size;
+		ResourceType type;
+		bool freed;
+	};
+
+	//allocations in placement order, the top is popped as soon as it is freed
+	std::vector<Range> ranges;
+	uint64_t top = 0;
+
+};
+
+class PoolBlockMetadata : public BlockMetadata {
+
+public:
+
+	PoolBlockMetadata(uint64_t size, uint64_t granularity, uint64_t slotSize);
+
+	bool allocate(uint64_t allocSize, uint64_t alignment, ResourceType type, uint64_t& offset) override;
+	void free(uint64_t offset) override;
+	uint64_t largestFreeRange() const override;
+
+	uint64_t slotSize;
+
+private:
+
+	std::vector<uint32_t> freeSlots;
+
+};
+
+class BuddyBlockMetadata : public BlockMetadata {
+
+public:
+
+	//size must be a power of two
+	BuddyBlockMetadata(uint64_t size, uint64_t granularity, uint64_t minNodeSize);
+
+	bool allocate(uint64_t allocSize, uint64_t alignment, ResourceType type, uint64_t& offset) override;
+	void free(uint64_t offset) override;
+	uint64_t largestFreeRange() const override;
+
+private:
+
+	uint64_t nodeSize(uint32_t level) const { return size >> level; }
+
+	//level 0 is the whole block, every level below halves the node size
+	uint32_t levelCount;
+	std::vector<std::set<uint64_t>> freeNodes;
+	std::map<uint64_t, uint32_t> allocatedLevels;
+
+};
+
+//1 - largest free range / total free space, summed over the blocks, 0 means all free space is contiguous
+float blockFragmentation(const std::vector<const BlockMetadata*>&);
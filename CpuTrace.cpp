@@ -0,0 +1,141 @@
+#include "CpuTrace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+//zones kept per thread, about 1.5 MB
+static const uint64_t RING_CAPACITY = 1 << 16;
+
+//fields are relaxed atomics so an export running next to the writer reads torn zones instead of racing
+struct TraceEvent {
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<uint64_t> begin{ 0 };
+	std::atomic<uint64_t> end{ 0 };
+};
+
+struct ThreadRing {
+	std::vector<TraceEvent> events = std::vector<TraceEvent>(RING_CAPACITY);
+
+	//zones ever written, only the owning thread stores it
+	std::atomic<uint64_t> head{ 0 };
+
+	uint32_t threadId = 0;
+	std::string threadName;
+};
+
+//rings outlive their threads so zones of finished threads still make it into the trace
+static std::mutex ringsMutex;
+static std::vector<std::unique_ptr<ThreadRing>> rings;
+
+static thread_local ThreadRing* threadRing = nullptr;
+
+std::atomic<bool> CpuTrace::enabled{ false };
+const std::chrono::steady_clock::time_point CpuTrace::start = std::chrono::steady_clock::now();
+
+
+//registers the calling thread on its first zone, the only place that takes a lock
+static ThreadRing& getThreadRing() {
+
+	if (!threadRing) {
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		rings.push_back(std::make_unique<ThreadRing>());
+		threadRing = rings.back().get();
+		threadRing->threadId = static_cast<uint32_t>(rings.size());
+		threadRing->threadName = "thread " + std::to_string(threadRing->threadId);
+	}
+	return *threadRing;
+}
+
+void CpuTrace::setEnabled(bool enable) {
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+void CpuTrace::setThreadName(const std::string& name) {
+
+	ThreadRing& ring = getThreadRing();
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	ring.threadName = name;
+}
+
+void CpuTrace::record(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds) {
+
+	ThreadRing& ring = getThreadRing();
+	uint64_t index = ring.head.load(std::memory_order_relaxed);
+
+	//release so an exporter that reads any of these also sees the head of the zones before it
+	TraceEvent& event = ring.events[index & (RING_CAPACITY - 1)];
+	event.name.store(name, std::memory_order_release);
+	event.begin.store(beginNanoseconds, std::memory_order_release);
+	event.end.store(endNanoseconds, std::memory_order_release);
+
+	//publishes the zone to the exporter
+	ring.head.store(index + 1, std::memory_order_release);
+}
+
+static void writeJsonString(std::ofstream& file, const std::string& text) {
+
+	file << '"';
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			file << '\\';
+		}
+		file << c;
+	}
+	file << '"';
+}
+
+bool CpuTrace::writeChromeJson(const std::string& fileName) {
+
+	std::ofstream file(fileName, std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(ringsMutex);
+
+	//microseconds with nanosecond digits, the default precision would print long runs in exponent form
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+
+	for (const std::unique_ptr<ThreadRing>& ring : rings) {
+
+		file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->threadId << ",\"args\":{\"name\":";
+		writeJsonString(file, ring->threadName);
+		file << "}}";
+		first = false;
+
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		uint64_t begin = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+
+		struct Zone { const char* name; uint64_t begin; uint64_t end; };
+		std::vector<Zone> zones;
+		zones.reserve(head - begin);
+		for (uint64_t index = begin; index < head; index++) {
+			const TraceEvent& event = ring->events[index & (RING_CAPACITY - 1)];
+			zones.push_back({ event.name.load(std::memory_order_relaxed), event.begin.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed) });
+		}
+
+		//the writer may have lapped the oldest slots while they were copied, one more slot is being written right now
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t headAfter = ring->head.load(std::memory_order_relaxed);
+		uint64_t validBegin = headAfter + 1 > RING_CAPACITY ? headAfter + 1 - RING_CAPACITY : 0;
+
+		for (uint64_t index = std::max(begin, validBegin); index < head; index++) {
+			const Zone& zone = zones[index - begin];
+
+			//complete events in microseconds
+			file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId << ",\"name\":";
+			writeJsonString(file, zone.name);
+			file << ",\"ts\":" << zone.begin / 1000.0 << ",\"dur\":" << (zone.end - zone.begin) / 1000.0 << "}";
+		}
+	}
+
+	file << "\n]}\n";
+	return file.good();
+}
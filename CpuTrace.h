@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+//scoped CPU timing zones, exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+//every thread writes into its own ring buffer without locks, the oldest zones are overwritten once it is full
+//zones compile to nothing unless RENDERER_TRACE is defined
+class CpuTrace {
+
+public:
+
+	//zones are recorded only while enabled, off by default
+	static void setEnabled(bool);
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	//label of the calling thread in the trace
+	static void setThreadName(const std::string&);
+
+	//name has to outlive the trace, zones are given string literals
+	static void record(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds);
+
+	//nanoseconds since the trace clock started
+	static uint64_t now() {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	//can be called while other threads keep recording, zones overwritten during the copy are left out
+	static bool writeChromeJson(const std::string& fileName);
+
+private:
+
+	static std::atomic<bool> enabled;
+	static const std::chrono::steady_clock::time_point start;
+
+};
+
+//times the enclosing scope
+class CpuTraceZone {
+
+public:
+
+	explicit CpuTraceZone(const char* name) : name(CpuTrace::isEnabled() ? name : nullptr), begin(this->name ? CpuTrace::now() : 0) {}
+
+	~CpuTraceZone() {
+		if (name) {
+			CpuTrace::record(name, begin, CpuTrace::now());
+		}
+	}
+
+	CpuTraceZone(const CpuTraceZone&) = delete;
+	CpuTraceZone& operator=(const CpuTraceZone&) = delete;
+
+private:
+
+	const char* name;
+	uint64_t begin;
+
+};
+
+#define CPU_TRACE_CONCAT_INNER(a, b) a##b
+#define CPU_TRACE_CONCAT(a, b) CPU_TRACE_CONCAT_INNER(a, b)
+
+#ifdef RENDERER_TRACE
+#define TRACE_ZONE(name) CpuTraceZone CPU_TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) CpuTrace::setThreadName(name)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_THREAD_NAME(name)
+#endif
@@ -0,0 +1,399 @@
+#include "Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CpuTrace.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CULLING_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//MSVC compiles every intrinsic without flags, GCC and Clang need the target on the function using it
+#if defined(CULLING_X86) && !defined(_MSC_VER)
+#define CULLING_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CULLING_TARGET_AVX2
+#endif
+
+
+//small enough that a partly visible leaf is cheap, large enough to fill several AVX2 steps
+static const uint32_t BVH_LEAF_SIZE = 32;
+
+//parallel culling splits the BVH this many levels below the root, up to 16 jobs
+static const uint32_t BVH_JOB_DEPTH = 4;
+
+//below this the jobs cost more than they save
+static const size_t PARALLEL_CULL_MIN_OBJECTS = 16384;
+
+
+CullingKernel bestCullingKernel() {
+
+#if defined(CULLING_X86)
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osxsave && avx) {
+		//the OS has to save the upper halves of the ymm registers
+		bool ymmState = (_xgetbv(0) & 0x6) == 0x6;
+		__cpuidex(info, 7, 0);
+		avx2 = ymmState && (info[1] & (1 << 5)) != 0;
+	}
+	return avx2 ? CullingKernel::AVX2 : CullingKernel::SSE;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? CullingKernel::AVX2 : CullingKernel::SSE;
+#endif
+#else
+	return CullingKernel::Scalar;
+#endif
+}
+
+const char* cullingKernelName(CullingKernel kernel) {
+
+	switch (kernel) {
+	case CullingKernel::SSE:
+		return "SSE";
+	case CullingKernel::AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+
+void CullingBoxes::resize(size_t count) {
+
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	extentX.resize(count);
+	extentY.resize(count);
+	extentZ.resize(count);
+}
+
+void CullingBoxes::set(size_t index, const glm::vec3& center, const glm::vec3& extent) {
+
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	extentX[index] = extent.x;
+	extentY[index] = extent.y;
+	extentZ[index] = extent.z;
+}
+
+
+//same test as isBoxVisible, unrolled over the structure of arrays
+static void cullBoxesScalar(const Frustum& frustum, const CullingBoxes& boxes, const uint32_t* ids, size_t begin, size_t end, std::vector<uint32_t>& visible) {
+
+	for (size_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (const glm::vec4& plane : frustum.planes) {
+			float distance = plane.x * boxes.centerX[i] + plane.y * boxes.centerY[i] + plane.z * boxes.centerZ[i] + plane.w;
+			float radius = std::abs(plane.x) * boxes.extentX[i] + std::abs(plane.y) * boxes.extentY[i] + std::abs(plane.z) * boxes.extentZ[i];
+			if (distance + radius < 0.0f) {
+				inside = false;
+				break;
+			}
+		}
+		if (inside) {
+			visible.push_back(ids[i]);
+		}
+	}
+}
+
+#if defined(CULLING_X86)
+
+static void cullBoxesSSE(const Frustum& frustum, const CullingBoxes& boxes, const uint32_t* ids, size_t begin, size_t end, std::vector<uint32_t>& visible) {
+
+	//planes broadcast once, absolute normals for the box radius
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm_set1_ps(std::abs(frustum.planes[p].x));
+		absY[p] = _mm_set1_ps(std::abs(frustum.planes[p].y));
+		absZ[p] = _mm_set1_ps(std::abs(frustum.planes[p].z));
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	size_t i = begin;
+
+	for (; i + 4 <= end; i += 4) {
+		__m128 centerX = _mm_loadu_ps(&boxes.centerX[i]);
+		__m128 centerY = _mm_loadu_ps(&boxes.centerY[i]);
+		__m128 centerZ = _mm_loadu_ps(&boxes.centerZ[i]);
+		__m128 extentX = _mm_loadu_ps(&boxes.extentX[i]);
+		__m128 extentY = _mm_loadu_ps(&boxes.extentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&boxes.extentZ[i]);
+
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)), _mm_mul_ps(planeZ[p], centerZ)), planeW[p]);
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		int mask = ~_mm_movemask_ps(outside) & 0xF;
+		for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+			if (mask & 1) {
+				visible.push_back(ids[i + lane]);
+			}
+		}
+	}
+
+	cullBoxesScalar(frustum, boxes, ids, i, end, visible);
+}
+
+CULLING_TARGET_AVX2
+static void cullBoxesAVX2(const Frustum& frustum, const CullingBoxes& boxes, const uint32_t* ids, size_t begin, size_t end, std::vector<uint32_t>& visible) {
+
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm256_set1_ps(std::abs(frustum.planes[p].x));
+		absY[p] = _mm256_set1_ps(std::abs(frustum.planes[p].y));
+		absZ[p] = _mm256_set1_ps(std::abs(frustum.planes[p].z));
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	size_t i = begin;
+
+	//no FMA and the scalar order of additions, so the results match the other kernels bit for bit
+	for (; i + 8 <= end; i += 8) {
+		__m256 centerX = _mm256_loadu_ps(&boxes.centerX[i]);
+		__m256 centerY = _mm256_loadu_ps(&boxes.centerY[i]);
+		__m256 centerZ = _mm256_loadu_ps(&boxes.centerZ[i]);
+		__m256 extentX = _mm256_loadu_ps(&boxes.extentX[i]);
+		__m256 extentY = _mm256_loadu_ps(&boxes.extentY[i]);
+		__m256 extentZ = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+		__m256 outside = zero;
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], centerX), _mm256_mul_ps(planeY[p], centerY)), _mm256_mul_ps(planeZ[p], centerZ)), planeW[p]);
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], extentX), _mm256_mul_ps(absY[p], extentY)), _mm256_mul_ps(absZ[p], extentZ));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+		}
+
+		int mask = ~_mm256_movemask_ps(outside) & 0xFF;
+		for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+			if (mask & 1) {
+				visible.push_back(ids[i + lane]);
+			}
+		}
+	}
+
+	cullBoxesScalar(frustum, boxes, ids, i, end, visible);
+}
+
+#endif
+
+void cullBoxes(CullingKernel kernel, const Frustum& frustum, const CullingBoxes& boxes, const uint32_t* ids, size_t begin, size_t end, std::vector<uint32_t>& visible) {
+
+#if defined(CULLING_X86)
+	if (kernel == CullingKernel::AVX2) {
+		cullBoxesAVX2(frustum, boxes, ids, begin, end, visible);
+		return;
+	}
+	if (kernel == CullingKernel::SSE) {
+		cullBoxesSSE(frustum, boxes, ids, begin, end, visible);
+		return;
+	}
+#endif
+	cullBoxesScalar(frustum, boxes, ids, begin, end, visible);
+}
+
+
+void CullingBvh::build(const CullingBoxes& objects) {
+
+	nodes.clear();
+	ids.resize(objects.size());
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		ids[i] = i;
+	}
+
+	if (!ids.empty()) {
+		nodes.reserve(2 * (ids.size() / BVH_LEAF_SIZE + 1));
+		nodes.emplace_back();
+		buildNode(0, 0, static_cast<uint32_t>(ids.size()), objects);
+	}
+
+	subtrees.clear();
+	if (!nodes.empty()) {
+		gatherSubtrees(0, BVH_JOB_DEPTH);
+	}
+	subtreeVisible.resize(subtrees.size());
+
+	//leaves index the reordered boxes directly
+	boxes.resize(ids.size());
+	for (size_t i = 0; i < ids.size(); i++) {
+		uint32_t id = ids[i];
+		boxes.set(i, glm::vec3(objects.centerX[id], objects.centerY[id], objects.centerZ[id]), glm::vec3(objects.extentX[id], objects.extentY[id], objects.extentZ[id]));
+	}
+}
+
+//fills nodes[index] for ids[begin, end) and builds its children
+void CullingBvh::buildNode(uint32_t index, uint32_t begin, uint32_t end, const CullingBoxes& objects) {
+
+	float boundsMin[3] = { INFINITY, INFINITY, INFINITY };
+	float boundsMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+	float centroidMin[3] = { INFINITY, INFINITY, INFINITY };
+	float centroidMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+	const std::vector<float>* centers[3] = { &objects.centerX, &objects.centerY, &objects.centerZ };
+	const std::vector<float>* extents[3] = { &objects.extentX, &objects.extentY, &objects.extentZ };
+
+	for (uint32_t i = begin; i < end; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			float center = (*centers[axis])[ids[i]];
+			float extent = (*extents[axis])[ids[i]];
+			boundsMin[axis] = std::min(boundsMin[axis], center - extent);
+			boundsMax[axis] = std::max(boundsMax[axis], center + extent);
+			centroidMin[axis] = std::min(centroidMin[axis], center);
+			centroidMax[axis] = std::max(centroidMax[axis], center);
+		}
+	}
+
+	nodes[index].center = glm::vec3((boundsMin[0] + boundsMax[0]) * 0.5f, (boundsMin[1] + boundsMax[1]) * 0.5f, (boundsMin[2] + boundsMax[2]) * 0.5f);
+	nodes[index].extent = glm::vec3((boundsMax[0] - boundsMin[0]) * 0.5f, (boundsMax[1] - boundsMin[1]) * 0.5f, (boundsMax[2] - boundsMin[2]) * 0.5f);
+
+	if (end - begin <= BVH_LEAF_SIZE) {
+		nodes[index].first = begin;
+		nodes[index].count = end - begin;
+		return;
+	}
+
+	//median split along the axis the centroids spread the most
+	int axis = 0;
+	for (int i = 1; i < 3; i++) {
+		if (centroidMax[i] - centroidMin[i] > centroidMax[axis] - centroidMin[axis]) {
+			axis = i;
+		}
+	}
+
+	uint32_t middle = begin + (end - begin) / 2;
+	const std::vector<float>& splitCenters = *centers[axis];
+	std::nth_element(ids.begin() + begin, ids.begin() + middle, ids.begin() + end, [&](uint32_t a, uint32_t b) { return splitCenters[a] < splitCenters[b]; });
+
+	//both children are allocated together so the second is always first + 1
+	uint32_t first = static_cast<uint32_t>(nodes.size());
+	nodes[index].first = first;
+	nodes[index].count = 0;
+	nodes.emplace_back();
+	nodes.emplace_back();
+
+	buildNode(first, begin, middle, objects);
+	buildNode(first + 1, middle, end, objects);
+}
+
+void CullingBvh::gatherSubtrees(uint32_t index, uint32_t depth) {
+
+	if (depth == 0 || nodes[index].count > 0) {
+		subtrees.push_back(index);
+		return;
+	}
+	gatherSubtrees(nodes[index].first, depth - 1);
+	gatherSubtrees(nodes[index].first + 1, depth - 1);
+}
+
+void CullingBvh::cull(CullingKernel kernel, const Frustum& frustum, std::vector<uint32_t>& visible) const {
+
+	visible.clear();
+	if (!nodes.empty()) {
+		cullSubtree(0, kernel, frustum, visible);
+	}
+}
+
+void CullingBvh::cull(JobSystem& jobs, CullingKernel kernel, const Frustum& frustum, std::vector<uint32_t>& visible) const {
+
+	if (ids.size() < PARALLEL_CULL_MIN_OBJECTS) {
+		cull(kernel, frustum, visible);
+		return;
+	}
+
+	//the levels above the subtrees are not tested, a rejected subtree costs one node test in its job
+	jobs.parallelFor(static_cast<uint32_t>(subtrees.size()), 1, [&](uint32_t begin, uint32_t end) {
+		TRACE_ZONE("cull subtrees");
+		for (uint32_t i = begin; i < end; i++) {
+			subtreeVisible[i].clear();
+			cullSubtree(subtrees[i], kernel, frustum, subtreeVisible[i]);
+		}
+	});
+
+	visible.clear();
+	for (const std::vector<uint32_t>& subtree : subtreeVisible) {
+		visible.insert(visible.end(), subtree.begin(), subtree.end());
+	}
+}
+
+void CullingBvh::cullSubtree(uint32_t root, CullingKernel kernel, const Frustum& frustum, std::vector<uint32_t>& visible) const {
+
+	uint32_t stack[64];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = root;
+
+	while (stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+
+		//outside any plane rejects the whole subtree, inside all of them accepts it
+		bool intersects = false;
+		bool outside = false;
+		for (const glm::vec4& plane : frustum.planes) {
+			float distance = plane.x * node.center.x + plane.y * node.center.y + plane.z * node.center.z + plane.w;
+			float radius = std::abs(plane.x) * node.extent.x + std::abs(plane.y) * node.extent.y + std::abs(plane.z) * node.extent.z;
+			if (distance + radius < 0.0f) {
+				outside = true;
+				break;
+			}
+			intersects = intersects || distance - radius < 0.0f;
+		}
+
+		if (outside) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			if (intersects) {
+				cullBoxes(kernel, frustum, boxes, ids.data(), node.first, node.first + node.count, visible);
+			}
+			else {
+				visible.insert(visible.end(), ids.begin() + node.first, ids.begin() + node.first + node.count);
+			}
+			continue;
+		}
+
+		if (!intersects) {
+			//every leaf below is a contiguous run of ids, so the whole subtree is one range
+			const Node* leftmost = &node;
+			while (leftmost->count == 0) {
+				leftmost = &nodes[leftmost->first];
+			}
+			const Node* rightmost = &node;
+			while (rightmost->count == 0) {
+				rightmost = &nodes[rightmost->first + 1];
+			}
+			visible.insert(visible.end(), ids.begin() + leftmost->first, ids.begin() + rightmost->first + rightmost->count);
+			continue;
+		}
+
+		//median splits keep the depth at log2 of the leaf count, far below the stack size
+		stack[stackSize++] = node.first + 1;
+		stack[stackSize++] = node.first;
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.h"
+#include "JobSystem.h"
+
+
+//CPU frustum culling of scene objects, boxes are kept as structure of arrays so the SIMD kernels test 4 (SSE) or 8 (AVX2) per step
+//the scalar kernel is the reference the SIMD kernels have to agree with
+
+enum class CullingKernel {
+	Scalar,
+	SSE,
+	AVX2
+};
+
+//widest kernel the CPU runs, decided once at runtime
+CullingKernel bestCullingKernel();
+const char* cullingKernelName(CullingKernel);
+
+//world space boxes of the objects, index i is object i
+struct CullingBoxes {
+
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void resize(size_t);
+	void set(size_t, const glm::vec3& center, const glm::vec3& extent);
+	size_t size() const { return centerX.size(); }
+
+};
+
+//appends ids[i] of every box in [begin, end) that is at least partly inside the frustum
+void cullBoxes(CullingKernel, const Frustum&, const CullingBoxes&, const uint32_t* ids, size_t begin, size_t end, std::vector<uint32_t>& visible);
+
+//bounding volume hierarchy over the object boxes, rebuilt when objects move
+//nodes fully inside the frustum emit their objects without testing them, partly visible leaves run the SIMD kernel
+class CullingBvh {
+
+public:
+
+	void build(const CullingBoxes&);
+
+	//visible object ids in BVH order, visible is cleared first
+	void cull(CullingKernel, const Frustum&, std::vector<uint32_t>& visible) const;
+
+	//same result, the subtrees below the top levels are culled as jobs and joined in BVH order
+	void cull(JobSystem&, CullingKernel, const Frustum&, std::vector<uint32_t>& visible) const;
+
+	size_t nodeCount() const { return nodes.size(); }
+
+private:
+
+	struct Node {
+		glm::vec3 center;
+		glm::vec3 extent;
+
+		//interior nodes store the index of their first child, the second follows it
+		uint32_t first;
+		uint32_t count; // objects in a leaf, 0 for interior nodes
+	};
+
+	void buildNode(uint32_t index, uint32_t begin, uint32_t end, const CullingBoxes&);
+	void gatherSubtrees(uint32_t index, uint32_t depth);
+
+	//appends the visible objects below nodes[root]
+	void cullSubtree(uint32_t root, CullingKernel, const Frustum&, std::vector<uint32_t>& visible) const;
+
+	std::vector<Node> nodes;
+
+	//roots of the subtrees handed to jobs, left to right, and the output of each
+	std::vector<uint32_t> subtrees;
+	mutable std::vector<std::vector<uint32_t>> subtreeVisible;
+
+	//object boxes reordered so every leaf is a contiguous range
+	CullingBoxes boxes;
+	std::vector<uint32_t> ids;
+
+};
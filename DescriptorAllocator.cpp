@@ -0,0 +1,249 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+
+//descriptors of each type a pool holds per set, covers what the renderer's layouts use with room to spare
+static const std::pair<VkDescriptorType, uint32_t> POOL_RATIOS[] = {
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 }
+};
+
+//growing pools stops here, later pools of a long chain all get this many sets
+static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+DescriptorInfo bufferDescriptor(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+
+	DescriptorInfo info;
+	memset(&info, 0, sizeof(info));
+	info.buffer.buffer = buffer;
+	info.buffer.offset = offset;
+	info.buffer.range = range;
+	return info;
+}
+
+DescriptorInfo imageDescriptor(VkImageView view, VkSampler sampler, VkImageLayout layout) {
+
+	DescriptorInfo info;
+	memset(&info, 0, sizeof(info));
+	info.image.sampler = sampler;
+	info.image.imageView = view;
+	info.image.imageLayout = layout;
+	return info;
+}
+
+//FNV-1a, the contents are a few dozen bytes of handles and offsets
+static uint64_t hashContents(VkDescriptorSetLayout layout, const std::vector<DescriptorInfo>& contents) {
+
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	mix(&layout, sizeof(layout));
+	mix(contents.data(), contents.size() * sizeof(DescriptorInfo));
+	return hash;
+}
+
+void DescriptorAllocator::init(VkDevice device, uint32_t framesInFlight, uint32_t setsPerPool) {
+
+	this->device = device;
+	this->framesInFlight = framesInFlight;
+	this->setsPerPool = setsPerPool;
+
+	PoolChain empty;
+	empty.nextPoolSets = setsPerPool;
+	frames.assign(framesInFlight, empty);
+	persistent = empty;
+}
+
+void DescriptorAllocator::destroy() {
+
+	//sets go with their pools
+	for (PoolChain& chain : frames) {
+		for (VkDescriptorPool pool : chain.pools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+	}
+	for (VkDescriptorPool pool : persistent.pools) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	frames.clear();
+	persistent = PoolChain();
+	cache.clear();
+	stats = DescriptorStats();
+}
+
+DescriptorLayout DescriptorAllocator::createLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+
+	DescriptorLayout result;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &result.layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout!");
+	}
+
+	//one entry per binding reading consecutive DescriptorInfos, so a set is written by a single call from one array
+	std::vector<VkDescriptorUpdateTemplateEntry> entries;
+	for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+		VkDescriptorUpdateTemplateEntry entry{};
+		entry.dstBinding = binding.binding;
+		entry.dstArrayElement = 0;
+		entry.descriptorCount = binding.descriptorCount;
+		entry.descriptorType = binding.descriptorType;
+		entry.offset = result.descriptorCount * sizeof(DescriptorInfo);
+		entry.stride = sizeof(DescriptorInfo);
+		entries.push_back(entry);
+		result.descriptorCount += binding.descriptorCount;
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+	templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateInfo.pDescriptorUpdateEntries = entries.data();
+	templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateInfo.descriptorSetLayout = result.layout;
+
+	if (vkCreateDescriptorUpdateTemplate(device, &templateInfo, nullptr, &result.updateTemplate) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor update template!");
+	}
+
+	return result;
+}
+
+void DescriptorAllocator::destroyLayout(DescriptorLayout& layout) {
+
+	vkDestroyDescriptorUpdateTemplate(device, layout.updateTemplate, nullptr);
+	vkDestroyDescriptorSetLayout(device, layout.layout, nullptr);
+	layout = DescriptorLayout();
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frame) {
+
+	currentFrame = frame;
+
+	PoolChain& chain = frames[frame];
+	for (size_t i = 0; i <= chain.current && i < chain.pools.size(); i++) {
+		vkResetDescriptorPool(device, chain.pools[i], 0);
+	}
+	chain.current = 0;
+
+	stats.frameAllocations = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::allocateFrame(const DescriptorLayout& layout, const std::vector<DescriptorInfo>& contents) {
+
+	if (contents.size() != layout.descriptorCount) {
+		throw std::runtime_error("Failed to allocate descriptor set, contents do not match the layout!");
+	}
+
+	VkDescriptorSet set = allocate(frames[currentFrame], layout.layout);
+	vkUpdateDescriptorSetWithTemplate(device, set, layout.updateTemplate, contents.data());
+
+	stats.frameAllocations++;
+	stats.peakFrameAllocations = std::max(stats.peakFrameAllocations, stats.frameAllocations);
+	return set;
+}
+
+VkDescriptorSet DescriptorAllocator::getCached(const DescriptorLayout& layout, const std::vector<DescriptorInfo>& contents) {
+
+	if (contents.size() != layout.descriptorCount) {
+		throw std::runtime_error("Failed to allocate descriptor set, contents do not match the layout!");
+	}
+
+	std::vector<CachedSet>& bucket = cache[hashContents(layout.layout, contents)];
+	for (const CachedSet& cached : bucket) {
+		if (cached.layout == layout.layout && memcmp(cached.contents.data(), contents.data(), contents.size() * sizeof(DescriptorInfo)) == 0) {
+			stats.cacheHits++;
+			return cached.set;
+		}
+	}
+
+	VkDescriptorSet set = allocate(persistent, layout.layout);
+	vkUpdateDescriptorSetWithTemplate(device, set, layout.updateTemplate, contents.data());
+	bucket.push_back({ layout.layout, contents, set });
+
+	stats.persistentAllocations++;
+	stats.cachedSets++;
+	return set;
+}
+
+DescriptorStats DescriptorAllocator::getStats() const {
+	return stats;
+}
+
+void DescriptorAllocator::printStats() const {
+
+	std::cout << "Descriptors: " << stats.poolCount << " pools, " << stats.cachedSets << " cached sets (" << stats.cacheHits << " cache hits), "
+		<< stats.frameAllocations << " per frame sets this frame, peak " << stats.peakFrameAllocations << std::endl;
+}
+
+//tries the current pool, then the next one, creating it when the chain runs out
+VkDescriptorSet DescriptorAllocator::allocate(PoolChain& chain, VkDescriptorSetLayout layout) {
+
+	VkDescriptorSetAllocateInfo allocationInfo{};
+	allocationInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocationInfo.descriptorSetCount = 1;
+	allocationInfo.pSetLayouts = &layout;
+
+	while (true) {
+		bool fresh = chain.current == chain.pools.size();
+		if (fresh) {
+			chain.pools.push_back(createPool(chain));
+		}
+
+		allocationInfo.descriptorPool = chain.pools[chain.current];
+
+		VkDescriptorSet set;
+		VkResult result = vkAllocateDescriptorSets(device, &allocationInfo, &set);
+		if (result == VK_SUCCESS) {
+			return set;
+		}
+
+		//a full pool is expected, anything else is a real failure
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+			throw std::runtime_error("Failed to allocate descriptor set!");
+		}
+
+		//an empty pool that cannot hold the set never will, the layout needs more of a type than POOL_RATIOS gives
+		if (fresh) {
+			throw std::runtime_error("Failed to allocate descriptor set, layout does not fit in a pool!");
+		}
+		chain.current++;
+	}
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(PoolChain& chain) {
+
+	std::vector<VkDescriptorPoolSize> sizes;
+	for (const auto& ratio : POOL_RATIOS) {
+		sizes.push_back({ ratio.first, ratio.second * chain.nextPoolSets });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+	poolInfo.pPoolSizes = sizes.data();
+	poolInfo.maxSets = chain.nextPoolSets;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor pool!");
+	}
+
+	//a chain that had to grow will likely grow again, later pools are bigger so the chain stays short
+	chain.nextPoolSets = std::min(chain.nextPoolSets * 2, MAX_SETS_PER_POOL);
+	stats.poolCount++;
+	return pool;
+}
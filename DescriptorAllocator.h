@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+
+//one descriptor as the update template reads it, buffer or image depending on the binding type
+//built through the helpers so unused bytes are zero and equal contents hash equally
+union DescriptorInfo {
+	VkDescriptorBufferInfo buffer;
+	VkDescriptorImageInfo image;
+};
+
+DescriptorInfo bufferDescriptor(VkBuffer, VkDeviceSize offset, VkDeviceSize range);
+DescriptorInfo imageDescriptor(VkImageView, VkSampler, VkImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+//set layout plus the update template that writes a whole set from one DescriptorInfo per descriptor, in binding order
+struct DescriptorLayout {
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+	uint32_t descriptorCount = 0;
+};
+
+struct DescriptorStats {
+
+	//pools across every frame and the persistent sets
+	uint32_t poolCount = 0;
+
+	//sets handed out since the last beginFrame, and the peak over all frames
+	uint32_t frameAllocations = 0;
+	uint32_t peakFrameAllocations = 0;
+
+	uint32_t persistentAllocations = 0;
+	uint32_t cachedSets = 0;
+	uint64_t cacheHits = 0;
+
+};
+
+//hands out descriptor sets from chains of pools, a full pool is never an error but the cue to move to the next one
+//per frame sets come from pools that beginFrame resets wholesale, nothing is freed one set at a time
+//sets that never change are cached by a hash of their layout and contents and written once through an update template
+class DescriptorAllocator {
+
+public:
+
+	//pools start at setsPerPool sets and double up to a limit, each holds poolRatios descriptors of a type per set
+	void init(VkDevice, uint32_t framesInFlight, uint32_t setsPerPool = 64);
+	void destroy();
+
+	DescriptorLayout createLayout(const std::vector<VkDescriptorSetLayoutBinding>&);
+	void destroyLayout(DescriptorLayout&);
+
+	//resets every pool of the frame, its fence must have signalled
+	void beginFrame(uint32_t frame);
+
+	//valid until beginFrame comes around to the same frame again
+	VkDescriptorSet allocateFrame(const DescriptorLayout&, const std::vector<DescriptorInfo>&);
+
+	//lives as long as the allocator, the same layout and contents always return the same set
+	VkDescriptorSet getCached(const DescriptorLayout&, const std::vector<DescriptorInfo>&);
+
+	DescriptorStats getStats() const;
+	void printStats() const;
+
+private:
+
+	//pools of one frame or of the persistent sets, filled front to back
+	//each chain grows on its own, a frame that needs many sets does not make the other chains start big
+	struct PoolChain {
+		std::vector<VkDescriptorPool> pools;
+		size_t current = 0;
+		uint32_t nextPoolSets = 0;
+	};
+
+	struct CachedSet {
+		VkDescriptorSetLayout layout;
+		std::vector<DescriptorInfo> contents;
+		VkDescriptorSet set;
+	};
+
+	VkDescriptorSet allocate(PoolChain&, VkDescriptorSetLayout);
+	VkDescriptorPool createPool(PoolChain&);
+
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t framesInFlight = 1;
+	uint32_t setsPerPool = 64;
+
+	std::vector<PoolChain> frames;
+	PoolChain persistent;
+	uint32_t currentFrame = 0;
+
+	//hash collisions with different contents share a bucket and are told apart by comparing the contents
+	std::unordered_map<uint64_t, std::vector<CachedSet>> cache;
+
+	DescriptorStats stats;
+
+};
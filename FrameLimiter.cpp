@@ -0,0 +1,36 @@
+#include "FrameLimiter.h"
+
+#include <thread>
+
+
+//the last part of the wait is spun so wake up latency of the OS does not make frames late
+static const std::chrono::microseconds SPIN_MARGIN(2000);
+
+
+void FrameLimiter::setTargetFps(double fps) {
+
+	targetFps = fps > 0.0 ? fps : 0.0;
+	period = targetFps > 0.0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / targetFps)) : std::chrono::steady_clock::duration(0);
+	nextFrame = {};
+}
+
+void FrameLimiter::wait() {
+
+	if (period.count() == 0) {
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now < nextFrame) {
+		if (nextFrame - now > SPIN_MARGIN) {
+			std::this_thread::sleep_until(nextFrame - SPIN_MARGIN);
+		}
+		while (std::chrono::steady_clock::now() < nextFrame) {
+			std::this_thread::yield();
+		}
+		now = nextFrame;
+	}
+
+	//deadlines advance by whole periods so the average rate holds, after a long frame the cadence restarts instead of rushing the next ones
+	nextFrame = now - nextFrame > period ? now + period : nextFrame + period;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+
+
+//caps the frame rate by blocking before the next swapchain image is acquired
+//sleeps until shortly before the deadline and spins the rest, OS sleeps can overshoot by a scheduler tick
+class FrameLimiter {
+
+public:
+
+	//0 turns the limiter off
+	void setTargetFps(double fps);
+	double getTargetFps() const { return targetFps; }
+
+	//returns once the next frame may start, right away when the limiter is off or the frame is late
+	void wait();
+
+private:
+
+	double targetFps = 0.0;
+	std::chrono::steady_clock::duration period{ 0 };
+	std::chrono::steady_clock::time_point nextFrame{};
+
+};
@@ -0,0 +1,51 @@
+#include "Frustum.h"
+
+
+Frustum extractFrustum(const glm::mat4& clip) {
+
+	//glm is column major, clip[column][row]
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++) {
+		rows[row] = glm::vec4(clip[0][row], clip[1][row], clip[2][row], clip[3][row]);
+	}
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+
+	//unit normals so the box test compares distances
+	for (glm::vec4& plane : frustum.planes) {
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f) {
+			plane /= length;
+		}
+	}
+
+	return frustum;
+}
+
+void transformBox(const glm::mat4& transform, const glm::vec3& center, const glm::vec3& extent, glm::vec3& outCenter, glm::vec3& outExtent) {
+
+	outCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+
+	//each axis of the box contributes the absolute value of its transformed direction
+	outExtent = glm::abs(glm::vec3(transform[0])) * extent.x + glm::abs(glm::vec3(transform[1])) * extent.y + glm::abs(glm::vec3(transform[2])) * extent.z;
+}
+
+bool isBoxVisible(const Frustum& frustum, const glm::vec3& center, const glm::vec3& extent) {
+
+	for (const glm::vec4& plane : frustum.planes) {
+		//distance of the center against the projected radius of the box onto the plane normal
+		float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+		float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+		if (distance + radius < 0.0f) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+
+//six planes pointing inward, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+//order is left, right, bottom, top, near, far
+struct Frustum {
+
+	glm::vec4 planes[6];
+
+};
+
+//extracts the planes from a clip matrix (proj * view * model), the planes are then in the space the matrix maps from
+//the matrices are built with glm's default -1..1 depth range, which keeps the near plane conservative for 0..1 as well
+Frustum extractFrustum(const glm::mat4& clip);
+
+//axis aligned box after an affine transform, still as center and half extent
+void transformBox(const glm::mat4& transform, const glm::vec3& center, const glm::vec3& extent, glm::vec3& outCenter, glm::vec3& outExtent);
+
+//conservative, boxes crossing a plane count as visible
+bool isBoxVisible(const Frustum&, const glm::vec3& center, const glm::vec3& extent);
@@ -0,0 +1,177 @@
+#include "GpuCulling.h"
+
+#include <stdexcept>
+
+
+//must match local_size_x in shaders/Cull.comp
+static const uint32_t CULL_GROUP_SIZE = 64;
+
+static_assert(sizeof(CullConstants) == 128, "CullConstants no longer fits the guaranteed push constant size");
+
+
+void GpuCulling::init(VkDevice device, DeviceMemoryAllocator& allocator, DescriptorAllocator& descriptors, VkPipelineCache pipelineCache, const std::vector<char>& shaderCode, const std::vector<VkBuffer>& objectBuffers, uint32_t objectCount) {
+
+	this->device = device;
+	this->allocator = &allocator;
+	this->descriptors = &descriptors;
+	this->objectBuffers = objectBuffers;
+	this->objectCount = objectCount;
+
+	uint32_t frameCount = static_cast<uint32_t>(objectBuffers.size());
+
+	//objects in, indirect commands and their count out
+	std::vector<VkDescriptorSetLayoutBinding> bindings(3);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	setLayout = descriptors.createLayout(bindings);
+
+	VkPushConstantRange constantRange{};
+	constantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	constantRange.offset = 0;
+	constantRange.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout.layout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &constantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline layout!");
+	}
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline!");
+	}
+
+	commandBuffers.resize(frameCount);
+	commandBuffersMemory.resize(frameCount);
+	countBuffers.resize(frameCount);
+	countBuffersMemory.resize(frameCount);
+
+	for (uint32_t i = 0; i < frameCount; i++) {
+		createBuffer(sizeof(VkDrawIndexedIndirectCommand) * objectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationStrategy::Buddy, commandBuffers[i], commandBuffersMemory[i]);
+		createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, AllocationStrategy::Pool, countBuffers[i], countBuffersMemory[i]);
+	}
+}
+
+void GpuCulling::destroy() {
+
+	if (device == VK_NULL_HANDLE) {
+		return;
+	}
+
+	for (size_t i = 0; i < commandBuffers.size(); i++) {
+		vkDestroyBuffer(device, commandBuffers[i], nullptr);
+		allocator->free(commandBuffersMemory[i]);
+		vkDestroyBuffer(device, countBuffers[i], nullptr);
+		allocator->free(countBuffersMemory[i]);
+	}
+	commandBuffers.clear();
+	countBuffers.clear();
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	descriptors->destroyLayout(setLayout);
+	objectBuffers.clear();
+
+	device = VK_NULL_HANDLE;
+}
+
+void GpuCulling::record(VkCommandBuffer commandBuffer, uint32_t frame, const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint32_t indexCount) {
+
+	CullConstants constants{};
+	for (int i = 0; i < 6; i++) {
+		constants.planes[i] = frustum.planes[i];
+	}
+	for (int axis = 0; axis < 3; axis++) {
+		constants.boundsCenter[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+		constants.boundsExtent[axis] = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+	}
+	constants.indexCount = indexCount;
+	constants.objectCount = objectCount;
+
+	//the shader appends with atomicAdd, start every frame from zero
+	vkCmdFillBuffer(commandBuffer, countBuffers[frame], 0, sizeof(uint32_t), 0);
+
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	//a per frame set, it goes back to the pool when beginFrame resets this frame's pools
+	VkDescriptorSet descriptorSet = descriptors->allocateFrame(setLayout, {
+		bufferDescriptor(objectBuffers[frame], 0, VK_WHOLE_SIZE),
+		bufferDescriptor(commandBuffers[frame], 0, VK_WHOLE_SIZE),
+		bufferDescriptor(countBuffers[frame], 0, VK_WHOLE_SIZE)
+	});
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	//commands and count are consumed by the indirect draw, the count is also read back on the host
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCulling::draw(VkCommandBuffer commandBuffer, uint32_t frame) {
+
+	vkCmdDrawIndexedIndirectCount(commandBuffer, commandBuffers[frame], 0, countBuffers[frame], 0, objectCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+uint32_t GpuCulling::visibleCount(uint32_t frame) const {
+
+	return *static_cast<const uint32_t*>(countBuffersMemory[frame].mapped);
+}
+
+void GpuCulling::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, AllocationStrategy strategy, VkBuffer& buffer, MemoryAllocation& memory) {
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling buffer!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	memory = allocator->allocate(memRequirements, properties, ResourceType::Linear, strategy);
+	vkBindBufferMemory(device, buffer, memory.memory, memory.offset);
+}
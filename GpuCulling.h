@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+#include "Frustum.h"
+#include "MemoryAllocator.h"
+
+
+//push constants of shaders/Cull.comp, laid out for std430 and exactly the 128 bytes every device guarantees
+struct CullConstants {
+
+	glm::vec4 planes[6];
+	float boundsCenter[3];
+	uint32_t indexCount;
+	float boundsExtent[3];
+	uint32_t objectCount;
+
+};
+
+//frustum culls the instance list on the GPU and draws the survivors with vkCmdDrawIndexedIndirectCount
+//each visible object becomes one indirect command whose firstInstance selects its entry in the instance buffer
+class GpuCulling {
+
+public:
+
+	//objectBuffers holds one instance buffer per frame in flight, created with VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+	//the descriptor set is taken from the frame's pools of the DescriptorAllocator every time the pass is recorded
+	void init(VkDevice, DeviceMemoryAllocator&, DescriptorAllocator&, VkPipelineCache, const std::vector<char>& shaderCode, const std::vector<VkBuffer>& objectBuffers, uint32_t objectCount);
+	void destroy();
+
+	//outside of a render pass, resets the draw count, culls and makes the commands visible to the indirect stage
+	//the DescriptorAllocator must have begun this frame
+	void record(VkCommandBuffer, uint32_t frame, const Frustum&, const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint32_t indexCount);
+
+	//inside the render pass, with the graphics pipeline and vertex buffers bound
+	void draw(VkCommandBuffer, uint32_t frame);
+
+	//draw count the GPU wrote for a frame, only valid once that frame's fence signalled
+	uint32_t visibleCount(uint32_t frame) const;
+
+private:
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	DescriptorAllocator* descriptors = nullptr;
+	uint32_t objectCount = 0;
+
+	DescriptorLayout setLayout;
+	std::vector<VkBuffer> objectBuffers;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	//per frame in flight, the count stays host visible so culling results can be read back
+	std::vector<VkBuffer> commandBuffers;
+	std::vector<MemoryAllocation> commandBuffersMemory;
+	std::vector<VkBuffer> countBuffers;
+	std::vector<MemoryAllocation> countBuffersMemory;
+
+	void createBuffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, AllocationStrategy, VkBuffer&, MemoryAllocation&);
+
+};
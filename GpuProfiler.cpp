@@ -0,0 +1,236 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount) {
+
+	this->device = device;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	//timestampComputeAndGraphics promises timestamps on every graphics queue, without it the family has to report valid bits itself
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+	uint32_t validBits = queueFamilyProperties[queueFamily].timestampValidBits;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	supported = validBits > 0;
+
+	if (!supported) {
+		std::cout << "Graphics queue has no timestamps" << (deviceProperties.limits.timestampComputeAndGraphics ? "" : " (timestampComputeAndGraphics is false)") << ", GPU profiling disabled" << std::endl;
+		return;
+	}
+
+	frames.resize(frameCount);
+	for (Frame& frame : frames) {
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = MAX_QUERIES;
+
+		if (vkCreateQueryPool(device, &queryInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create profiler query pool!");
+		}
+	}
+}
+
+void GpuProfiler::destroy() {
+
+	for (Frame& frame : frames) {
+		vkDestroyQueryPool(device, frame.pool, nullptr);
+	}
+	frames.clear();
+	recording = nullptr;
+	openScopes.clear();
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+
+	if (!supported) {
+		return;
+	}
+
+	Frame& frame = frames[frameIndex];
+	collect(frame);
+
+	//scopes of a recording that was never submitted are dropped here unread
+	vkCmdResetQueryPool(commandBuffer, frame.pool, 0, MAX_QUERIES);
+	frame.scopes.clear();
+	frame.usedQueries = 0;
+	frame.submitted = false;
+
+	recording = &frame;
+	openScopes.clear();
+}
+
+void GpuProfiler::collectPending(uint32_t nextFrame) {
+
+	if (!supported) {
+		return;
+	}
+
+	for (size_t i = 0; i < frames.size(); i++) {
+		collect(frames[(nextFrame + i) % frames.size()]);
+	}
+	recording = nullptr;
+}
+
+void GpuProfiler::frameSubmitted(uint32_t frame) {
+
+	if (!supported) {
+		return;
+	}
+	frames[frame].submitted = true;
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name) {
+
+	if (!supported || recording == nullptr) {
+		return;
+	}
+
+	//the end query is reserved now so a full frame never leaves a scope without one
+	if (recording->usedQueries + 2 > MAX_QUERIES) {
+		openScopes.push_back(UINT32_MAX);
+		return;
+	}
+
+	FrameScope scope{ findScope(name), recording->usedQueries, recording->usedQueries + 1 };
+	recording->usedQueries += 2;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, recording->pool, scope.beginQuery);
+	openScopes.push_back(static_cast<uint32_t>(recording->scopes.size()));
+	recording->scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer) {
+
+	if (!supported || recording == nullptr || openScopes.empty()) {
+		return;
+	}
+
+	uint32_t open = openScopes.back();
+	openScopes.pop_back();
+	if (open == UINT32_MAX) {
+		return;
+	}
+
+	//bottom of pipe waits for every earlier command of the buffer to finish
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, recording->pool, recording->scopes[open].endQuery);
+}
+
+void GpuProfiler::setHistorySize(size_t size) {
+
+	//shrinking drops every sample so the ring starts over in order
+	historySize = std::max<size_t>(size, 1);
+	for (Scope& scope : scopes) {
+		if (scope.history.size() > historySize) {
+			scope.history.clear();
+			scope.next = 0;
+		}
+	}
+}
+
+void GpuProfiler::addSample(const std::string& name, double milliseconds) {
+	addSample(findScope(name), milliseconds);
+}
+
+void GpuProfiler::addSample(uint32_t scopeIndex, double milliseconds) {
+
+	Scope& scope = scopes[scopeIndex];
+	if (scope.history.size() < historySize) {
+		scope.history.push_back(milliseconds);
+	}
+	else {
+		scope.history[scope.next] = milliseconds;
+	}
+	scope.next = (scope.next + 1) % historySize;
+	scope.samples++;
+	scope.last = milliseconds;
+}
+
+std::vector<GpuScopeStats> GpuProfiler::getStats() const {
+
+	std::vector<GpuScopeStats> stats;
+	for (const Scope& scope : scopes) {
+		if (scope.history.empty()) {
+			continue;
+		}
+
+		std::vector<double> sorted = scope.history;
+		std::sort(sorted.begin(), sorted.end());
+
+		GpuScopeStats scopeStats;
+		scopeStats.name = scope.name;
+		scopeStats.samples = scope.samples;
+		scopeStats.lastMilliseconds = scope.last;
+		for (double sample : sorted) {
+			scopeStats.averageMilliseconds += sample;
+		}
+		scopeStats.averageMilliseconds /= sorted.size();
+		scopeStats.p50Milliseconds = sorted[(sorted.size() - 1) * 50 / 100];
+		scopeStats.p95Milliseconds = sorted[(sorted.size() - 1) * 95 / 100];
+		scopeStats.p99Milliseconds = sorted[(sorted.size() - 1) * 99 / 100];
+		stats.push_back(scopeStats);
+	}
+	return stats;
+}
+
+void GpuProfiler::printStats(std::ostream& out) const {
+
+	std::vector<GpuScopeStats> stats = getStats();
+	if (stats.empty()) {
+		out << "No GPU timings recorded" << std::endl;
+		return;
+	}
+
+	out << "GPU time in ms over the last " << historySize << " frames (avg / p50 / p95 / p99):" << std::endl;
+	for (const GpuScopeStats& scope : stats) {
+		out << "  " << std::left << std::setw(16) << scope.name << std::right << std::fixed << std::setprecision(3)
+			<< scope.averageMilliseconds << " / " << scope.p50Milliseconds << " / " << scope.p95Milliseconds << " / " << scope.p99Milliseconds << std::endl;
+	}
+	out.unsetf(std::ios::fixed);
+}
+
+uint32_t GpuProfiler::findScope(const std::string& name) {
+
+	//a frame has a handful of scopes, a linear search beats hashing the name
+	for (uint32_t i = 0; i < scopes.size(); i++) {
+		if (scopes[i].name == name) {
+			return i;
+		}
+	}
+	scopes.push_back({ name });
+	return static_cast<uint32_t>(scopes.size() - 1);
+}
+
+void GpuProfiler::collect(Frame& frame) {
+
+	//the reset recorded for an unsubmitted frame never ran, the pool still holds the results of the slot's last submit
+	if (!frame.submitted || frame.usedQueries == 0) {
+		return;
+	}
+
+	//read once, the slot's next beginFrame or collectPending must not add the same samples again
+	frame.submitted = false;
+
+	//no wait flag, results the GPU has not written yet are skipped
+	std::vector<uint64_t> ticks(frame.usedQueries);
+	VkResult result = vkGetQueryPoolResults(device, frame.pool, 0, frame.usedQueries, ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	for (const FrameScope& scope : frame.scopes) {
+		uint64_t elapsed = (ticks[scope.endQuery] - ticks[scope.beginQuery]) & timestampMask;
+		addSample(scope.scope, static_cast<double>(elapsed) * timestampPeriod / 1e6);
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+
+//timings of one named scope over the last samples
+struct GpuScopeStats {
+
+	std::string name;
+	uint32_t samples = 0;
+	double lastMilliseconds = 0.0;
+	double averageMilliseconds = 0.0;
+	double p50Milliseconds = 0.0;
+	double p95Milliseconds = 0.0;
+	double p99Milliseconds = 0.0;
+
+};
+
+//times regions of a command buffer with timestamp queries, one query pool per frame in flight
+//results of a frame are read when its slot comes around again, after the frame's fence, so reading never waits on the GPU
+//on queues without timestamps every call is a no-op
+class GpuProfiler {
+
+public:
+
+	void init(VkPhysicalDevice, VkDevice, uint32_t queueFamily, uint32_t frameCount);
+	void destroy();
+
+	bool isSupported() const { return supported; }
+
+	//first command of the frame's command buffer, outside a render pass, the frame's fence has to have signalled
+	//collects what this slot measured framesInFlight frames ago and resets its queries
+	void beginFrame(VkCommandBuffer, uint32_t frame);
+
+	//right after the frame's command buffer went to vkQueueSubmit, only submitted frames are ever read back
+	//a command buffer that is recorded again without a submit leaves the previous submit's results in the pool
+	void frameSubmitted(uint32_t frame);
+
+	//after vkDeviceWaitIdle, reads the frames whose slots never came around again, oldest first from the slot the next frame would use
+	void collectPending(uint32_t nextFrame);
+
+	//scopes nest, a scope is dropped when the frame runs out of queries
+	void beginScope(VkCommandBuffer, const std::string& name);
+	void endScope(VkCommandBuffer);
+
+	//samples kept per scope for the rolling average and percentiles, 256 unless changed
+	void setHistorySize(size_t);
+
+	//adds a time measured elsewhere, such as the copy queue timestamps of the upload service
+	void addSample(const std::string& name, double milliseconds);
+
+	//in the order the scopes were first seen
+	std::vector<GpuScopeStats> getStats() const;
+	void printStats(std::ostream&) const;
+
+private:
+
+	//queries per frame, two per scope
+	static const uint32_t MAX_QUERIES = 128;
+
+	struct Scope {
+		std::string name;
+		std::vector<double> history; // ring of the last historySize samples
+		size_t next = 0;
+		uint32_t samples = 0;
+		double last = 0.0;
+	};
+
+	//a scope written into a frame, resolved when the frame's results are read
+	struct FrameScope {
+		uint32_t scope;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	struct Frame {
+		VkQueryPool pool = VK_NULL_HANDLE;
+		std::vector<FrameScope> scopes;
+		uint32_t usedQueries = 0;
+		bool submitted = false;
+	};
+
+	uint32_t findScope(const std::string& name);
+	void addSample(uint32_t scope, double milliseconds);
+	void collect(Frame&);
+
+	VkDevice device = VK_NULL_HANDLE;
+	bool supported = false;
+	uint64_t timestampMask = 0;
+	float timestampPeriod = 1.0f;
+
+	std::vector<Frame> frames;
+	Frame* recording = nullptr;
+
+	//indices into recording->scopes of the scopes still open
+	std::vector<uint32_t> openScopes;
+
+	std::vector<Scope> scopes;
+	size_t historySize = 256;
+
+};
@@ -0,0 +1,367 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "CpuTrace.h"
+
+
+struct Job {
+	JobSystem::JobFunction function;
+	JobCounter* counter;
+};
+
+//which system and which deque the running thread belongs to
+static thread_local const JobSystem* threadSystem = nullptr;
+static thread_local uint32_t threadIndex = 0;
+
+//idle threads try this many times before going to sleep
+static const int IDLE_SPINS = 64;
+
+
+JobDeque::JobDeque() : buffer(CAPACITY) {
+}
+
+bool JobDeque::push(Job* job) {
+
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY) {
+		return false;
+	}
+
+	buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+
+	//publishes the job to thieves that read bottom with acquire
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+Job* JobDeque::pop() {
+
+	//claim the bottom slot first, a thief that read the old bottom then races for it through top
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		//was empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		//last job, whoever moves top first gets it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* JobDeque::steal() {
+
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b) {
+		return nullptr;
+	}
+
+	//the slot can only be reused once top moved past it, so a stale read always loses the exchange
+	Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	return job;
+}
+
+bool JobDeque::empty() const {
+	return bottom.load() <= top.load();
+}
+
+
+uint32_t JobSystem::defaultWorkerCount() {
+	return std::max(1u, std::thread::hardware_concurrency()) - 1;
+}
+
+void JobSystem::init(uint32_t workerCount) {
+
+	if (threadSystem != nullptr) {
+		throw std::runtime_error("Failed to create job system, the calling thread already belongs to one!");
+	}
+
+	uint32_t threadCount = workerCount + 1;
+	for (uint32_t thread = 0; thread < threadCount; thread++) {
+		deques.push_back(std::make_unique<JobDeque>());
+		randomStates.push_back(thread * 0x9E3779B9u + 1);
+	}
+
+	threadSystem = this;
+	threadIndex = 0;
+
+	stopping = false;
+	for (uint32_t thread = 1; thread < threadCount; thread++) {
+		workers.emplace_back(&JobSystem::workerLoop, this, thread);
+	}
+}
+
+void JobSystem::destroy() {
+
+	if (deques.empty()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	sleepCondition.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	//jobs nobody waited for are dropped
+	for (std::unique_ptr<JobDeque>& deque : deques) {
+		while (Job* job = deque->pop()) {
+			delete job;
+		}
+	}
+	deques.clear();
+	randomStates.clear();
+
+	if (threadSystem == this) {
+		threadSystem = nullptr;
+	}
+}
+
+uint32_t JobSystem::currentThread() const {
+
+	if (threadSystem != this) {
+		throw std::runtime_error("Failed to find job thread, jobs can only be used from threads of the job system!");
+	}
+	return threadIndex;
+}
+
+void JobSystem::run(JobFunction function, JobCounter* counter, JobCounter* dependency) {
+
+	Job* job = new Job{ std::move(function), counter };
+	if (counter) {
+		counter->pending.fetch_add(1);
+	}
+
+	if (dependency) {
+		//finish() empties the list under the same lock after the count reaches zero
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (dependency->pending.load() > 0) {
+			dependency->continuations.push_back(job);
+			return;
+		}
+	}
+
+	schedule(job);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+
+	uint32_t thread = currentThread();
+	while (!counter.isDone()) {
+		if (!runOne(thread)) {
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(counter.mutex);
+		std::swap(error, counter.error);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const RangeFunction& function) {
+
+	if (count == 0) {
+		return;
+	}
+
+	//a few batches per thread are enough for stealing to even out batches of uneven cost
+	uint64_t maxBatches = uint64_t(getThreadCount()) * 4;
+	uint64_t batchSize = std::max<uint64_t>({ grain, 1, (count + maxBatches - 1) / maxBatches });
+	uint64_t batchCount = (count + batchSize - 1) / batchSize;
+
+	if (batchCount == 1) {
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (uint64_t batch = 1; batch < batchCount; batch++) {
+		uint32_t begin = static_cast<uint32_t>(batch * batchSize);
+		uint32_t end = static_cast<uint32_t>(std::min<uint64_t>(count, (batch + 1) * batchSize));
+		run([&function, begin, end] { function(begin, end); }, &counter);
+	}
+
+	//the calling thread takes the first batch, it has to wait for the rest even if it throws
+	std::exception_ptr error;
+	try {
+		function(0, static_cast<uint32_t>(batchSize));
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+
+	try {
+		wait(counter);
+	}
+	catch (...) {
+		if (!error) {
+			error = std::current_exception();
+		}
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::workerLoop(uint32_t thread) {
+
+	threadSystem = this;
+	threadIndex = thread;
+	TRACE_THREAD_NAME("job worker " + std::to_string(thread));
+
+	while (!stopping.load()) {
+
+		bool found = false;
+		for (int spin = 0; spin < IDLE_SPINS && !found; spin++) {
+			found = runOne(thread);
+			if (!found) {
+				std::this_thread::yield();
+			}
+		}
+		if (found) {
+			continue;
+		}
+
+		//sleeping is counted before the deques are checked, schedule() checks it after pushing, so one of the two always sees the other
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleeping.fetch_add(1);
+		sleepCondition.wait(lock, [this] { return stopping.load() || hasQueuedJobs(); });
+		sleeping.fetch_sub(1);
+	}
+
+	threadSystem = nullptr;
+}
+
+bool JobSystem::runOne(uint32_t thread) {
+
+	Job* job = findJob(thread);
+	if (!job) {
+		return false;
+	}
+	execute(job);
+	return true;
+}
+
+Job* JobSystem::findJob(uint32_t thread) {
+
+	if (Job* job = deques[thread]->pop()) {
+		return job;
+	}
+
+	//xorshift, starting at a random victim keeps thieves from piling onto the same deque
+	uint32_t& state = randomStates[thread];
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	uint32_t threadCount = getThreadCount();
+	for (uint32_t i = 0; i < threadCount; i++) {
+		uint32_t victim = (state + i) % threadCount;
+		if (victim == thread) {
+			continue;
+		}
+		if (Job* job = deques[victim]->steal()) {
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::schedule(Job* job) {
+
+	if (!deques[currentThread()]->push(job)) {
+		execute(job);
+		return;
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load() > 0) {
+		//taking the lock makes sure a thread between its check and its wait gets the notification
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		sleepCondition.notify_one();
+	}
+}
+
+void JobSystem::execute(Job* job) {
+
+	JobCounter* counter = job->counter;
+	try {
+		job->function();
+	}
+	catch (...) {
+		if (!counter) {
+			delete job;
+			throw;
+		}
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if (!counter->error) {
+			counter->error = std::current_exception();
+		}
+	}
+	delete job;
+
+	finish(counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+
+	if (!counter) {
+		return;
+	}
+
+	//a waiter may destroy the counter as soon as it sees both pending and users at zero
+	counter->users.fetch_add(1);
+	if (counter->pending.fetch_sub(1) == 1) {
+		std::vector<Job*> ready;
+		{
+			std::lock_guard<std::mutex> lock(counter->mutex);
+			ready.swap(counter->continuations);
+		}
+		for (Job* job : ready) {
+			schedule(job);
+		}
+	}
+	counter->users.fetch_sub(1);
+}
+
+bool JobSystem::hasQueuedJobs() const {
+
+	for (const std::unique_ptr<JobDeque>& deque : deques) {
+		if (!deque->empty()) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//work stealing task scheduler, every thread owns a Chase-Lev deque
+//the owner pushes and pops at the bottom, idle threads steal from the top of someone else's deque
+//the thread calling init is thread 0 and runs jobs whenever it waits on a counter
+
+class JobSystem;
+struct Job;
+
+//counts unfinished jobs, a job started with a counter adds one and removes it when it returns
+//jobs started after a counter run once it drops to zero, which is how dependencies are expressed
+class JobCounter {
+
+public:
+
+	bool isDone() const { return pending.load() == 0 && users.load() == 0; }
+
+private:
+
+	friend class JobSystem;
+
+	std::atomic<uint32_t> pending{ 0 };
+
+	//threads still touching the counter after their decrement, wait() returns only once this is 0 too
+	std::atomic<uint32_t> users{ 0 };
+
+	std::mutex mutex;
+	std::vector<Job*> continuations;
+	std::exception_ptr error;
+
+};
+
+//single producer, multiple consumer deque of Chase and Lev with the memory orderings of Le et al.
+//fixed capacity, a full deque makes the owner run the job inline instead of growing
+class JobDeque {
+
+public:
+
+	static const int64_t CAPACITY = 4096;
+
+	JobDeque();
+
+	//owner only
+	bool push(Job*);
+	Job* pop();
+
+	//any thread
+	Job* steal();
+	bool empty() const;
+
+private:
+
+	alignas(64) std::atomic<int64_t> top{ 0 };
+	alignas(64) std::atomic<int64_t> bottom{ 0 };
+	std::vector<std::atomic<Job*>> buffer;
+
+};
+
+class JobSystem {
+
+public:
+
+	using JobFunction = std::function<void()>;
+
+	//begin and end of one batch of a parallelFor
+	using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+	//one less than the core count, the calling thread makes up the last one
+	static uint32_t defaultWorkerCount();
+
+	//workerCount threads are started next to the calling thread
+	void init(uint32_t workerCount);
+	void destroy();
+
+	//queues a job on the calling thread's deque, counter may be null
+	//with a dependency the job is held back until that counter drops to zero
+	//only jobs with a counter may throw, the exception is handed to whoever waits on it
+	void run(JobFunction, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	//runs other jobs until the counter is zero, rethrows the first exception a counted job threw
+	void wait(JobCounter&);
+
+	//calls function on batches of at least grain indices covering [0, count) and waits for all of them
+	void parallelFor(uint32_t count, uint32_t grain, const RangeFunction&);
+
+	//workers plus the thread that called init
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(deques.size()); }
+
+	//index of the calling thread, throws for threads the system does not know
+	uint32_t currentThread() const;
+
+private:
+
+	void workerLoop(uint32_t thread);
+	bool runOne(uint32_t thread);
+	Job* findJob(uint32_t thread);
+	void schedule(Job*);
+	void execute(Job*);
+	void finish(JobCounter*);
+	bool hasQueuedJobs() const;
+
+	std::vector<std::unique_ptr<JobDeque>> deques;
+	std::vector<std::thread> workers;
+
+	//per thread state of the steal victim picker
+	std::vector<uint32_t> randomStates;
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::atomic<uint32_t> sleeping{ 0 };
+	std::atomic<bool> stopping{ false };
+
+};
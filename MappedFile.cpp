@@ -0,0 +1,115 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+
+	close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		close();
+		return false;
+	}
+	length = static_cast<size_t>(fileSize.QuadPart);
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		close();
+		return false;
+	}
+
+	view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (view == nullptr) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close() {
+
+	if (view != nullptr) {
+		UnmapViewOfFile(view);
+		view = nullptr;
+	}
+	if (mapping != nullptr) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if (file != nullptr) {
+		CloseHandle(file);
+		file = nullptr;
+	}
+	length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+
+	close();
+
+	descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(descriptor, &fileStat) != 0 || fileStat.st_size == 0) {
+		close();
+		return false;
+	}
+	length = static_cast<size_t>(fileStat.st_size);
+
+	void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (address == MAP_FAILED) {
+		close();
+		return false;
+	}
+	view = static_cast<const uint8_t*>(address);
+
+	//the whole file is read front to back into staging memory, let the kernel read ahead
+	madvise(address, length, MADV_SEQUENTIAL);
+	madvise(address, length, MADV_WILLNEED);
+
+	return true;
+}
+
+void MappedFile::close() {
+
+	if (view != nullptr) {
+		munmap(const_cast<uint8_t*>(view), length);
+		view = nullptr;
+	}
+	if (descriptor >= 0) {
+		::close(descriptor);
+		descriptor = -1;
+	}
+	length = 0;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+//read only memory mapping of a whole file, the pages are only faulted in when touched
+class MappedFile {
+
+public:
+
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//returns false when the file does not exist or cannot be mapped
+	bool open(const std::string& path);
+	void close();
+
+	const uint8_t* data() const { return view; }
+	size_t size() const { return length; }
+	bool isOpen() const { return view != nullptr; }
+
+private:
+
+	const uint8_t* view = nullptr;
+	size_t length = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int descriptor = -1;
+#endif
+
+};
@@ -0,0 +1,225 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+
+//smallest buddy node and pool slot, keeps the bookkeeping small for tiny uniform buffers
+static const VkDeviceSize MIN_SUBALLOCATION_SIZE = 256;
+
+static VkDeviceSize nextPowerOfTwo(VkDeviceSize value) {
+	VkDeviceSize result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+
+void DeviceMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize preferredBlockSize) {
+
+	device = logicalDevice;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+	maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	//buddy blocks have to be a power of two
+	blockSize = nextPowerOfTwo(preferredBlockSize);
+}
+
+void DeviceMemoryAllocator::destroy() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& block : blocks) {
+		vkFreeMemory(device, block->memory, nullptr);
+	}
+	blocks.clear();
+	deviceAllocationCount = 0;
+}
+
+uint32_t DeviceMemoryAllocator::findMemoryType(uint32_t type, VkMemoryPropertyFlags properties) const {
+
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if (type & (1 << i) && ((memProperties.memoryTypes[i].propertyFlags & properties) == properties)) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+VkDeviceMemory DeviceMemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped) {
+
+	if (deviceAllocationCount >= maxAllocationCount) {
+		throw std::runtime_error("Exceeded maxMemoryAllocationCount!");
+	}
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate device memory block!");
+	}
+	deviceAllocationCount++;
+
+	//host visible memory stays mapped for its whole lifetime, it can only be mapped once
+	*mapped = nullptr;
+	if (memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+	}
+
+	return memory;
+}
+
+int32_t DeviceMemoryAllocator::createBlock(uint32_t memoryType, AllocationStrategy strategy, VkDeviceSize slotSize) {
+
+	auto block = std::make_unique<MemoryBlock>();
+	block->memoryType = memoryType;
+	block->strategy = strategy;
+	block->slotSize = slotSize;
+	block->memory = allocateDeviceMemory(blockSize, memoryType, &block->mapped);
+
+	switch (strategy) {
+	case AllocationStrategy::Linear:
+		block->metadata = std::make_unique<LinearBlockMetadata>(blockSize, bufferImageGranularity);
+		break;
+	case AllocationStrategy::Pool:
+		block->metadata = std::make_unique<PoolBlockMetadata>(blockSize, bufferImageGranularity, slotSize);
+		break;
+	case AllocationStrategy::Buddy:
+		block->metadata = std::make_unique<BuddyBlockMetadata>(blockSize, bufferImageGranularity,
+			nextPowerOfTwo(std::max(MIN_SUBALLOCATION_SIZE, bufferImageGranularity)));
+		break;
+	}
+
+	blocks.push_back(std::move(block));
+	return static_cast<int32_t>(blocks.size() - 1);
+}
+
+MemoryAllocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceType type, AllocationStrategy strategy) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryAllocation allocation{};
+	allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+	allocation.size = requirements.size;
+
+	//anything bigger than half a block would waste most of it, give it its own memory
+	if (requirements.size > blockSize / 2) {
+		allocation.memory = allocateDeviceMemory(requirements.size, allocation.memoryType, &allocation.mapped);
+		allocation.offset = 0;
+		allocation.block = -1;
+
+		dedicatedCount++;
+		dedicatedBytes += requirements.size;
+		return allocation;
+	}
+
+	VkDeviceSize slotSize = 0;
+	if (strategy == AllocationStrategy::Pool) {
+		slotSize = nextPowerOfTwo(std::max({ requirements.size, requirements.alignment, bufferImageGranularity, MIN_SUBALLOCATION_SIZE }));
+	}
+
+	int32_t blockIndex = -1;
+	VkDeviceSize offset = 0;
+
+	for (size_t i = 0; i < blocks.size(); i++) {
+		MemoryBlock& block = *blocks[i];
+
+		if (block.memoryType != allocation.memoryType || block.strategy != strategy || block.slotSize != slotSize) {
+			continue;
+		}
+
+		if (block.metadata->allocate(requirements.size, requirements.alignment, type, offset)) {
+			blockIndex = static_cast<int32_t>(i);
+			break;
+		}
+	}
+
+	//every existing block is full, open a new one
+	if (blockIndex < 0) {
+		blockIndex = createBlock(allocation.memoryType, strategy, slotSize);
+
+		if (!blocks[blockIndex]->metadata->allocate(requirements.size, requirements.alignment, type, offset)) {
+			throw std::runtime_error("Failed to sub-allocate from a new memory block!");
+		}
+	}
+
+	MemoryBlock& block = *blocks[blockIndex];
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.block = blockIndex;
+
+	if (block.mapped) {
+		allocation.mapped = static_cast<char*>(block.mapped) + offset;
+	}
+
+	return allocation;
+}
+
+void DeviceMemoryAllocator::free(MemoryAllocation& allocation) {
+
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (allocation.block < 0) {
+		//freeing implicitly unmaps
+		vkFreeMemory(device, allocation.memory, nullptr);
+		deviceAllocationCount--;
+		dedicatedCount--;
+		dedicatedBytes -= allocation.size;
+	}
+	else {
+		blocks[allocation.block]->metadata->free(allocation.offset);
+	}
+
+	allocation = MemoryAllocation{};
+}
+
+MemoryStats DeviceMemoryAllocator::getStats() const {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryStats stats{};
+	std::vector<const BlockMetadata*> metadata;
+
+	for (const auto& block : blocks) {
+		stats.blockCount++;
+		stats.allocationCount += block->metadata->allocationCount;
+		stats.bytesReserved += block->metadata->size;
+		stats.bytesUsed += block->metadata->used;
+		metadata.push_back(block->metadata.get());
+	}
+
+	stats.dedicatedCount = dedicatedCount;
+	stats.allocationCount += dedicatedCount;
+	stats.bytesReserved += dedicatedBytes;
+	stats.bytesUsed += dedicatedBytes;
+
+	//per block, free space that cannot be handed out in one piece
+	stats.fragmentation = blockFragmentation(metadata);
+
+	return stats;
+}
+
+void DeviceMemoryAllocator::printStats() const {
+
+	MemoryStats stats = getStats();
+
+	std::cout << "Device memory: " << stats.blockCount << " blocks, " << stats.dedicatedCount << " dedicated, "
+		<< stats.allocationCount << " allocations, " << stats.bytesUsed / 1024 << " KiB used of "
+		<< stats.bytesReserved / 1024 << " KiB reserved, fragmentation " << stats.fragmentation * 100.0f << "%" << std::endl;
+}
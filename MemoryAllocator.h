@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.h>
+
+#include "BlockMetadata.h"
+
+
+//how allocations are placed inside a block
+enum class AllocationStrategy {
+	Linear, // bump pointer, freed all at once when the block runs empty (staging, per frame data)
+	Pool,   // fixed size slots, O(1) allocate and free (uniform buffers, small objects)
+	Buddy   // power of two splitting, general purpose (vertex, index, textures)
+};
+
+//a sub allocation handed out to createBuffer/createImage
+struct MemoryAllocation {
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+
+	//persistently mapped pointer when the memory is host visible
+	void* mapped = nullptr;
+
+	uint32_t memoryType = 0;
+
+	//index into the allocator blocks, dedicated allocations own their memory
+	int32_t block = -1;
+
+};
+
+struct MemoryStats {
+
+	uint32_t blockCount = 0;
+	uint32_t dedicatedCount = 0;
+	uint32_t allocationCount = 0;
+	VkDeviceSize bytesReserved = 0;
+	VkDeviceSize bytesUsed = 0;
+
+	//1 - largest free range / total free space, 0 means all free space is contiguous
+	float fragmentation = 0.0f;
+
+};
+
+
+//carves buffers and images out of large per memory type blocks instead of one vkAllocateMemory per resource
+class DeviceMemoryAllocator {
+
+public:
+
+	void init(VkPhysicalDevice, VkDevice, VkDeviceSize blockSize = 64ull * 1024 * 1024);
+	void destroy();
+
+	MemoryAllocation allocate(const VkMemoryRequirements&, VkMemoryPropertyFlags, ResourceType, AllocationStrategy);
+	void free(MemoryAllocation&);
+
+	MemoryStats getStats() const;
+	void printStats() const;
+
+	VkDeviceSize bufferImageGranularity = 1;
+
+private:
+
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		uint32_t memoryType = 0;
+		AllocationStrategy strategy;
+		VkDeviceSize slotSize = 0; // pool blocks only
+		std::unique_ptr<BlockMetadata> metadata;
+	};
+
+	uint32_t findMemoryType(uint32_t, VkMemoryPropertyFlags) const;
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize, uint32_t, void**);
+	int32_t createBlock(uint32_t, AllocationStrategy, VkDeviceSize);
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memProperties{};
+	VkDeviceSize blockSize = 0;
+	uint32_t maxAllocationCount = 0;
+	uint32_t deviceAllocationCount = 0;
+
+	//blocks live until destroy() so allocation block indices stay valid
+	std::vector<std::unique_ptr<MemoryBlock>> blocks;
+
+	uint32_t dedicatedCount = 0;
+	VkDeviceSize dedicatedBytes = 0;
+
+	mutable std::mutex mutex;
+
+};
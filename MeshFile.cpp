@@ -0,0 +1,230 @@
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+
+static uint64_t alignStream(uint64_t offset) {
+	return (offset + MESH_STREAM_ALIGNMENT - 1) / MESH_STREAM_ALIGNMENT * MESH_STREAM_ALIGNMENT;
+}
+
+//round to nearest even, overflow goes to infinity and values below the half range flush to zero
+uint16_t floatToHalf(float value) {
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (((bits >> 23) & 0xFF) == 0xFF) {
+		return uint16_t(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+	}
+	if (exponent >= 31) {
+		return uint16_t(sign | 0x7C00);
+	}
+	if (exponent <= 0) {
+		if (exponent < -10) {
+			return uint16_t(sign);
+		}
+		//denormal half, shift the implicit one in
+		mantissa |= 0x800000;
+		uint32_t shift = uint32_t(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1))) {
+			half++;
+		}
+		return uint16_t(sign | half);
+	}
+
+	uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+		half++; // may carry into the exponent, which is the correct rounding
+	}
+	return uint16_t(half);
+}
+
+float halfToFloat(uint16_t half) {
+
+	uint32_t sign = uint32_t(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	if (exponent == 0) {
+		float value = std::ldexp(float(mantissa), -24);
+		return sign ? -value : value;
+	}
+
+	uint32_t bits = sign | ((exponent == 31 ? 255 : exponent - 15 + 127) << 23) | (mantissa << 13);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+void computeMeshBounds(const MeshData& mesh, float boundsMin[3], float boundsMax[3]) {
+
+	for (int axis = 0; axis < 3; axis++) {
+		boundsMin[axis] = mesh.vertices.empty() ? 0.0f : mesh.vertices[0].pos[axis];
+		boundsMax[axis] = boundsMin[axis];
+	}
+	for (const MeshVertex& vertex : mesh.vertices) {
+		for (int axis = 0; axis < 3; axis++) {
+			boundsMin[axis] = std::min(boundsMin[axis], vertex.pos[axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], vertex.pos[axis]);
+		}
+	}
+}
+
+std::vector<PackedMeshVertex> packMeshVertices(const MeshData& mesh, const float boundsMin[3], const float boundsMax[3]) {
+
+	std::vector<PackedMeshVertex> packed(mesh.vertices.size());
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const MeshVertex& vertex = mesh.vertices[i];
+		PackedMeshVertex& target = packed[i];
+
+		for (int axis = 0; axis < 3; axis++) {
+			//flat axes collapse to 0, the shader multiplies them by a zero extent
+			float extent = boundsMax[axis] - boundsMin[axis];
+			float normalized = extent > 0.0f ? (vertex.pos[axis] - boundsMin[axis]) / extent : 0.0f;
+			target.pos[axis] = uint16_t(std::lround(std::min(std::max(normalized, 0.0f), 1.0f) * 65535.0f));
+			target.color[axis] = uint8_t(std::lround(std::min(std::max(vertex.color[axis], 0.0f), 1.0f) * 255.0f));
+		}
+		target.pos[3] = 0;
+		target.color[3] = 255;
+
+		target.texture[0] = floatToHalf(vertex.texture[0]);
+		target.texture[1] = floatToHalf(vertex.texture[1]);
+	}
+
+	return packed;
+}
+
+bool writeMeshFile(const std::string& path, const MeshData& mesh, MeshVertexFormat format) {
+
+	MeshFileHeader header{};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	header.vertexFormat = static_cast<uint32_t>(format);
+	//16 bit indices whenever every vertex is addressable with them
+	header.indexSize = mesh.vertices.size() <= 65535 ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.streamCount = 2;
+	computeMeshBounds(mesh, header.boundsMin, header.boundsMax);
+
+	std::vector<PackedMeshVertex> packed;
+	const void* vertexData = mesh.vertices.data();
+	uint32_t vertexStride = sizeof(MeshVertex);
+	if (format == MeshVertexFormat::Packed) {
+		packed = packMeshVertices(mesh, header.boundsMin, header.boundsMax);
+		vertexData = packed.data();
+		vertexStride = sizeof(PackedMeshVertex);
+	}
+
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = mesh.indices.data();
+	if (header.indexSize == sizeof(uint16_t)) {
+		shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+		indexData = shortIndices.data();
+	}
+
+	MeshStreamHeader streams[2]{};
+	streams[0].type = static_cast<uint32_t>(MeshStreamType::Vertex);
+	streams[0].stride = vertexStride;
+	streams[0].offset = alignStream(sizeof(MeshFileHeader) + sizeof(streams));
+	streams[0].size = mesh.vertices.size() * vertexStride;
+
+	streams[1].type = static_cast<uint32_t>(MeshStreamType::Index);
+	streams[1].stride = header.indexSize;
+	streams[1].offset = alignStream(streams[0].offset + streams[0].size);
+	streams[1].size = mesh.indices.size() * header.indexSize;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	const char padding[MESH_STREAM_ALIGNMENT] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(streams), sizeof(streams));
+
+	file.write(padding, streams[0].offset - sizeof(header) - sizeof(streams));
+	file.write(static_cast<const char*>(vertexData), streams[0].size);
+
+	file.write(padding, streams[1].offset - streams[0].offset - streams[0].size);
+	file.write(static_cast<const char*>(indexData), streams[1].size);
+
+	return static_cast<bool>(file);
+}
+
+
+//the vertex shader would read past the vertex buffer for any index at or above vertexCount
+template <typename Index>
+static bool indicesInRange(const void* data, uint32_t indexCount, uint32_t vertexCount) {
+
+	const Index* indices = static_cast<const Index*>(data);
+	uint32_t highest = 0;
+	for (uint32_t i = 0; i < indexCount; i++) {
+		highest = std::max<uint32_t>(highest, indices[i]);
+	}
+	return indexCount == 0 || highest < vertexCount;
+}
+
+bool MeshFile::open(const std::string& path) {
+
+	if (!file.open(path)) {
+		return false;
+	}
+
+	if (file.size() < sizeof(MeshFileHeader)) {
+		file.close();
+		return false;
+	}
+
+	const MeshFileHeader& meshHeader = header();
+	bool valid = meshHeader.magic == MESH_FILE_MAGIC && meshHeader.version == MESH_FILE_VERSION &&
+		(meshHeader.indexSize == 2 || meshHeader.indexSize == 4) &&
+		sizeof(MeshFileHeader) + uint64_t(meshHeader.streamCount) * sizeof(MeshStreamHeader) <= file.size();
+
+	//every stream has to lie inside the mapping, the runtime copies them without further checks
+	for (uint32_t i = 0; valid && i < meshHeader.streamCount; i++) {
+		const MeshStreamHeader* streamHeader = reinterpret_cast<const MeshStreamHeader*>(file.data() + sizeof(MeshFileHeader)) + i;
+		valid = streamHeader->offset <= file.size() && streamHeader->size <= file.size() - streamHeader->offset;
+	}
+
+	const MeshStreamHeader* vertices = valid ? stream(MeshStreamType::Vertex) : nullptr;
+	const MeshStreamHeader* indices = valid ? stream(MeshStreamType::Index) : nullptr;
+	valid = vertices != nullptr && indices != nullptr &&
+		vertices->size == uint64_t(vertices->stride) * meshHeader.vertexCount &&
+		indices->size == uint64_t(meshHeader.indexSize) * meshHeader.indexCount;
+
+	//one pass over the mapped indices, far cheaper than the copy into staging that follows
+	if (valid) {
+		valid = meshHeader.indexSize == sizeof(uint16_t) ? indicesInRange<uint16_t>(streamData(*indices), meshHeader.indexCount, meshHeader.vertexCount)
+			: indicesInRange<uint32_t>(streamData(*indices), meshHeader.indexCount, meshHeader.vertexCount);
+	}
+
+	if (!valid) {
+		file.close();
+	}
+	return valid;
+}
+
+const MeshStreamHeader* MeshFile::stream(MeshStreamType type) const {
+
+	const MeshStreamHeader* streams = reinterpret_cast<const MeshStreamHeader*>(file.data() + sizeof(MeshFileHeader));
+
+	for (uint32_t i = 0; i < header().streamCount; i++) {
+		if (streams[i].type == static_cast<uint32_t>(type)) {
+			return &streams[i];
+		}
+	}
+	return nullptr;
+}
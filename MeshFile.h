@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+
+//binary mesh container written by tools/MeshConverter and mapped straight into staging memory at runtime
+//layout: MeshFileHeader, streamCount MeshStreamHeaders, then each stream's data aligned to MESH_STREAM_ALIGNMENT
+static const uint32_t MESH_FILE_MAGIC = 0x48534D52; // "RMSH"
+static const uint32_t MESH_FILE_VERSION = 1;
+static const uint64_t MESH_STREAM_ALIGNMENT = 16;
+
+enum class MeshStreamType : uint32_t {
+	Vertex = 0,
+	Index = 1
+};
+
+enum class MeshVertexFormat : uint32_t {
+	Float32 = 0, // MeshVertex, same layout as Verts::verts
+	Packed = 1   // PackedMeshVertex, same layout as Verts::packedVerts
+};
+
+struct MeshFileHeader {
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t vertexFormat;
+	uint32_t indexSize; // bytes per index, 2 or 4
+	uint32_t streamCount;
+	uint32_t reserved;
+	float boundsMin[3];
+	float boundsMax[3];
+
+};
+
+struct MeshStreamHeader {
+
+	uint32_t type;
+	uint32_t stride;
+	uint64_t offset; // from the start of the file
+	uint64_t size;
+
+};
+
+//tool side vertex, kept free of vulkan and glm so the converter and benchmarks build without them
+struct MeshVertex {
+
+	float pos[3];
+	float color[3];
+	float texture[2];
+
+};
+
+//quantized vertex, positions are unorm across the header bounds
+struct PackedMeshVertex {
+
+	uint16_t pos[4];
+	uint8_t color[4];
+	uint16_t texture[2];
+
+};
+
+uint16_t floatToHalf(float);
+float halfToFloat(uint16_t);
+
+//geometry while it is being imported, never used on the runtime path
+struct MeshData {
+
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+
+};
+
+void computeMeshBounds(const MeshData&, float boundsMin[3], float boundsMax[3]);
+std::vector<PackedMeshVertex> packMeshVertices(const MeshData&, const float boundsMin[3], const float boundsMax[3]);
+
+bool writeMeshFile(const std::string& path, const MeshData&, MeshVertexFormat = MeshVertexFormat::Float32);
+
+
+//read only view of a mapped mesh container, stream pointers stay valid until close
+class MeshFile {
+
+public:
+
+	//returns false when the file is missing, truncated, not a mesh container of this version or indexes past its vertices
+	bool open(const std::string& path);
+	void close() { file.close(); }
+
+	const MeshFileHeader& header() const { return *reinterpret_cast<const MeshFileHeader*>(file.data()); }
+
+	//null when the container has no stream of that type
+	const MeshStreamHeader* stream(MeshStreamType) const;
+	const void* streamData(const MeshStreamHeader& stream) const { return file.data() + stream.offset; }
+
+	size_t fileSize() const { return file.size(); }
+
+private:
+
+	MappedFile file;
+
+};
@@ -0,0 +1,483 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+
+	VertexCacheStats stats;
+
+	//timestamp of the last time a vertex entered the cache, a vertex is resident while it is among the last cacheSize entries
+	std::vector<uint32_t> entered(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+
+	for (uint32_t index : indices) {
+		if (time - entered[index] > cacheSize) {
+			entered[index] = time++;
+			stats.misses++;
+		}
+	}
+
+	size_t triangleCount = indices.size() / 3;
+	stats.acmr = triangleCount ? float(stats.misses) / triangleCount : 0.0f;
+	stats.atvr = vertexCount ? float(stats.misses) / vertexCount : 0.0f;
+
+	return stats;
+}
+
+
+//resolution of the overdraw views, the mesh is scaled to fit
+static const int OVERDRAW_VIEWPORT = 256;
+
+OverdrawStats analyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices) {
+
+	OverdrawStats stats;
+	if (indices.empty()) {
+		return stats;
+	}
+
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t index : indices) {
+		for (int axis = 0; axis < 3; axis++) {
+			minimum[axis] = std::min(minimum[axis], vertices[index].pos[axis]);
+			maximum[axis] = std::max(maximum[axis], vertices[index].pos[axis]);
+		}
+	}
+	float extent = std::max(maximum[0] - minimum[0], std::max(maximum[1] - minimum[1], maximum[2] - minimum[2]));
+	if (extent <= 0.0f) {
+		return stats;
+	}
+	float scale = (OVERDRAW_VIEWPORT - 1) / extent;
+
+	//two depth buffers, the winding convention does not matter and front faces never hide back faces
+	std::vector<float> depth(2 * OVERDRAW_VIEWPORT * OVERDRAW_VIEWPORT);
+
+	for (int axis = 0; axis < 3; axis++) {
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+		std::fill(depth.begin(), depth.end(), FLT_MAX);
+
+		for (size_t triangle = 0; triangle < indices.size() / 3; triangle++) {
+			float x[3], y[3], z[3];
+			for (int corner = 0; corner < 3; corner++) {
+				const float* position = vertices[indices[triangle * 3 + corner]].pos;
+				x[corner] = (position[u] - minimum[u]) * scale;
+				y[corner] = (position[v] - minimum[v]) * scale;
+				z[corner] = (position[axis] - minimum[axis]) * scale;
+			}
+
+			//edge on triangles cover nothing
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (area == 0.0f) {
+				continue;
+			}
+			float* buffer = &depth[area > 0.0f ? 0 : OVERDRAW_VIEWPORT * OVERDRAW_VIEWPORT];
+
+			int minX = std::max(0, int(std::floor(std::min(x[0], std::min(x[1], x[2])))));
+			int maxX = std::min(OVERDRAW_VIEWPORT - 1, int(std::ceil(std::max(x[0], std::max(x[1], x[2])))));
+			int minY = std::max(0, int(std::floor(std::min(y[0], std::min(y[1], y[2])))));
+			int maxY = std::min(OVERDRAW_VIEWPORT - 1, int(std::ceil(std::max(y[0], std::max(y[1], y[2])))));
+
+			//pixel centers inside the triangle pass the depth test or are rejected before shading
+			for (int py = minY; py <= maxY; py++) {
+				for (int px = minX; px <= maxX; px++) {
+					float cx = px + 0.5f;
+					float cy = py + 0.5f;
+					float w0 = ((x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1])) / area;
+					float w1 = ((x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2])) / area;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+						continue;
+					}
+
+					float fragment = w0 * z[0] + w1 * z[1] + w2 * z[2];
+					float& stored = buffer[py * OVERDRAW_VIEWPORT + px];
+					if (fragment < stored) {
+						stored = fragment;
+						stats.pixelsShaded++;
+					}
+				}
+			}
+		}
+
+		for (float value : depth) {
+			stats.pixelsCovered += value != FLT_MAX ? 1 : 0;
+		}
+	}
+
+	stats.overdraw = stats.pixelsCovered ? float(stats.pixelsShaded) / stats.pixelsCovered : 0.0f;
+	return stats;
+}
+
+
+void deduplicateVertices(MeshData& mesh) {
+
+	struct VertexHash {
+		const std::vector<MeshVertex>* vertices;
+
+		size_t operator()(uint32_t index) const {
+			//FNV-1a over the raw bytes, identical vertices are identical bit patterns
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&(*vertices)[index]);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(MeshVertex); i++) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return size_t(hash);
+		}
+	};
+
+	struct VertexEqual {
+		const std::vector<MeshVertex>* vertices;
+
+		bool operator()(uint32_t a, uint32_t b) const {
+			return memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(MeshVertex)) == 0;
+		}
+	};
+
+	std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> unique(mesh.vertices.size(), VertexHash{ &mesh.vertices }, VertexEqual{ &mesh.vertices });
+	std::vector<uint32_t> remap(mesh.vertices.size());
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (uint32_t i = 0; i < mesh.vertices.size(); i++) {
+		auto inserted = unique.emplace(i, uint32_t(vertices.size()));
+		if (inserted.second) {
+			vertices.push_back(mesh.vertices[i]);
+		}
+		remap[i] = inserted.first->second;
+	}
+
+	for (uint32_t& index : mesh.indices) {
+		index = remap[index];
+	}
+	mesh.vertices = std::move(vertices);
+}
+
+
+//tuning constants from Forsyth's paper, the cache being modelled is LRU
+static const uint32_t FORSYTH_CACHE_SIZE = 32;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+static float forsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+
+	//a vertex no triangle needs any more has no reason to stay
+	if (remainingTriangles == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			//used by the last triangle, prefer moving on slightly so strips do not spin in place
+			score = FORSYTH_LAST_TRIANGLE_SCORE;
+		}
+		else {
+			float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+
+	//finish off vertices with few triangles left so they do not get stranded
+	score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(float(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	//triangles per vertex as one flat adjacency array
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices) {
+		remaining[index]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++) {
+		adjacencyOffset[i + 1] = adjacencyOffset[i] + remaining[i];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t vertex = indices[triangle * 3 + corner];
+			adjacency[fill[vertex]++] = uint32_t(triangle);
+		}
+	}
+
+	std::vector<float> vertexScore(vertexCount);
+	std::vector<int> cachePosition(vertexCount, -1);
+	for (size_t i = 0; i < vertexCount; i++) {
+		vertexScore[i] = forsythVertexScore(-1, remaining[i]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+		triangleScore[triangle] = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] + vertexScore[indices[triangle * 3 + 2]];
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	//corners of emitted triangles, newest on top, the restart point when the cache offers no candidate
+	//a full rescan there would make meshes of many disconnected pieces quadratic
+	std::vector<uint32_t> deadEnd;
+	deadEnd.reserve(indices.size());
+
+	//first triangle that may not be emitted yet, only advances, for when the dead end stack runs dry as well
+	size_t scanStart = 0;
+	int64_t bestTriangle = -1;
+
+	while (output.size() < indices.size()) {
+
+		if (bestTriangle < 0) {
+			while (!deadEnd.empty() && remaining[deadEnd.back()] == 0) {
+				deadEnd.pop_back();
+			}
+
+			if (!deadEnd.empty()) {
+				uint32_t vertex = deadEnd.back();
+				float bestScore = -1.0f;
+				for (uint32_t i = 0; i < remaining[vertex]; i++) {
+					uint32_t triangle = adjacency[adjacencyOffset[vertex] + i];
+					if (triangleScore[triangle] > bestScore) {
+						bestScore = triangleScore[triangle];
+						bestTriangle = int64_t(triangle);
+					}
+				}
+			}
+			else {
+				while (emitted[scanStart]) {
+					scanStart++;
+				}
+				bestTriangle = int64_t(scanStart);
+			}
+		}
+
+		uint32_t corners[3] = { indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		emitted[bestTriangle] = true;
+		output.insert(output.end(), corners, corners + 3);
+		deadEnd.insert(deadEnd.end(), corners, corners + 3);
+
+		//remove the triangle from its vertices' adjacency so remaining counts stay exact
+		for (uint32_t vertex : corners) {
+			uint32_t* begin = &adjacency[adjacencyOffset[vertex]];
+			uint32_t* end = begin + remaining[vertex];
+			uint32_t* found = std::find(begin, end, uint32_t(bestTriangle));
+			std::swap(*found, *(end - 1));
+			remaining[vertex]--;
+		}
+
+		//the new triangle goes to the front, everything else shifts back and the tail falls out
+		nextCache.assign(corners, corners + 3);
+		for (uint32_t vertex : cache) {
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+				nextCache.push_back(vertex);
+			}
+		}
+		for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); i++) {
+			cachePosition[nextCache[i]] = -1;
+			vertexScore[nextCache[i]] = forsythVertexScore(-1, remaining[nextCache[i]]);
+		}
+		if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+			nextCache.resize(FORSYTH_CACHE_SIZE);
+		}
+		cache.swap(nextCache);
+
+		//rescore everything in the cache and pick the best triangle touching it
+		for (size_t i = 0; i < cache.size(); i++) {
+			cachePosition[cache[i]] = int(i);
+			vertexScore[cache[i]] = forsythVertexScore(int(i), remaining[cache[i]]);
+		}
+
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (uint32_t vertex : cache) {
+			for (uint32_t i = 0; i < remaining[vertex]; i++) {
+				uint32_t triangle = adjacency[adjacencyOffset[vertex] + i];
+				float score = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] + vertexScore[indices[triangle * 3 + 2]];
+				triangleScore[triangle] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = int64_t(triangle);
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold, uint32_t cacheSize) {
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	//the same FIFO as analyzeVertexCache, moving time past the cache size empties it
+	std::vector<uint32_t> entered(vertices.size(), 0);
+	uint32_t time = cacheSize + 1;
+	auto triangleMisses = [&](size_t triangle) {
+		uint32_t misses = 0;
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t vertex = indices[triangle * 3 + corner];
+			if (time - entered[vertex] > cacheSize) {
+				entered[vertex] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	//a triangle missing on all three vertices starts a new strip in the cache order, a cut there costs no cache hits
+	std::vector<uint32_t> stripStarts;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+		if (triangleMisses(triangle) == 3 || triangle == 0) {
+			stripStarts.push_back(uint32_t(triangle));
+		}
+	}
+	stripStarts.push_back(uint32_t(triangleCount));
+
+	//strips are cut further where the ACMR since the last cut, counted from an empty cache, is within threshold of the strip's
+	//(Sander, Nehab and Barczak, Fast triangle reordering for vertex locality and reduced overdraw), more clusters to sort for little cache loss
+	std::vector<uint32_t> clusterStarts;
+	for (size_t strip = 0; strip + 1 < stripStarts.size(); strip++) {
+		uint32_t begin = stripStarts[strip];
+		uint32_t end = stripStarts[strip + 1];
+
+		time += cacheSize + 1;
+		uint32_t stripMisses = 0;
+		for (uint32_t triangle = begin; triangle < end; triangle++) {
+			stripMisses += triangleMisses(triangle);
+		}
+		float limit = threshold * float(stripMisses) / float(end - begin);
+
+		clusterStarts.push_back(begin);
+		time += cacheSize + 1;
+		uint32_t clusterMisses = 0;
+		uint32_t clusterTriangles = 0;
+		for (uint32_t triangle = begin; triangle + 1 < end; triangle++) {
+			clusterMisses += triangleMisses(triangle);
+			clusterTriangles++;
+			if (float(clusterMisses) <= limit * float(clusterTriangles)) {
+				clusterStarts.push_back(triangle + 1);
+				time += cacheSize + 1;
+				clusterMisses = 0;
+				clusterTriangles = 0;
+			}
+		}
+	}
+	clusterStarts.push_back(uint32_t(triangleCount));
+
+	size_t clusterCount = clusterStarts.size() - 1;
+
+	//mesh centroid weighted by triangle area
+	double meshCenter[3] = {};
+	double meshArea = 0.0;
+	std::vector<double> clusterSort(clusterCount);
+	std::vector<double> clusterCenters(clusterCount * 3, 0.0);
+	std::vector<double> clusterNormals(clusterCount * 3, 0.0);
+
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		double clusterArea = 0.0;
+
+		for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++) {
+			const float* a = vertices[indices[triangle * 3]].pos;
+			const float* b = vertices[indices[triangle * 3 + 1]].pos;
+			const float* c = vertices[indices[triangle * 3 + 2]].pos;
+
+			double edge0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			double edge1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			double normal[3] = { edge0[1] * edge1[2] - edge0[2] * edge1[1], edge0[2] * edge1[0] - edge0[0] * edge1[2], edge0[0] * edge1[1] - edge0[1] * edge1[0] };
+			double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (int axis = 0; axis < 3; axis++) {
+				double center = (a[axis] + b[axis] + c[axis]) / 3.0;
+				clusterCenters[cluster * 3 + axis] += center * area;
+				clusterNormals[cluster * 3 + axis] += normal[axis];
+				meshCenter[axis] += center * area;
+			}
+			clusterArea += area;
+		}
+
+		for (int axis = 0; axis < 3; axis++) {
+			clusterCenters[cluster * 3 + axis] = clusterArea > 0.0 ? clusterCenters[cluster * 3 + axis] / clusterArea : 0.0;
+		}
+		meshArea += clusterArea;
+	}
+
+	for (int axis = 0; axis < 3; axis++) {
+		meshCenter[axis] = meshArea > 0.0 ? meshCenter[axis] / meshArea : 0.0;
+	}
+
+	//clusters facing away from the center are on the outside and likely to occlude the rest, draw them first
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		double* normal = &clusterNormals[cluster * 3];
+		double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		double dot = 0.0;
+		for (int axis = 0; axis < 3; axis++) {
+			dot += (clusterCenters[cluster * 3 + axis] - meshCenter[axis]) * (length > 0.0 ? normal[axis] / length : 0.0);
+		}
+		clusterSort[cluster] = dot;
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return clusterSort[a] > clusterSort[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (uint32_t cluster : order) {
+		output.insert(output.end(), indices.begin() + size_t(clusterStarts[cluster]) * 3, indices.begin() + size_t(clusterStarts[cluster + 1]) * 3);
+	}
+	indices.swap(output);
+}
+
+
+void optimizeVertexFetch(MeshData& mesh) {
+
+	const uint32_t unused = ~0u;
+	std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	//vertices nothing references are dropped here
+	for (uint32_t& index : mesh.indices) {
+		if (remap[index] == unused) {
+			remap[index] = uint32_t(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh.vertices = std::move(vertices);
+}
+
+
+void optimizeMesh(MeshData& mesh) {
+
+	deduplicateVertices(mesh);
+	optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	optimizeOverdraw(mesh.indices, mesh.vertices);
+	optimizeVertexFetch(mesh);
+}
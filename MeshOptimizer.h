@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshFile.h"
+
+
+//import time mesh processing, CPU only so the converter and benchmarks run without a GPU
+//optimizeMesh runs every stage in the order that keeps each one from undoing the previous
+
+struct VertexCacheStats {
+
+	uint32_t misses = 0;
+
+	//average cache miss ratio, vertex shader invocations per triangle, 0.5 is the ideal for large regular meshes
+	float acmr = 0.0f;
+
+	//average transformed vertex ratio, vertex shader invocations per vertex, 1.0 is the ideal
+	float atvr = 0.0f;
+
+};
+
+//replays the index buffer through a FIFO post transform cache of the given size
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+struct OverdrawStats {
+
+	uint64_t pixelsCovered = 0;
+	uint64_t pixelsShaded = 0;
+
+	//pixels shaded per covered pixel with an early depth test, 1.0 is the ideal
+	float overdraw = 0.0f;
+
+};
+
+//rasterizes the triangles in index order along the three axes, front and back faces into depth buffers of their own
+OverdrawStats analyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices);
+
+//merges bitwise identical vertices and remaps the indices
+void deduplicateVertices(MeshData&);
+
+//reorders triangles for post transform cache hits (Forsyth, linear speed vertex cache optimisation)
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+//reorders clusters of the cache optimized triangles so outward facing clusters draw first, keeps cache order inside clusters
+//clusters are cut as small as threshold allows, the ACMR of a cluster is at most threshold times that of the strip it was cut from
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold = 1.05f, uint32_t cacheSize = 16);
+
+//renumbers vertices in first use order so vertex fetch walks memory linearly
+void optimizeVertexFetch(MeshData&);
+
+void optimizeMesh(MeshData&);
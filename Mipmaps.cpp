@@ -0,0 +1,96 @@
+#include "Mipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+static float srgbToLinear(float value) {
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+		levels++;
+	}
+	return levels;
+}
+
+uint64_t mipChainLayout(uint32_t width, uint32_t height, std::vector<uint64_t>& levelOffsets) {
+
+	uint32_t levelCount = mipLevelCount(width, height);
+
+	levelOffsets.resize(levelCount);
+	uint64_t totalSize = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		levelOffsets[level] = totalSize;
+		totalSize += uint64_t(std::max(1u, width >> level)) * std::max(1u, height >> level) * 4;
+	}
+	return totalSize;
+}
+
+std::vector<uint8_t> buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb, std::vector<uint64_t>& levelOffsets) {
+
+	uint32_t levelCount = mipLevelCount(width, height);
+	uint64_t totalSize = mipChainLayout(width, height, levelOffsets);
+
+	std::vector<uint8_t> chain(static_cast<size_t>(totalSize));
+	std::copy(pixels, pixels + size_t(width) * height * 4, chain.begin());
+
+	//decoding through a table keeps the pow calls to one per output channel
+	float toLinear[256];
+	for (int value = 0; value < 256; value++) {
+		toLinear[value] = srgb ? srgbToLinear(value / 255.0f) : value / 255.0f;
+	}
+
+	//each level is filtered from the one above, the footprint of an output pixel covers 2 or 3 source pixels per axis
+	//so odd sizes do not drop the last row or column
+	for (uint32_t level = 1; level < levelCount; level++) {
+		uint32_t sourceWidth = std::max(1u, width >> (level - 1));
+		uint32_t sourceHeight = std::max(1u, height >> (level - 1));
+		uint32_t levelWidth = std::max(1u, width >> level);
+		uint32_t levelHeight = std::max(1u, height >> level);
+
+		const uint8_t* source = chain.data() + levelOffsets[level - 1];
+		uint8_t* destination = chain.data() + levelOffsets[level];
+
+		for (uint32_t y = 0; y < levelHeight; y++) {
+			uint32_t yBegin = y * sourceHeight / levelHeight;
+			uint32_t yEnd = (y + 1) * sourceHeight / levelHeight;
+
+			for (uint32_t x = 0; x < levelWidth; x++) {
+				uint32_t xBegin = x * sourceWidth / levelWidth;
+				uint32_t xEnd = (x + 1) * sourceWidth / levelWidth;
+
+				float sum[4] = {};
+				for (uint32_t sy = yBegin; sy < yEnd; sy++) {
+					const uint8_t* row = source + (size_t(sy) * sourceWidth + xBegin) * 4;
+					for (uint32_t sx = xBegin; sx < xEnd; sx++, row += 4) {
+						sum[0] += toLinear[row[0]];
+						sum[1] += toLinear[row[1]];
+						sum[2] += toLinear[row[2]];
+						//alpha is never sRGB encoded
+						sum[3] += row[3] / 255.0f;
+					}
+				}
+
+				float weight = 1.0f / float((yEnd - yBegin) * (xEnd - xBegin));
+				uint8_t* pixel = destination + (size_t(y) * levelWidth + x) * 4;
+				for (int channel = 0; channel < 4; channel++) {
+					float value = sum[channel] * weight;
+					if (srgb && channel < 3) {
+						value = linearToSrgb(value);
+					}
+					pixel[channel] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, value * 255.0f + 0.5f)));
+				}
+			}
+		}
+	}
+
+	return chain;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+//CPU mip chain generation for formats the GPU cannot blit with linear filtering
+//no Vulkan types so tools and benchmarks can use it without a device
+
+//levels down to 1x1, floor(log2(max(width, height))) + 1
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+//byte offset of every level of a packed RGBA8 chain down to 1x1, returns the size of the whole chain
+uint64_t mipChainLayout(uint32_t width, uint32_t height, std::vector<uint64_t>& levelOffsets);
+
+//box filters an RGBA8 image down to 1x1 and returns every level packed one after another, level 0 first
+//levelOffsets receives the byte offset of each level, srgb averages the color channels in linear space like the GPU does
+std::vector<uint8_t> buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb, std::vector<uint64_t>& levelOffsets);
@@ -0,0 +1,113 @@
+#include "ParallelRecorder.h"
+
+#include <stdexcept>
+
+#include "CpuTrace.h"
+
+
+void ParallelRecorder::init(VkDevice device, JobSystem& jobs, uint32_t queueFamily, uint32_t sliceCount, uint32_t frameCount) {
+
+	this->device = device;
+	this->jobs = &jobs;
+	this->sliceCount = sliceCount;
+
+	pools.resize(size_t(frameCount) * sliceCount);
+	buffers.resize(pools.size());
+
+	for (size_t i = 0; i < pools.size(); i++) {
+		//the whole pool is reset each frame, individual buffers never are
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = queueFamily;
+
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &pools[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create recording command pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = pools[i];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &buffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate secondary command buffer!");
+		}
+	}
+
+	recorded.reserve(sliceCount);
+	sliceUsed.assign(sliceCount, 0);
+}
+
+void ParallelRecorder::destroy() {
+
+	if (device == VK_NULL_HANDLE) {
+		return;
+	}
+
+	//destroying a pool frees its buffers
+	for (VkCommandPool pool : pools) {
+		vkDestroyCommandPool(device, pool, nullptr);
+	}
+	pools.clear();
+	buffers.clear();
+
+	device = VK_NULL_HANDLE;
+}
+
+const std::vector<VkCommandBuffer>& ParallelRecorder::record(uint32_t frame, VkRenderPass renderPass, VkFramebuffer framebuffer, uint32_t drawCount, const RecordSlice& recordFunction) {
+
+	VkCommandBufferInheritanceInfo inheritance{};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = renderPass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = framebuffer;
+
+	//one slice per batch, exceptions of any slice come back out of parallelFor
+	jobs->parallelFor(sliceCount, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t slice = begin; slice < end; slice++) {
+			recordSlice(slice, frame, drawCount, inheritance, recordFunction);
+		}
+	});
+
+	recorded.clear();
+	for (uint32_t slice = 0; slice < sliceCount; slice++) {
+		if (sliceUsed[slice]) {
+			recorded.push_back(buffers[size_t(frame) * sliceCount + slice]);
+		}
+	}
+	return recorded;
+}
+
+void ParallelRecorder::recordSlice(uint32_t slice, uint32_t frame, uint32_t drawCount, const VkCommandBufferInheritanceInfo& inheritance, const RecordSlice& recordFunction) {
+
+	//even split, slices differ by at most one draw
+	uint32_t begin = static_cast<uint32_t>(uint64_t(drawCount) * slice / sliceCount);
+	uint32_t end = static_cast<uint32_t>(uint64_t(drawCount) * (slice + 1) / sliceCount);
+
+	TRACE_ZONE("record slice");
+
+	sliceUsed[slice] = begin < end ? 1 : 0;
+	if (!sliceUsed[slice]) {
+		return;
+	}
+
+	size_t index = size_t(frame) * sliceCount + slice;
+	vkResetCommandPool(device, pools[index], 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+
+	if (vkBeginCommandBuffer(buffers[index], &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording secondary command buffer!");
+	}
+
+	recordFunction(buffers[index], begin, end);
+
+	if (vkEndCommandBuffer(buffers[index]) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record secondary command buffer!");
+	}
+}
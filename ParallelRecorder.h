@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "JobSystem.h"
+
+
+//records a draw list in slices as jobs, one secondary command buffer per slice
+//every slice owns a command pool per frame in flight, a slice runs in one job so a pool is never used by two threads at once
+class ParallelRecorder {
+
+public:
+
+	//records draws [begin, end) into a secondary buffer that is already begun inside the render pass
+	using RecordSlice = std::function<void(VkCommandBuffer, uint32_t begin, uint32_t end)>;
+
+	//the slices are spread over the threads of the job system, the calling thread records one of them too
+	void init(VkDevice, JobSystem&, uint32_t queueFamily, uint32_t sliceCount, uint32_t frameCount);
+	void destroy();
+
+	//blocks until every slice is recorded, the buffers come back in draw order for vkCmdExecuteCommands
+	//they stay valid until the same frame is recorded again
+	const std::vector<VkCommandBuffer>& record(uint32_t frame, VkRenderPass, VkFramebuffer, uint32_t drawCount, const RecordSlice&);
+
+	uint32_t getSliceCount() const { return sliceCount; }
+
+private:
+
+	void recordSlice(uint32_t slice, uint32_t frame, uint32_t drawCount, const VkCommandBufferInheritanceInfo&, const RecordSlice&);
+
+	VkDevice device = VK_NULL_HANDLE;
+	JobSystem* jobs = nullptr;
+	uint32_t sliceCount = 0;
+
+	//indexed frame * sliceCount + slice
+	std::vector<VkCommandPool> pools;
+	std::vector<VkCommandBuffer> buffers;
+
+	std::vector<VkCommandBuffer> recorded;
+	std::vector<uint8_t> sliceUsed; // not vector<bool>, every job writes its own element
+
+};
@@ -0,0 +1,165 @@
+#include "PipelineCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x43504C52; // "RLPC"
+static const uint32_t PIPELINE_CACHE_VERSION = 1;
+
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path) {
+
+	this->device = device;
+	this->path = path;
+
+	//driverUUID lives in the 1.1 id properties, pipelineCacheUUID alone does not change with every driver build
+	VkPhysicalDeviceIDProperties idProperties{};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &idProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	deviceHeader.magic = PIPELINE_CACHE_MAGIC;
+	deviceHeader.version = PIPELINE_CACHE_VERSION;
+	deviceHeader.vendorID = properties.properties.vendorID;
+	deviceHeader.deviceID = properties.properties.deviceID;
+	deviceHeader.driverVersion = properties.properties.driverVersion;
+	memcpy(deviceHeader.pipelineCacheUUID, properties.properties.pipelineCacheUUID, VK_UUID_SIZE);
+	memcpy(deviceHeader.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+
+	std::vector<char> data = readCacheFile();
+	warm = !data.empty();
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache!");
+	}
+
+	std::cout << "Pipeline cache " << (warm ? "loaded " + std::to_string(data.size()) + " bytes from " + path : "is cold") << std::endl;
+}
+
+void PipelineCache::destroy() {
+
+	if (cache == VK_NULL_HANDLE) {
+		return;
+	}
+
+	//another instance may have written the file since we loaded it, fold its pipelines in before overwriting
+	std::vector<char> diskData = readCacheFile();
+	if (!diskData.empty()) {
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = diskData.size();
+		cacheInfo.pInitialData = diskData.data();
+
+		VkPipelineCache diskCache;
+		if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &diskCache) == VK_SUCCESS) {
+			vkMergePipelineCaches(device, cache, 1, &diskCache);
+			vkDestroyPipelineCache(device, diskCache, nullptr);
+		}
+	}
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, cache, &dataSize, nullptr);
+
+	std::vector<char> data(dataSize);
+	if (dataSize > 0 && vkGetPipelineCacheData(device, cache, &dataSize, data.data()) == VK_SUCCESS) {
+		data.resize(dataSize);
+		if (!writeCacheFile(data)) {
+			std::cout << "Failed to write pipeline cache to " << path << std::endl;
+		}
+	}
+
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+std::vector<char> PipelineCache::readCacheFile() const {
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return {};
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(PipelineCacheFileHeader)) {
+		return {};
+	}
+	file.seekg(0);
+
+	PipelineCacheFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	//any mismatch means a different GPU, driver or file layout, start cold instead of feeding the driver stale data
+	if (header.magic != deviceHeader.magic || header.version != deviceHeader.version ||
+		header.vendorID != deviceHeader.vendorID || header.deviceID != deviceHeader.deviceID ||
+		header.driverVersion != deviceHeader.driverVersion ||
+		memcmp(header.pipelineCacheUUID, deviceHeader.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+		memcmp(header.driverUUID, deviceHeader.driverUUID, VK_UUID_SIZE) != 0 ||
+		header.dataSize != fileSize - sizeof(header)) {
+		return {};
+	}
+
+	std::vector<char> data(static_cast<size_t>(header.dataSize));
+	file.read(data.data(), data.size());
+	if (!file) {
+		return {};
+	}
+
+	//the driver blob carries its own header, check it agrees with ours
+	VkPipelineCacheHeaderVersionOne blobHeader;
+	if (data.size() < sizeof(blobHeader)) {
+		return {};
+	}
+	memcpy(&blobHeader, data.data(), sizeof(blobHeader));
+
+	if (blobHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		blobHeader.vendorID != deviceHeader.vendorID || blobHeader.deviceID != deviceHeader.deviceID ||
+		memcmp(blobHeader.pipelineCacheUUID, deviceHeader.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		return {};
+	}
+
+	return data;
+}
+
+//write next to the target and rename over it, a crash mid write leaves the old file intact
+bool PipelineCache::writeCacheFile(const std::vector<char>& data) const {
+
+	std::string tempPath = path + ".tmp";
+
+	PipelineCacheFileHeader header = deviceHeader;
+	header.dataSize = data.size();
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+		if (!file) {
+			return false;
+		}
+	}
+
+	//std::filesystem::rename replaces the target on windows too, unlike std::rename
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+
+//written in front of the driver blob so a cache from another GPU or driver is never handed to vkCreatePipelineCache
+struct PipelineCacheFileHeader {
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint8_t driverUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+
+};
+
+//VkPipelineCache that survives between runs, loaded on init and merged back to disk on destroy
+class PipelineCache {
+
+public:
+
+	void init(VkPhysicalDevice, VkDevice, const std::string& path);
+	void destroy();
+
+	VkPipelineCache get() const { return cache; }
+
+	//true when valid data from a previous run was loaded
+	bool isWarm() const { return warm; }
+
+private:
+
+	//returns the driver blob when the file exists and matches this device, empty otherwise
+	std::vector<char> readCacheFile() const;
+	bool writeCacheFile(const std::vector<char>&) const;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	std::string path;
+	bool warm = false;
+
+	PipelineCacheFileHeader deviceHeader{};
+
+};
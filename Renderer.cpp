@@ -1,8 +1,5 @@
 
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
 #define NOMINMAX //bug fix to make std::numeric_limits<size_t>::max() not use max() as a macro but as a function
 #include "Renderer.h"
 
@@ -11,10 +8,22 @@
 //structure implementation
 void Renderer::run() {
 
-	Renderer::initWindow();
+	//no window is needed when rendering offscreen
+	if (!headless) {
+		Renderer::initWindow();
+	}
+	TRACE_THREAD_NAME("main");
+	CpuTrace::setEnabled(!traceOutput.empty());
+
+	jobs.init(jobWorkers);
 	Renderer::initVulkan();
 	Renderer::renderLoop();
 	Renderer::cleanup();
+	jobs.destroy();
+
+	if (!traceOutput.empty()) {
+		writeTrace();
+	}
 	
 }
 
@@ -33,33 +42,70 @@ void Renderer::initWindow() {
     Renderer::window = glfwCreateWindow(Renderer::WIDTH, Renderer::HEIGHT,"Renderer v1.0",nullptr,nullptr);//last parameter is only relevant to OpenGL
 	glfwSetWindowUserPointer(window, this);
 	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+	glfwSetKeyCallback(window, keyCallback);
 }
 
 void Renderer::initVulkan() {
 
+	//per frame resources are indexed by frame, more than 3 only adds latency
+	if (framesInFlight < 1 || framesInFlight > 3) {
+		throw std::runtime_error("Failed to configure frames in flight, 1 to 3 are supported!");
+	}
+
+	if (headless) {
+		//offscreen rendering does not present so the swapchain extension is not required
+		deviceExtensions.clear();
+	}
+
 	Renderer::createInstance();
-	Renderer::createSurface();
+	if (!headless) {
+		Renderer::createSurface();
+	}
 	Renderer::searchPhysicalDevice();
 	Renderer::createLogicalDevice();
-	Renderer::createSwapChain();
+	memoryAllocator.init(physicalDevice, device);
+	Renderer::createUploadService();
+	if (usePipelineCache) {
+		pipelineCache.init(physicalDevice, device, pipelineCachePath);
+	}
+	if (headless) {
+		Renderer::createOffscreenTargets();
+	}
+	else {
+		Renderer::createSwapChain();
+	}
 	Renderer::createImageView();
 	Renderer::createRenderPass();
 	Renderer::createDescriptionSetLayout();
 	Renderer::createGraphicsPipeline();
 	Renderer::createFrameBuffers();
 	Renderer::createCommandPool();
+
+	//textures are decoded on the job system and submitted in batches of their own
 	Renderer::createTexture();
+
+	//all other startup copies and layout transitions go out in a single submit
+	uploads.beginBatch("Startup");
 	Renderer::createTextureImage();
 	Renderer::createTextureSampler();
-	Renderer::createVertexBuffer(Renderer::verticies);
-	Renderer::createIndexBuffer(Renderer::verticies);
+	Renderer::registerBindlessTextures();
+	Renderer::createGeometry();
+	startupUpload = uploads.submitBatch();
 	//3D upscale
 	Renderer::createUniformBuffers();
-	Renderer::createDescriptorPool();
+	Renderer::createInstanceBuffers();
+	Renderer::createGpuCulling();
 	Renderer::createDescriptorSet();
 
 	Renderer::createCommandBuffers();
 	Renderer::createSyncObject();
+
+	//the startup batch copied while the buffers, sets and command buffers above were created, only what is left of it blocks here
+	uploads.wait(startupUpload);
+	uploads.collect();
+
+	memoryAllocator.printStats();
+	descriptorAllocator.printStats();
 	
 }
 
@@ -106,9 +152,12 @@ void Renderer::createInstance() {
 
 	//pass an Interface/API to vulkan which draws/renders to the screen in this case glfw
 	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
+	const char** glfwExtensions = nullptr;
 
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	//headless rendering has no surface so no window system extensions are needed
+	if (!headless) {
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	}
 
 	createInfo.enabledExtensionCount = glfwExtensionCount;
 	createInfo.ppEnabledExtensionNames = glfwExtensions;
@@ -117,13 +166,45 @@ void Renderer::createInstance() {
 	//vulkan functions all return VkResult
 	VkResult result = vkCreateInstance(&createInfo, nullptr, &instance);//the last parameter is a pointer to where to store the result of the called function
 
-	if (vkCreateInstance(&createInfo,nullptr,&instance)!= VK_SUCCESS) {
+	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create instance!");
 	}
 }
 
 void Renderer::renderLoop() {
 
+	//headless runs render a fixed number of frames and optionaly dump the last one
+	if (headless) {
+		for (uint32_t frame = 0; frame < headlessFrames; frame++) {
+			drawFrame();
+		}
+
+		vkDeviceWaitIdle(device);
+
+		//the last framesInFlight frames are only read when their slots come around, which they never do
+		if (gpuProfile) {
+			profiler.collectPending(currentFrame);
+		}
+
+		if (gpuCulling) {
+			validateGpuCulling();
+		}
+
+		if (recordScaling) {
+			measureRecordingScaling();
+		}
+
+		if (gpuProfile) {
+			profiler.printStats(std::cout);
+		}
+		descriptorAllocator.printStats();
+
+		if (!headlessOutput.empty()) {
+			saveOffscreenImage(headlessOutput);
+		}
+		return;
+	}
+
 	//keep the window running either till an error occurs ore we close the window
 	while (!glfwWindowShouldClose(Renderer::window)) {
 		glfwPollEvents();
@@ -132,6 +213,12 @@ void Renderer::renderLoop() {
 
 	vkDeviceWaitIdle(device);
 
+	if (gpuProfile) {
+		profiler.collectPending(currentFrame);
+		profiler.printStats(std::cout);
+	}
+	descriptorAllocator.printStats();
+
 }
 
 void Renderer::cleanup() {
@@ -142,46 +229,72 @@ void Renderer::cleanup() {
 	vkDestroySampler(device, textureSampler, nullptr);
 	vkDestroyImageView(device, textureView, nullptr);
 	vkDestroyImage(device, texture, nullptr);
-	vkFreeMemory(device, textureMemory,nullptr);
+	memoryAllocator.free(textureMemory);
+	for (size_t i = 0; i < extraTextures.size(); i++) {
+		vkDestroyImageView(device, extraTextureViews[i], nullptr);
+		textureLoader.destroy(extraTextures[i]);
+	}
+	if (bindless) {
+		bindlessTextures.destroy();
+	}
 
 	vkDestroyBuffer(device,vertexBuffer,nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	memoryAllocator.free(vertexBufferMemory);
 
 	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device,indexBuffermemory,nullptr);
+	memoryAllocator.free(indexBuffermemory);
 
 	//Uniform buffers
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-		vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+	uniformRing.destroy();
+
+	culling.destroy();
+
+	//instance buffers
+	for (size_t i = 0; i < framesInFlight; i++) {
+		vkDestroyBuffer(device, instanceBuffers[i], nullptr);
+		memoryAllocator.free(instanceBuffersMemory[i]);
 	}
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-	vkDestroyDescriptorSetLayout(device, descriptorSet, nullptr);
+	descriptorAllocator.destroyLayout(descriptorLayout);
+	descriptorAllocator.destroy();
 
 	//semaphore synchronizors
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++){
+	for (size_t i = 0; i < framesInFlight; i++){
 	vkDestroySemaphore(device, imageAvailableSemaphore[i], nullptr);
 	vkDestroySemaphore(device, renderFinishedSemaphore[i], nullptr);
 	vkDestroyFence(device, inFlightFence[i], nullptr);
 }
 
+	recorder.destroy();
+	profiler.destroy();
 	vkDestroyCommandPool(device, commandPool, nullptr);
 
+	//staging buffers of uploads still in flight go back to the allocator here
+	uploads.destroy();
+
 	vkDestroyPipeline(device,graphicsPipeline, nullptr);
+	vkDestroyPipeline(device, packedGraphicsPipeline, nullptr);
+	pipelineCache.destroy();
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 	vkDestroyRenderPass(device,renderPass,nullptr);
 
+	//all sub-allocations are freed by now, release the blocks themselves
+	memoryAllocator.destroy();
+
 	//destroy logical device
 	vkDestroyDevice(Renderer::device, nullptr);
 
 
 	//VkInstance should only be destroyed before the program exits
-	vkDestroySurfaceKHR(instance,surface, nullptr);
+	if (!headless) {
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
 	vkDestroyInstance(instance ,nullptr);
 
 	//once done we free up resources
-	glfwDestroyWindow(Renderer::window);
-	glfwTerminate();
+	if (!headless) {
+		glfwDestroyWindow(Renderer::window);
+		glfwTerminate();
+	}
 
 }
 
@@ -258,6 +371,21 @@ struct Renderer::SwapChainSupportDetails {
 };
 
 
+//command sets(families) to query
+struct Renderer::queueFamilies {
+
+	// std::optional is a wrapper that contains no value until we assign something to it
+	std::optional<uint32_t> graphiscFamily;
+	std::optional<uint32_t> presentationFamily;
+
+	//transfer only family for asynchronous uploads, optional since many devices do not expose one
+	std::optional<uint32_t> transferFamily;
+
+	bool isComplete() {
+		return graphiscFamily.has_value() && presentationFamily.has_value();
+	}
+};
+
 //check if the device is suitable for use
 bool Renderer::isDeviceSuitable(VkPhysicalDevice device) {
 
@@ -272,6 +400,11 @@ bool Renderer::isDeviceSuitable(VkPhysicalDevice device) {
 	
 	bool extensionSupport = checkDeviceExtensionSupport(device);
 
+	//offscreen rendering accepts any device with a graphics queue, including software ICDs such as lavapipe
+	if (headless) {
+		return extensionSupport && queryQueueFamilies(device).isComplete();
+	}
+
 	//check swapchain
 	bool swapChainAdequate = false;
 	if (extensionSupport) {
@@ -307,18 +440,6 @@ bool Renderer::checkDeviceExtensionSupport(VkPhysicalDevice device) {
 }
 
 
-//command sets(families) to query
-struct Renderer::queueFamilies {
-
-	// std::optional is a wrapper that contains no value until we assign something to it
-	std::optional<uint32_t> graphiscFamily;
-	std::optional<uint32_t> presentationFamily;
-
-	bool isComplete() {
-		return graphiscFamily.has_value() && presentationFamily.has_value();
-	}
-};
-
 //check what command subsets(families) are we capable of running on the device
 Renderer::queueFamilies Renderer::queryQueueFamilies(VkPhysicalDevice device) {
 	
@@ -332,25 +453,47 @@ Renderer::queueFamilies Renderer::queryQueueFamilies(VkPhysicalDevice device) {
 	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyProperties.data());
 
+	//fallback for devices whose only non graphics families also do compute
+	std::optional<uint32_t> asyncTransferFamily;
+
 	int i = 0;
 	for (const auto& queueFamily : queueFamilyProperties) {
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+		if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !subsets.graphiscFamily.has_value()) {
 			subsets.graphiscFamily = i;
 		}
 
+		//a dedicated copy engine shows up as a family with the transfer bit and neither graphics nor compute
+		if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			if (!(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+				if (!subsets.transferFamily.has_value()) {
+					subsets.transferFamily = i;
+				}
+			}
+			else if (!asyncTransferFamily.has_value()) {
+				asyncTransferFamily = i;
+			}
+		}
+
 		//check presentation family support
 		VkBool32 presentationSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
+		if (headless) {
+			//nothing is presented, the offscreen images stay on the graphics queue
+			presentationSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		}
+		else {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
+		}
 
-		if (presentationSupport) {
+		if (presentationSupport && !subsets.presentationFamily.has_value()) {
 			subsets.presentationFamily = i;
 		}
-		if (subsets.isComplete()) {
-			break;
-		}
 
 		i++;
 	}
+
+	if (!subsets.transferFamily.has_value()) {
+		subsets.transferFamily = asyncTransferFamily;
+	}
 	return subsets;
 }
 
@@ -363,6 +506,9 @@ void Renderer::createLogicalDevice() {
 	//create both queues for rendering graphics and diplaying to screen
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = { handler.graphiscFamily.value(),handler.presentationFamily.value() };
+	if (handler.transferFamily.has_value()) {
+		uniqueQueueFamilies.insert(handler.transferFamily.value());
+	}
 
 	float queuePriority = 1.0f;
 
@@ -379,8 +525,42 @@ void Renderer::createLogicalDevice() {
 	}
 
 	//specify physical device features in use
-	VkPhysicalDeviceFeatures deviceFeatures{};
-	deviceFeatures.samplerAnisotropy = VK_TRUE; // required for texture processing
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	enabledFeatures = {};
+	enabledFeatures.samplerAnisotropy = VK_TRUE; // required for texture processing
+	enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance; // GPU culling selects instances per draw
+	//compressed texture containers, TextureLoader still checks the format itself
+	enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	enabledFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+	enabledFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
+	//vulkan 1.2 features are optional, only enable what the device reports
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	bool vulkan12 = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	if (vulkan12) {
+		VkPhysicalDeviceFeatures2 supportedFeatures{};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &supportedVulkan12Features;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+	}
+
+	enabledVulkan12Features = {};
+	enabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	enabledVulkan12Features.hostQueryReset = supportedVulkan12Features.hostQueryReset; // upload timing on the transfer queue
+	enabledVulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount; // GPU culling
+	//descriptor indexing for the bindless texture array
+	enabledVulkan12Features.runtimeDescriptorArray = supportedVulkan12Features.runtimeDescriptorArray;
+	enabledVulkan12Features.shaderSampledImageArrayNonUniformIndexing = supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+	enabledVulkan12Features.descriptorBindingPartiallyBound = supportedVulkan12Features.descriptorBindingPartiallyBound;
+	enabledVulkan12Features.descriptorBindingVariableDescriptorCount = supportedVulkan12Features.descriptorBindingVariableDescriptorCount;
+	enabledVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind;
+	enabledVulkan12Features.descriptorBindingUpdateUnusedWhilePending = supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending;
 
 	//specify what info the logical device uses
 	VkDeviceCreateInfo createInfo{};
@@ -393,7 +573,10 @@ void Renderer::createLogicalDevice() {
 		//logical device wont be created if queueCreateInfoCount is more than 1
 		//static_cast<uint32_t>(queueCreateInfos.size());
 
-	createInfo.pEnabledFeatures = &deviceFeatures;
+	createInfo.pEnabledFeatures = &enabledFeatures;
+	if (vulkan12) {
+		createInfo.pNext = &enabledVulkan12Features;
+	}
 
 	//parameters for creating swapchain
 	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
@@ -416,6 +599,9 @@ void Renderer::createLogicalDevice() {
 	//get ihe interface queu of the logical device
 	vkGetDeviceQueue(Renderer::device,handler.graphiscFamily.value(),0,&graphicQueue);
 	vkGetDeviceQueue(Renderer::device,handler.presentationFamily.value(),0,&presentationQueue);
+	if (handler.transferFamily.has_value()) {
+		vkGetDeviceQueue(Renderer::device, handler.transferFamily.value(), 0, &transferQueue);
+	}
 
 	
 }
@@ -446,16 +632,17 @@ Renderer::SwapChainSupportDetails Renderer::querySwapchainSupport(VkPhysicalDevi
 	if (formatCount != 0) {
 		details.formats.resize(formatCount);
 		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+		details.formats.resize(formatCount);
 	}
 
 	uint32_t presentModeCount;
 	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
 
-	if (formatCount != 0) {
-
-		details.presentModes.resize(formatCount);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface , &presentModeCount, details.presentModes.data());
-
+	//the mode list decides which --present-mode values are accepted, so it is sized by its own count
+	if (presentModeCount != 0) {
+		details.presentModes.resize(presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+		details.presentModes.resize(presentModeCount);
 	}
 
 
@@ -473,18 +660,48 @@ VkSurfaceFormatKHR Renderer::choseSwapChainSurfaceFormat(const std::vector<VkSur
 	return availableFormats[0];
 }
 
+const char* Renderer::presentModeName(VkPresentModeKHR presentMode) {
+
+	switch (presentMode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+	default: return "unknown";
+	}
+}
+
 // chose what order we give work and receive output to the screen
 VkPresentModeKHR Renderer::choseSwapChainPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes) {
 
-	for (const auto& availablePresntMode : availablePresentModes) {
+	//the requested mode first, then the closest one in latency and tearing, FIFO is the only mode every surface supports
+	std::vector<VkPresentModeKHR> preference;
+	switch (requestedPresentMode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		preference = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		preference = { VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		preference = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+		break;
+	default:
+		break;
+	}
 
-		if (availablePresntMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return availablePresntMode;
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	for (VkPresentModeKHR preferred : preference) {
+		if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferred) != availablePresentModes.end()) {
+			presentMode = preferred;
+			break;
 		}
-
 	}
 
-	return VK_PRESENT_MODE_MAILBOX_KHR;
+	if (presentMode != requestedPresentMode) {
+		std::cout << "Present mode " << presentModeName(requestedPresentMode) << " not supported, using " << presentModeName(presentMode) << std::endl;
+	}
+	return presentMode;
 }
 
 //since GLFW works with normal scrren resolution {WIDTH , HEIGHT}
@@ -525,7 +742,8 @@ void Renderer::createSwapChain() {
 
 
 	//specify how many images per cycle the swapchain can take (minImageCount + 1 is standard practice) 
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+	//and at least one per frame in flight so acquire does not throttle the frames we allow
+	uint32_t imageCount = std::max(swapChainSupport.capabilities.minImageCount + 1, framesInFlight);
 
 	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
 		imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -620,8 +838,9 @@ void Renderer::createGraphicsPipeline()
 
 {
 
-	auto vertShaderCode = readFile("shaders/vert.spv");
-	auto fragShaderCode = readFile("shaders/frag.spv");
+	//the bindless variant reads the texture index from the instance and samples the texture array in set 1
+	auto vertShaderCode = readFile(bindless ? "shaders/vert_bindless.spv" : "shaders/vert.spv");
+	auto fragShaderCode = readFile(bindless ? "shaders/frag_bindless.spv" : "shaders/frag.spv");
 
 	//we store these shaders as local variables so we can fre eup the buffer at the end of their compilation and displating to the screen
 	//wrapp shaders into modules
@@ -635,6 +854,20 @@ void Renderer::createGraphicsPipeline()
 	vertShaderStageInfo.module = vertShaderModule;
 	vertShaderStageInfo.pName = "main";
 
+	//DRAW_SOURCE in the vertex shader, the draw mode is fixed for the run so its branches are resolved when the pipeline is compiled
+	uint32_t drawSource = static_cast<uint32_t>(drawMode);
+	VkSpecializationMapEntry drawSourceEntry{};
+	drawSourceEntry.constantID = 0;
+	drawSourceEntry.offset = 0;
+	drawSourceEntry.size = sizeof(drawSource);
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &drawSourceEntry;
+	specializationInfo.dataSize = sizeof(drawSource);
+	specializationInfo.pData = &drawSource;
+	vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
 	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
 	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -658,15 +891,34 @@ void Renderer::createGraphicsPipeline()
 
 	//set input Vertex and specify what format of the vertex data will be passed on
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{}; 
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	//binding 0 steps per vertex, binding 1 per instance
+	VkVertexInputBindingDescription bindingDescriptions[] = { Verts::verts::getBindingDescription(), Verts::instance::getBindingDescription() };
+	auto vertexAttributeDescription = Verts::verts::getAttributeDescriptions();
+	auto instanceAttributeDescription = Verts::instance::getAttributeDescriptions();
 
-	auto bindingDescription = Verts::verts::getBindingDescription();
-	auto attributeDescription = Verts::verts::getAttributeDescriptions();
+	std::vector<VkVertexInputAttributeDescription> attributeDescription(vertexAttributeDescription.begin(), vertexAttributeDescription.end());
+	attributeDescription.insert(attributeDescription.end(), instanceAttributeDescription.begin(), instanceAttributeDescription.end());
 
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexBindingDescriptionCount = 2;
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
 
+	//the packed variant only differs in its vertex input, the shader dequantizes with push constants
+	VkPipelineVertexInputStateCreateInfo packedVertexInputInfo = vertexInputInfo;
+
+	VkVertexInputBindingDescription packedBindingDescriptions[] = { Verts::packedVerts::getBindingDescription(), Verts::instance::getBindingDescription() };
+	auto packedVertexAttributeDescription = Verts::packedVerts::getAttributeDescriptions();
+
+	std::vector<VkVertexInputAttributeDescription> packedAttributeDescription(packedVertexAttributeDescription.begin(), packedVertexAttributeDescription.end());
+	packedAttributeDescription.insert(packedAttributeDescription.end(), instanceAttributeDescription.begin(), instanceAttributeDescription.end());
+
+	packedVertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(packedAttributeDescription.size());
+	packedVertexInputInfo.pVertexBindingDescriptions = packedBindingDescriptions;
+	packedVertexInputInfo.pVertexAttributeDescriptions = packedAttributeDescription.data();
+
 	//input assembly describes what kind of geometry should be used
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -733,8 +985,19 @@ void Renderer::createGraphicsPipeline()
 	//pipeline layout
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &descriptorSet;
+	VkDescriptorSetLayout setLayouts[] = { descriptorLayout.layout, bindlessTextures.getLayout() };
+	pipelineLayoutInfo.setLayoutCount = bindless ? 2 : 1;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+	//128 bytes is the least every device guarantees
+	static_assert(sizeof(UniformBufferObj::DrawConstants) <= 128, "DrawConstants exceed the guaranteed push constant size");
+	VkPushConstantRange drawConstantsRange{};
+	drawConstantsRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	drawConstantsRange.offset = 0;
+	drawConstantsRange.size = sizeof(UniformBufferObj::DrawConstants);
+
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &drawConstantsRange;
 
 
 	//crate pipeline
@@ -759,9 +1022,25 @@ void Renderer::createGraphicsPipeline()
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; //optional
 
-	if (vkCreateGraphicsPipelines(device,VK_NULL_HANDLE,1,&pipelineInfo,nullptr,&graphicsPipeline)!= VK_SUCCESS) {
+	//time creation so cold and warm cache starts can be compared
+	auto pipelineStart = std::chrono::steady_clock::now();
+
+	//both vertex layout variants in one call
+	VkGraphicsPipelineCreateInfo packedPipelineInfo = pipelineInfo;
+	packedPipelineInfo.pVertexInputState = &packedVertexInputInfo;
+
+	VkGraphicsPipelineCreateInfo pipelineInfos[] = { pipelineInfo, packedPipelineInfo };
+	VkPipeline pipelines[2];
+
+	if (vkCreateGraphicsPipelines(device,pipelineCache.get(),2,pipelineInfos,nullptr,pipelines)!= VK_SUCCESS) {
 		throw std::runtime_error("Failed to create Gaphics Pipeline");
 	}
+	graphicsPipeline = pipelines[0];
+	packedGraphicsPipeline = pipelines[1];
+
+	double pipelineMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+	std::cout << "Graphics pipelines created in " << pipelineMilliseconds << " ms ("
+		<< (!usePipelineCache ? "no cache" : pipelineCache.isWarm() ? "warm cache" : "cold cache") << ")" << std::endl;
 
 	//free buffer for further shaders
 	vkDestroyShaderModule(device, fragShaderModule, nullptr);
@@ -794,8 +1073,9 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	//read binary file
 	std::ifstream file(fileName, std::ios::ate | std::ios::binary);
 
+	//only the shaders are read through here, none of them are checked in
 	if (!file.is_open()) {
-		throw std::runtime_error("failed to open file! " + fileName);
+		throw std::runtime_error("Failed to open " + fileName + ", build the shaders target or run shaders/compile.bat!");
 	}
 
 	//store size of the shader in bytes
@@ -823,7 +1103,8 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	 colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	 colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	 colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	 //offscreen images are read back with a copy instead of being presented
+	 colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	 //Subpasses
 
@@ -905,7 +1186,7 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 
 	 VkCommandBufferAllocateInfo allocInfo{};
 
-	 commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	 commandBuffers.resize(framesInFlight);
 	
 	 allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	 allocInfo.commandPool = commandPool;
@@ -915,10 +1196,69 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 if (vkAllocateCommandBuffers(device, &allocInfo,commandBuffers.data()) != VK_SUCCESS) {
 		 throw std::runtime_error("Failed to allocate command buffers!");
 	 }
+
+	 //jobs record the draw list into secondary buffers from their own pools
+	 if (recordThreads > 0) {
+		 recorder.init(device, jobs, queryQueueFamilies(physicalDevice).graphiscFamily.value(), recordThreads, framesInFlight);
+		 std::cout << "Recording draws in " << recordThreads << " slices on " << jobs.getThreadCount() << " job threads" << std::endl;
+	 }
+
+	 //one query pool per command buffer, read back when the buffer is recorded again
+	 if (gpuProfile) {
+		 profiler.init(physicalDevice, device, queryQueueFamilies(physicalDevice).graphiscFamily.value(), framesInFlight);
+	 }
+ }
+
+ //records the same frame in 1, 2, 4 ... slices up to the job thread count and prints the recording time of each
+ void Renderer::measureRecordingScaling() {
+
+	 vkDeviceWaitIdle(device);
+
+	 uint32_t cores = jobs.getThreadCount();
+	 std::vector<uint32_t> threadCounts;
+	 for (uint32_t threads = 1; threads < cores; threads *= 2) {
+		 threadCounts.push_back(threads);
+	 }
+	 threadCounts.push_back(cores);
+
+	 uint32_t configuredThreads = recordThreads;
+	 uint32_t graphicsFamily = queryQueueFamilies(physicalDevice).graphiscFamily.value();
+	 const int repetitions = 20;
+	 double singleThreaded = 0.0;
+
+	 std::cout << "Recording " << drawInstanceCount << " draws:" << std::endl;
+	 for (uint32_t threads : threadCounts) {
+		 recorder.destroy();
+		 recorder.init(device, jobs, graphicsFamily, threads, framesInFlight);
+		 recordThreads = threads;
+
+		 std::vector<double> times;
+		 for (int i = 0; i < repetitions; i++) {
+			 vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+			 auto start = std::chrono::steady_clock::now();
+			 recordCommandBuffer(commandBuffers[currentFrame], currentFrame);
+			 times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		 }
+		 std::sort(times.begin(), times.end());
+		 double milliseconds = times[times.size() / 2];
+		 if (threads == 1) {
+			 singleThreaded = milliseconds;
+		 }
+
+		 std::cout << "  " << threads << " slices: " << milliseconds << " ms, " << singleThreaded / milliseconds << "x" << std::endl;
+	 }
+
+	 recorder.destroy();
+	 recordThreads = configuredThreads;
+	 if (recordThreads > 0) {
+		 recorder.init(device, jobs, graphicsFamily, recordThreads, framesInFlight);
+	 }
  }
 
  void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
 
+	 TRACE_ZONE("recordCommandBuffer");
+
 	 VkCommandBufferBeginInfo beginInfo{};
 	 beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	 beginInfo.flags = 0; // optional
@@ -928,6 +1268,17 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 		 throw std::runtime_error("Failed to begin recording command buffer!");
 	 }
 
+	 //this frame's fence has signalled, so the timings it recorded last time around are ready
+	 profiler.beginFrame(commandBuffer, currentFrame);
+	 profiler.beginScope(commandBuffer, "frame");
+
+	 //compute culling has to finish writing the draws before the render pass consumes them
+	 if (gpuCulling) {
+		 profiler.beginScope(commandBuffer, "culling");
+		 cullFrustum = extractFrustum(frameTransforms.proj * frameTransforms.view * drawConstants.model);
+		 culling.record(commandBuffer, currentFrame, cullFrustum, meshBoundsMin, meshBoundsMax, indexCount);
+		 profiler.endScope(commandBuffer);
+	 }
 
 	 //start rendering
 	 VkRenderPassBeginInfo renderPassInfo{};
@@ -942,10 +1293,65 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 renderPassInfo.clearValueCount = 1;
 	 renderPassInfo.pClearValues = &clearColor;
 
-	 vkCmdBeginRenderPass(commandBuffer , &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	 //the indirect draw is a single command, only the per object draw list is worth spreading over threads
+	 bool parallel = recordThreads > 0 && !gpuCulling && hasIndexBuffer;
+	 bool perObject = parallel || drawMode != DrawMode::Instanced;
+	 lastRecordedDraws = perObject ? drawInstanceCount : 1;
+
+	 profiler.beginScope(commandBuffer, "render pass");
+	 vkCmdBeginRenderPass(commandBuffer , &renderPassInfo, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+	 profiler.beginScope(commandBuffer, "draws");
+
+	 if (parallel) {
+		 //one draw per object, secondary buffers inherit nothing so each slice binds the full state
+		 const std::vector<VkCommandBuffer>& secondaries = recorder.record(currentFrame, renderPass, swapChainFrameBuffers[imageIndex], drawInstanceCount,
+			 [this](VkCommandBuffer secondary, uint32_t begin, uint32_t end) {
+				 bindDrawState(secondary);
+				 recordObjectDraws(secondary, begin, end);
+			 });
+
+		 if (!secondaries.empty()) {
+			 vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+		 }
+	 }
+	 else {
+		 bindDrawState(commandBuffer);
+
+		 if (perObject) {
+			 recordObjectDraws(commandBuffer, 0, drawInstanceCount);
+		 }
+		 else if (hasIndexBuffer) {
+			 //the visible objects come from the culling pass, no per object work on the CPU
+			 if (gpuCulling) {
+				 culling.draw(commandBuffer, currentFrame);
+			 }
+			 else {
+				 //every copy of the mesh in one draw
+				 vkCmdDrawIndexed(commandBuffer, indexCount, drawInstanceCount, 0, 0, 0);
+			 }
+		 }
+		 else {
+			 vkCmdDraw(commandBuffer, vertexIndex,drawInstanceCount,0,0);
+		 }
+	 }
+
+	 profiler.endScope(commandBuffer);
+	 vkCmdEndRenderPass(commandBuffer);
+	 profiler.endScope(commandBuffer);
+	 profiler.endScope(commandBuffer);
+
+	 if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
+		 throw std::runtime_error("Failed to record command buffer!");
+	 }
+
+ }
+
+  //pipeline, dynamic state and buffers every draw needs, recorded into primary and secondary buffers alike
+  void Renderer::bindDrawState(VkCommandBuffer commandBuffer) {
 
 	 //bind graphics pipeline by giving commands to the allocated commandBuffer
-	 vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	 vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packedVertices ? packedGraphicsPipeline : graphicsPipeline);
+	 vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(drawConstants), &drawConstants);
 
 	 VkViewport viewport{};
 	 viewport.x = 0.0f;
@@ -962,37 +1368,106 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 scissor.extent = swapChainExtent;
 	 vkCmdSetScissor(commandBuffer,0,1, &scissor);
 
-	 VkBuffer vertexBuffers[] = { vertexBuffer };
-	 VkDeviceSize  offsets[] = { 0 };
-	 vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	 VkBuffer vertexBuffers[] = { vertexBuffer, instanceBuffers[currentFrame] };
+	 VkDeviceSize  offsets[] = { 0, 0 };
+	 vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
 
-	 vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-	 
-	 if (hasIndexBuffer) {
-		 //bind descriptor for 3D graphics
-		 vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+	 vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
 
-		 vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(verticies.indicies.size()), 1, 0, 0, 0);
-	 }
-	 else {
-		 vkCmdDraw(commandBuffer, vertexIndex,1,0,0);
+	 //bind descriptor for 3D graphics
+	 //the camera block for binding 0, binding 2 is only read per object and may point anywhere valid until then
+	 uint32_t dynamicOffsets[] = { frameUniformOffset, frameUniformOffset };
+	 vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 2, dynamicOffsets);
+
+	 //the texture array is the same set for every frame and draw
+	 if (bindless) {
+		 VkDescriptorSet textureSet = bindlessTextures.getSet();
+		 vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &textureSet, 0, nullptr);
 	 }
+  }
 
-	 vkCmdEndRenderPass(commandBuffer);
+  //one draw per object in [begin, end) of the drawn order, firstInstance still selects the instance for instanced mode
+  void Renderer::recordObjectDraws(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
 
-	 if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
-		 throw std::runtime_error("Failed to record command buffer!");
+	 for (uint32_t object = begin; object < end; object++) {
+		 if (drawMode == DrawMode::PushConstants) {
+			 UniformBufferObj::DrawConstants constants = objectDrawConstants(object);
+			 vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+		 }
+		 else if (drawMode == DrawMode::UniformBuffers) {
+			 //same set every time, only the offset of the object's block changes
+			 uint32_t dynamicOffsets[] = { frameUniformOffset, objectUniformOffset + static_cast<uint32_t>(object * objectUniformStride) };
+			 vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 2, dynamicOffsets);
+		 }
+
+		 if (hasIndexBuffer) {
+			 vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, object);
+		 }
+		 else {
+			 vkCmdDraw(commandBuffer, vertexIndex, 1, 0, object);
+		 }
 	 }
+  }
 
- }
+  //the frame's constants with the transform, color and texture of the object drawn at drawIndex folded in
+  UniformBufferObj::DrawConstants Renderer::objectDrawConstants(uint32_t drawIndex) const {
+
+	 //CPU culling packs the visible instances to the front, everything else draws them in order
+	 const Verts::instance& drawn = cpuCulling && !gpuCulling ? instances[visibleInstances[drawIndex]] : instances[drawIndex];
+
+	 UniformBufferObj::DrawConstants constants = drawConstants;
+	 constants.model = drawConstants.model * drawn.model;
+	 constants.color = glm::vec4(drawn.color, 1.0f);
+	 constants.textureIndex = drawn.textureIndex;
+	 return constants;
+  }
 
  void Renderer::drawFrame() {
 
-	 vkWaitForFences(device, 1, &inFlightFence[currentFrame], VK_TRUE, UINT64_MAX);
+	 TRACE_ZONE("drawFrame");
+
+	 //reclaim staging memory of uploads the GPU has finished with
+	 uploads.collect();
+
+	 //uploads run on their own command buffers and already time themselves, only the new copy time goes to the profiler
+	 if (gpuProfile) {
+		 double uploadMilliseconds = uploads.getStats().gpuMilliseconds;
+		 if (uploadMilliseconds > profiledUploadMilliseconds) {
+			 profiler.addSample("uploads", uploadMilliseconds - profiledUploadMilliseconds);
+			 profiledUploadMilliseconds = uploadMilliseconds;
+		 }
+	 }
+
+	 if (headless) {
+		 drawOffscreenFrame();
+		 return;
+	 }
+
+	 {
+		 TRACE_ZONE("vkWaitForFences");
+		 vkWaitForFences(device, 1, &inFlightFence[currentFrame], VK_TRUE, UINT64_MAX);
+	 }
+
+	 //slots removed framesInFlight frames ago are no longer sampled by anything
+	 if (bindless) {
+		 bindlessTextures.nextFrame();
+	 }
+	 descriptorAllocator.beginFrame(currentFrame);
+	 uniformRing.beginFrame(currentFrame);
+
+	 //waiting here rather than after acquire keeps the wait out of the input to display latency
+	 {
+		 TRACE_ZONE("frame limiter");
+		 frameLimiter.wait();
+	 }
 
 	 uint32_t imageIndex;
-	 VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore[currentFrame],
-		 VK_NULL_HANDLE, &imageIndex);
+	 VkResult result;
+	 {
+		 TRACE_ZONE("vkAcquireNextImageKHR");
+		 result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore[currentFrame],
+			 VK_NULL_HANDLE, &imageIndex);
+	 }
 
 	 if (result ==	VK_ERROR_OUT_OF_DATE_KHR) {
 		 recreateSwapChain();
@@ -1005,13 +1480,14 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 //only reset fence if we are submitting work
 	 vkResetFences(device, 1, &inFlightFence[currentFrame]);
 
+	 //update uniform buffer befor recording, GPU culling records the frustum of this frame
+	 updateUniformBuffer(currentFrame);
+	 updateInstanceBuffer(currentFrame);
+
 	 //record to the command buffer
 	 vkResetCommandBuffer(commandBuffers[currentFrame], 0);
 	 recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
 
-	 //update uniform buffer befor submiting next frame
-	 updateUniformBuffer(currentFrame);
-
 	 //submit command buffer
 	 VkSubmitInfo submitInfo{};
 	 submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1029,9 +1505,13 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 submitInfo.signalSemaphoreCount = 1;
 	 submitInfo.pSignalSemaphores = signalSemaphores;
 
-	 if (vkQueueSubmit(graphicQueue,1,&submitInfo,inFlightFence[currentFrame]) != VK_SUCCESS) {
-		 throw std::runtime_error("Failed to submit draw command to buffer!");
+	 {
+		 TRACE_ZONE("vkQueueSubmit");
+		 if (vkQueueSubmit(graphicQueue,1,&submitInfo,inFlightFence[currentFrame]) != VK_SUCCESS) {
+			 throw std::runtime_error("Failed to submit draw command to buffer!");
+		 }
 	 }
+	 profiler.frameSubmitted(currentFrame);
 
 	 //display the image on screen
 	 VkPresentInfoKHR presentInfo{};
@@ -1048,7 +1528,10 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 
 	 //handle out of date swap chains
 
-     result = vkQueuePresentKHR(presentationQueue, &presentInfo);
+	 {
+		 TRACE_ZONE("vkQueuePresentKHR");
+		 result = vkQueuePresentKHR(presentationQueue, &presentInfo);
+	 }
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || frameBufferResized) {
 		recreateSwapChain();
@@ -1057,15 +1540,15 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 		throw std::runtime_error("Failed to present swap chain image!");
 	}
 
-	 currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	 currentFrame = (currentFrame + 1) % framesInFlight;
 
  }
 
  void Renderer::createSyncObject() {
 
-	 imageAvailableSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
-	 renderFinishedSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
-	 inFlightFence.resize(MAX_FRAMES_IN_FLIGHT);
+	 imageAvailableSemaphore.resize(framesInFlight);
+	 renderFinishedSemaphore.resize(framesInFlight);
+	 inFlightFence.resize(framesInFlight);
 
 	 VkSemaphoreCreateInfo semaphoreInfo{};
 	 semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1073,7 +1556,7 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	 VkFenceCreateInfo fenceInfo{};
 	 fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	 fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-	 for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	 for (size_t i = 0; i < framesInFlight; i++) {
 		 if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore[i]) != VK_SUCCESS ||
 			 vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore[i]) != VK_SUCCESS ||
 			 vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence[i]) != VK_SUCCESS) {
@@ -1115,6 +1598,15 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 		 vkDestroyImageView(device, imageViewer, nullptr);
 	 }
 
+	 if (headless) {
+		 //offscreen images are owned by us rather than by a swapchain
+		 for (size_t i = 0; i < swapChainImages.size(); i++) {
+			 vkDestroyImage(device, swapChainImages[i], nullptr);
+			 memoryAllocator.free(offscreenImagesMemory[i]);
+		 }
+		 return;
+	 }
+
 	 vkDestroySwapchainKHR(device, swapChain, nullptr);
  }
 
@@ -1125,31 +1617,245 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 
  }
 
+  //F12 writes the zones recorded so far without stopping the render loop
+  void Renderer::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+
+	  auto app = reinterpret_cast<Renderer*>(glfwGetWindowUserPointer(window));
+	  if (key == GLFW_KEY_F12 && action == GLFW_PRESS && !app->traceOutput.empty()) {
+		  app->writeTrace();
+	  }
+  }
+
+  void Renderer::writeTrace() {
+
+#ifdef RENDERER_TRACE
+	  if (CpuTrace::writeChromeJson(traceOutput)) {
+		  std::cout << "CPU trace written to " << traceOutput << std::endl;
+	  }
+	  else {
+		  std::cout << "Failed to write CPU trace to " << traceOutput << std::endl;
+	  }
+#else
+	  std::cout << "Built without RENDERER_TRACE, no CPU trace written" << std::endl;
+#endif
+  }
+
+  //headless replacement for createSwapChain, one color target per frame in flight
+  void Renderer::createOffscreenTargets() {
+
+	  swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	  swapChainExtent = { WIDTH, HEIGHT };
+
+	  swapChainImages.resize(framesInFlight);
+	  offscreenImagesMemory.resize(framesInFlight);
+
+	  for (size_t i = 0; i < framesInFlight; i++) {
+		  //transfer source so the result can be copied back to the host
+		  createImage(WIDTH, HEIGHT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImagesMemory[i]);
+	  }
+  }
+
+  //headless replacement for drawFrame, same recording path but no acquire or present
+  void Renderer::drawOffscreenFrame() {
+
+	  TRACE_ZONE("drawOffscreenFrame");
+
+	  auto frameStart = std::chrono::steady_clock::now();
+	  if (recordFrameTimes && lastFrameStart != std::chrono::steady_clock::time_point{}) {
+		  frameMilliseconds.push_back(std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count());
+	  }
+	  lastFrameStart = frameStart;
+
+	  {
+		  TRACE_ZONE("vkWaitForFences");
+		  vkWaitForFences(device, 1, &inFlightFence[currentFrame], VK_TRUE, UINT64_MAX);
+	  }
+	  if (bindless) {
+		  bindlessTextures.nextFrame();
+	  }
+	  descriptorAllocator.beginFrame(currentFrame);
+	  uniformRing.beginFrame(currentFrame);
+	  vkResetFences(device, 1, &inFlightFence[currentFrame]);
+	  {
+		  TRACE_ZONE("frame limiter");
+		  frameLimiter.wait();
+	  }
+	  auto workStart = std::chrono::steady_clock::now();
+
+	  //every frame in flight owns its own offscreen image
+	  uint32_t imageIndex = currentFrame;
+
+	  updateUniformBuffer(currentFrame);
+	  updateInstanceBuffer(currentFrame);
+
+	  vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+	  auto recordStart = std::chrono::steady_clock::now();
+	  recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+	  if (recordFrameTimes) {
+		  recordMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count());
+		  recordedDraws.push_back(lastRecordedDraws);
+	  }
+
+	  VkSubmitInfo submitInfo{};
+	  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	  submitInfo.commandBufferCount = 1;
+	  submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+
+	  {
+		  TRACE_ZONE("vkQueueSubmit");
+		  if (vkQueueSubmit(graphicQueue, 1, &submitInfo, inFlightFence[currentFrame]) != VK_SUCCESS) {
+			  throw std::runtime_error("Failed to submit offscreen draw command to buffer!");
+		  }
+	  }
+	  profiler.frameSubmitted(currentFrame);
+
+	  if (recordFrameTimes) {
+		  submitMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - workStart).count());
+	  }
+
+	  currentFrame = (currentFrame + 1) % framesInFlight;
+  }
+
+  //copy the last rendered offscreen image to the host and write it out as a binary PPM
+  void Renderer::saveOffscreenImage(const std::string& fileName) {
+
+	  uint32_t lastFrame = (currentFrame + framesInFlight - 1) % framesInFlight;
+	  VkDeviceSize imgSize = (VkDeviceSize)swapChainExtent.width * swapChainExtent.height * 4;
+
+	  VkBuffer readbackBuffer;
+	  MemoryAllocation readbackBufferMemory;
+	  createBuffer(imgSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferMemory);
+
+	  VkCommandBuffer commandBuffer = textureLoadStart();
+
+	  VkBufferImageCopy region{};
+	  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	  region.imageSubresource.mipLevel = 0;
+	  region.imageSubresource.baseArrayLayer = 0;
+	  region.imageSubresource.layerCount = 1;
+	  region.imageOffset = { 0, 0, 0 };
+	  region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+
+	  //the render pass leaves the image in TRANSFER_SRC_OPTIMAL when headless
+	  vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[lastFrame], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	  textureLoadEnd(commandBuffer);
+
+	  void* data = readbackBufferMemory.mapped;
+
+	  std::ofstream file(fileName, std::ios::binary);
+	  if (!file.is_open()) {
+		  vkDestroyBuffer(device, readbackBuffer, nullptr);
+		  memoryAllocator.free(readbackBufferMemory);
+		  throw std::runtime_error("failed to open file! " + fileName);
+	  }
+
+	  file << "P6\n" << swapChainExtent.width << " " << swapChainExtent.height << "\n255\n";
+
+	  //drop the alpha chanel, PPM only stores RGB
+	  const uint8_t* pixels = static_cast<const uint8_t*>(data);
+	  std::vector<char> row(swapChainExtent.width * 3);
+	  for (uint32_t y = 0; y < swapChainExtent.height; y++) {
+		  for (uint32_t x = 0; x < swapChainExtent.width; x++) {
+			  const uint8_t* pixel = pixels + ((size_t)y * swapChainExtent.width + x) * 4;
+			  row[x * 3 + 0] = (char)pixel[0];
+			  row[x * 3 + 1] = (char)pixel[1];
+			  row[x * 3 + 2] = (char)pixel[2];
+		  }
+		  file.write(row.data(), row.size());
+	  }
+	  file.close();
+
+	  vkDestroyBuffer(device, readbackBuffer, nullptr);
+	  memoryAllocator.free(readbackBufferMemory);
+
+	  std::cout << "Saved offscreen frame to " << fileName << std::endl;
+  }
+
  
 
-  //create a buffer for vertex input to be displayed on the screen
-  void Renderer::createVertexBuffer(Verts verts) {
+  //uploads use the transfer only queue family when there is one and the graphics queue otherwise
+  void Renderer::createUploadService() {
+
+	  queueFamilies families = queryQueueFamilies(physicalDevice);
+	  uploads.init(physicalDevice, device, memoryAllocator, families.graphiscFamily.value(), graphicQueue, families.transferFamily, transferQueue, enabledVulkan12Features.hostQueryReset == VK_TRUE);
+
+	  std::cout << "Uploads run on " << (uploads.hasDedicatedTransferQueue() ? "a dedicated transfer queue" : "the graphics queue") << std::endl;
+  }
+
+  //upload either the built in quads or a mesh container given with --mesh
+  void Renderer::createGeometry() {
+
+	  //mesh containers store MeshVertex or PackedMeshVertex, which must stay byte compatible with the pipeline's vertex layouts
+	  static_assert(sizeof(MeshVertex) == sizeof(Verts::verts), "MeshVertex and Verts::verts layouts differ");
+	  static_assert(sizeof(PackedMeshVertex) == sizeof(Verts::packedVerts), "PackedMeshVertex and Verts::packedVerts layouts differ");
+
+	  drawConstants.scale = glm::vec4(1.0f);
+	  drawConstants.offset = glm::vec4(0.0f);
+	  packedVertices = false;
+
+	  if (meshPath.empty()) {
+		  createVertexBuffer(verticies.verticies.data(), sizeof(verticies.verticies[0]) * verticies.verticies.size());
+		  createIndexBuffer(verticies.indicies.data(), sizeof(verticies.indicies[0]) * verticies.indicies.size());
+		  indexCount = static_cast<uint32_t>(verticies.indicies.size());
+		  indexType = VK_INDEX_TYPE_UINT16;
+
+		  //containers carry their bounds, the built in geometry computes them here
+		  meshBoundsMin = glm::vec3(std::numeric_limits<float>::max());
+		  meshBoundsMax = glm::vec3(-std::numeric_limits<float>::max());
+		  for (const Verts::verts& vertex : verticies.verticies) {
+			  meshBoundsMin = glm::min(meshBoundsMin, vertex.pos);
+			  meshBoundsMax = glm::max(meshBoundsMax, vertex.pos);
+		  }
+		  return;
+	  }
+
+	  auto start = std::chrono::steady_clock::now();
+
+	  MeshFile mesh;
+	  if (!mesh.open(meshPath)) {
+		  throw std::runtime_error("Failed to load mesh " + meshPath + "!");
+	  }
+
+	  const MeshFileHeader& header = mesh.header();
+	  packedVertices = header.vertexFormat == static_cast<uint32_t>(MeshVertexFormat::Packed);
+	  uint32_t expectedStride = packedVertices ? sizeof(Verts::packedVerts) : sizeof(Verts::verts);
 
-	  VkDeviceSize bufferSize = sizeof(verts.verticies[0]) * verts.verticies.size();
+	  if ((!packedVertices && header.vertexFormat != static_cast<uint32_t>(MeshVertexFormat::Float32)) || mesh.stream(MeshStreamType::Vertex)->stride != expectedStride) {
+		  throw std::runtime_error("Unsupported vertex format in " + meshPath + "!");
+	  }
+
+	  //the streams are copied from the mapping straight into staging memory, nothing is read into vectors first
+	  const MeshStreamHeader* vertexStream = mesh.stream(MeshStreamType::Vertex);
+	  const MeshStreamHeader* indexStream = mesh.stream(MeshStreamType::Index);
+	  createVertexBuffer(mesh.streamData(*vertexStream), vertexStream->size);
+	  createIndexBuffer(mesh.streamData(*indexStream), indexStream->size);
+
+	  indexCount = header.indexCount;
+	  indexType = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	  meshBoundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	  meshBoundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+	  //packed positions are 0..1 across the bounds
+	  if (packedVertices) {
+		  drawConstants.scale = glm::vec4(meshBoundsMax - meshBoundsMin, 0.0f);
+		  drawConstants.offset = glm::vec4(meshBoundsMin, 0.0f);
+	  }
 
-	  //create and load in staging buffer
-	  VkBuffer stagingBuffer;
-	  VkDeviceMemory stagingBufferMemory;
-	  createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	  double megabytes = (vertexStream->size + indexStream->size) / (1024.0 * 1024.0);
+	  std::cout << "Loaded " << meshPath << ": " << header.vertexCount << (packedVertices ? " packed" : "") << " vertices, " << header.indexCount / 3 << " triangles, "
+		  << megabytes << " MiB at " << megabytes / seconds << " MiB/s" << std::endl;
+  }
 
-	  //copy vertex data to GPU from staging buffer
-	  void* data;
-	  vkMapMemory(device,stagingBufferMemory,0,bufferSize,0,&data);
-	  memcpy(data, verts.verticies.data(), (size_t)bufferSize);
-	  vkUnmapMemory(device, stagingBufferMemory);
+  //create a buffer for vertex input to be displayed on the screen
+  void Renderer::createVertexBuffer(const void* data, VkDeviceSize bufferSize) {
 
-	  //load data from staging memory to GPU memory
 	  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,vertexBuffer,vertexBufferMemory);
-	  copyBuffer(stagingBuffer,vertexBuffer,bufferSize);
-	
-	  //cleanup temporary buffers
-	  vkDestroyBuffer(device,stagingBuffer,nullptr);
-	  vkFreeMemory(device,stagingBufferMemory,nullptr);
+
+	  //the copy runs asynchronously, draws submitted later are ordered behind it on the graphics queue
+	  vertexUpload = uploads.uploadBuffer(data, bufferSize, vertexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 
   };
 
@@ -1171,31 +1877,15 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 
 
   //shader verticies are rendered in an order
-  void Renderer::createIndexBuffer(Verts verts) {
-
-	  VkDeviceSize bufferSize = sizeof(verts.indicies[0]) * verts.indicies.size();
-	  
-	  //create staging buffer
-	  VkBuffer stagingBuffer;
-	  VkDeviceMemory stagingBufferMemory;
-
-	  createBuffer(bufferSize,VK_BUFFER_USAGE_TRANSFER_SRC_BIT,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,stagingBuffer,stagingBufferMemory);
-	  
-	  void* data;
-	  vkMapMemory(device,stagingBufferMemory,0,bufferSize,0,&data);
-	  memcpy(data, verts.indicies.data(), (size_t)bufferSize);
-	  vkUnmapMemory(device,stagingBufferMemory);
+  void Renderer::createIndexBuffer(const void* data, VkDeviceSize bufferSize) {
 
 	  createBuffer(bufferSize,VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,indexBuffer,indexBuffermemory);
 
-	  copyBuffer(stagingBuffer,indexBuffer,bufferSize);
-
-	  vkDestroyBuffer(device,stagingBuffer,nullptr);
-	  vkFreeMemory(device, stagingBufferMemory, nullptr);
+	  indexUpload = uploads.uploadBuffer(data, bufferSize, indexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
   }
 
   //staging helper function
-  void Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory){
+  void Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory, AllocationStrategy strategy){
 
 	  VkBufferCreateInfo bufferInfo{};
 	  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1210,73 +1900,38 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	  VkMemoryRequirements memRequirements;
 	  vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-	  VkMemoryAllocateInfo allocInfo{};
-	  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	  allocInfo.allocationSize = memRequirements.size;
-	  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+	  //carve the buffer out of a shared block instead of its own vkAllocateMemory
+	  bufferMemory = memoryAllocator.allocate(memRequirements, properties, ResourceType::Linear, strategy);
 
-	  if (vkAllocateMemory(device,&allocInfo,nullptr,&bufferMemory) != VK_SUCCESS) {
-		  throw std::runtime_error("Failed to allocate buffer memory!");
-	  }
-
-	  vkBindBufferMemory(device, buffer, bufferMemory, 0);
-  }
-
-  void Renderer::copyBuffer(VkBuffer sourceBuffer, VkBuffer destinationBuffer, VkDeviceSize size ) {
-	
-
-	  VkCommandBuffer commandbuffer = textureLoadStart();
-
-	  VkBufferCopy copyRegion{};
-	  copyRegion.size = size;
-	  vkCmdCopyBuffer(commandbuffer, sourceBuffer, destinationBuffer, 1, &copyRegion);
-
-
-	  textureLoadEnd(commandbuffer);
+	  vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
   }
 
-  //load raw image into pixels
+  //containers carry their own mip chain in a GPU format, anything else is decoded on the job system and gets its chain generated
   void Renderer::createTexture()
   {
 
-	  int width, height, channels;
-	  stbi_uc* pixel = stbi_load("textures/mr_bean.png", &width, &height, &channels, STBI_rgb_alpha);
-	  VkDeviceSize imgSize = width * height * 4;
+	  textureLoader.init(physicalDevice, device, memoryAllocator, uploads, jobs, mipmapMode, useTextureCache ? textureCachePath : "");
 
-	  if (!pixel) {
-		  throw std::runtime_error("Failed to load texture!");
+	  //the extra textures only have a use when instances can pick them
+	  std::vector<TextureRequest> requests = { { texturePath, textureFallbackPath } };
+	  if (bindless) {
+		  for (const std::string& path : bindlessTexturePaths) {
+			  requests.push_back({ path, textureFallbackPath });
+		  }
 	  }
-
-	  //setup staging
-	  VkBuffer stagingBuffer;
-	  VkDeviceMemory stagingBufferMemory;
-
-	  createBuffer(imgSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	  //load image pixels directly
-	  void* data;
-	  vkMapMemory(device, stagingBufferMemory, 0, imgSize, 0, &data);
-	  memcpy(data, pixel, static_cast<size_t>(imgSize));
-	  vkUnmapMemory(device, stagingBufferMemory);
-
-	  //cleanup
-	  stbi_image_free(pixel);
-
-	  createImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture, textureMemory);
-
-	  transitionTextureLayout(texture, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	  
-	 
-	  copyBufferToTexture(stagingBuffer, texture, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
-
-	  transitionTextureLayout(texture, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	 
-	  vkDestroyBuffer(device, stagingBuffer, nullptr);
-	  vkFreeMemory(device, stagingBufferMemory, nullptr);
+	  std::vector<LoadedTexture> loadedTextures = textureLoader.load(requests);
+	  LoadedTexture loaded = loadedTextures[0];
+	  extraTextures.assign(loadedTextures.begin() + 1, loadedTextures.end());
+
+	  texture = loaded.image;
+	  textureMemory = loaded.memory;
+	  textureFormat = loaded.format;
+	  textureMipLevels = loaded.mipLevels;
+	  textureUpload = loaded.upload;
   }
 
   //recreate image from given data
-  void Renderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& texture, VkDeviceMemory& textureMemory) {
+  void Renderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& texture, MemoryAllocation& textureMemory, uint32_t mipLevels) {
 
 
 	  VkImageCreateInfo imageInfo{};
@@ -1285,7 +1940,7 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	  imageInfo.extent.width = width;
 	  imageInfo.extent.height = height;
 	  imageInfo.extent.depth = 1;
-	  imageInfo.mipLevels = 1;
+	  imageInfo.mipLevels = mipLevels;
 	  imageInfo.arrayLayers = 1;
 	  imageInfo.format = format;
 	  imageInfo.tiling = tiling;
@@ -1302,16 +1957,11 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	  VkMemoryRequirements requirements;
 	  vkGetImageMemoryRequirements(device, texture, &requirements);
 
-	  VkMemoryAllocateInfo allocationInfo{};
-	  allocationInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	  allocationInfo.allocationSize = requirements.size;
-	  allocationInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
-	  
-	  if (vkAllocateMemory(device,&allocationInfo,nullptr,&textureMemory) != VK_SUCCESS) {
-		  throw std::runtime_error("Failed to allocate memory for texture!");
-	  }
+	  //optimal tiled images must not share a granularity page with buffers, the allocator keeps them apart
+	  ResourceType type = tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceType::Optimal : ResourceType::Linear;
+	  textureMemory = memoryAllocator.allocate(requirements, properties, type, AllocationStrategy::Buddy);
 
-	  vkBindImageMemory(device, texture, textureMemory,0);
+	  vkBindImageMemory(device, texture, textureMemory.memory, textureMemory.offset);
   }
 
   //texture buffer layout start
@@ -1354,85 +2004,29 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	  vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
   }
 
-  void Renderer::transitionTextureLayout(VkImage texture, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-	  
-	  VkCommandBuffer commandBuffer = textureLoadStart();
-
-	  //use image memory barrier for synchronization
-	  VkImageMemoryBarrier barrier{};
-	  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	  barrier.oldLayout = oldLayout;
-	  barrier.newLayout = newLayout;
-	  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	  barrier.image = texture;
-	  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	  barrier.subresourceRange.baseMipLevel = 0;
-	  barrier.subresourceRange.levelCount = 1;
-	  barrier.subresourceRange.baseArrayLayer = 0;
-	  barrier.subresourceRange.layerCount = 1;
-	  VkPipelineStageFlags sourceStage;
-	  VkPipelineStageFlags destinationStage;
-
-	  if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		  barrier.srcAccessMask = 0;
-		  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		  sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		  destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	  }
-	  else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  //tell vulkan how to acces 3D shaders
+  void Renderer::createDescriptionSetLayout() {
 
-		  sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		  destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	  //textures move to their own set, so set 0 keeps only the per frame uniform buffer
+	  if (bindless && !BindlessTextures::isSupported(enabledVulkan12Features)) {
+		  std::cout << "Descriptor indexing not supported, bindless textures disabled" << std::endl;
+		  bindless = false;
 	  }
-	  else {
-		  throw std::invalid_argument("unsupported layout transition!");
+	  if (bindless) {
+		  bindlessTextures.init(physicalDevice, device, bindlessCapacity, framesInFlight);
 	  }
 
-	  vkCmdPipelineBarrier(
-		  commandBuffer,
-		  sourceStage, destinationStage,
-		  0,
-		  0, nullptr,
-		  0, nullptr,
-		  1, &barrier
-	  );
-
-	  textureLoadEnd(commandBuffer);
-  }
-
-
-  void Renderer::copyBufferToTexture(VkBuffer buffer, VkImage texture, uint32_t width, uint32_t height) {
-
-	  VkCommandBuffer commandBuffer = textureLoadStart();
-
-	  VkBufferImageCopy region{};
-	  region.bufferOffset = 0;
-	  region.bufferRowLength = 0;
-	  region.bufferImageHeight = 0;
-	  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	  region.imageSubresource.mipLevel = 0;
-	  region.imageSubresource.baseArrayLayer = 0;
-	  region.imageSubresource.layerCount = 1;
-
-	  region.imageOffset = { 0, 0, 0 };
-	  region.imageExtent = {width,height,1};
-
-	  vkCmdCopyBufferToImage(commandBuffer,buffer, texture,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1,&region );
-	  //vkCmdCopyImageToBuffer(commandBuffer,image,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,nullptr,1,&region);
-
-	  textureLoadEnd(commandBuffer);
-  }
+	  //the indirect draws of GPU culling are instanced by nature
+	  if (gpuCulling && drawMode != DrawMode::Instanced) {
+		  std::cout << "Per object draw modes do not combine with GPU culling, drawing instanced" << std::endl;
+		  drawMode = DrawMode::Instanced;
+	  }
 
-  //tell vulkan how to acces 3D shaders
-  void Renderer::createDescriptionSetLayout() {
+	  descriptorAllocator.init(device, framesInFlight);
 
 	  VkDescriptorSetLayoutBinding uniformLayoutBinding{};
 	  uniformLayoutBinding.binding = 0;
-	  uniformLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	  uniformLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	  uniformLayoutBinding.descriptorCount = 1;
 
 	  uniformLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
@@ -1446,111 +2040,211 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
       samplerLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	  
 
-	  std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uniformLayoutBinding , samplerLayout };
-
-	  VkDescriptorSetLayoutCreateInfo layoutInfo{};
-
-	  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	  layoutInfo.pBindings = bindings.data();
-
-	  if (vkCreateDescriptorSetLayout(device,&layoutInfo,nullptr,&descriptorSet) != VK_SUCCESS) {
-		  throw std::runtime_error("Failed to create descriptor set!");
+	  //the per object data of DrawMode::UniformBuffers, always part of the layout so every draw mode shares one set layout
+	  //both uniform buffers are dynamic views of the uniform ring, so the set never changes between frames or draws
+	  VkDescriptorSetLayoutBinding objectLayoutBinding{};
+	  objectLayoutBinding.binding = 2;
+	  objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	  objectLayoutBinding.descriptorCount = 1;
+	  objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	  objectLayoutBinding.pImmutableSamplers = nullptr;
+
+	  std::vector<VkDescriptorSetLayoutBinding> bindings = { uniformLayoutBinding };
+	  if (!bindless) {
+		  bindings.push_back(samplerLayout);
 	  }
+	  bindings.push_back(objectLayoutBinding);
+
+	  //the layout comes with an update template, sets are written from one array instead of a VkWriteDescriptorSet per binding
+	  descriptorLayout = descriptorAllocator.createLayout(bindings);
   }
 
   void Renderer::createUniformBuffers() {
 	  
-	  VkDeviceSize bufferSize = sizeof(UniformBufferObj::UniformBufferObject);
+	  //a partition holds the camera block, a block per object when they are drawn from uniform buffers, and headroom for passes
+	  VkDeviceSize frameBytes = sizeof(UniformBufferObj::UniformBufferObject) + UNIFORM_RING_HEADROOM;
+	  if (drawMode == DrawMode::UniformBuffers) {
+		  VkDeviceSize maxStride = (sizeof(UniformBufferObj::DrawConstants) + UniformRing::MAX_ALIGNMENT - 1) / UniformRing::MAX_ALIGNMENT * UniformRing::MAX_ALIGNMENT;
+		  frameBytes += VkDeviceSize(instanceCount) * maxStride;
+	  }
+	  uniformRing.init(physicalDevice, device, memoryAllocator, frameBytes, framesInFlight);
+	  objectUniformStride = uniformRing.alignedSize(sizeof(UniformBufferObj::DrawConstants));
+
+	  std::cout << "Uniform ring: " << framesInFlight << " partitions of " << uniformRing.getFrameSize() / 1024 << " KiB" << std::endl;
+  }
+
+
+  void Renderer::createInstanceBuffers() {
 
-	  uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-	  uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-	  uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+	  if (instanceCount == 0) {
+		  throw std::runtime_error("Instance count must be at least 1!");
+	  }
+
+	  //square grid scaled down so all copies cover the area of the single object, a single instance is drawn unchanged
+	  uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+	  float cell = 2.0f / side;
+
+	  glm::vec3 meshCenter = (meshBoundsMin + meshBoundsMax) * 0.5f;
+	  glm::vec3 meshExtent = meshBoundsMax - meshBoundsMin;
+	  float meshSize = std::max({ meshExtent.x, meshExtent.y, meshExtent.z, 1e-6f });
+
+	  instances.resize(instanceCount);
+	  for (uint32_t i = 0; i < instanceCount; i++) {
+		  uint32_t x = i % side;
+		  uint32_t y = i / side;
+
+		  glm::vec3 center((x + 0.5f) * cell - 1.0f, (y + 0.5f) * cell - 1.0f, 0.0f);
+		  instances[i].model = instanceCount > 1 ?
+			  glm::translate(glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(cell / meshSize)), -meshCenter) : glm::mat4(1.0f);
+
+		  float u = side > 1 ? x / float(side - 1) : 1.0f;
+		  float v = side > 1 ? y / float(side - 1) : 1.0f;
+		  instances[i].color = instanceCount > 1 ? glm::vec3(0.5f + 0.5f * u, 0.5f + 0.5f * v, 1.0f - 0.5f * u) : glm::vec3(1.0f);
+		  //neighbours cycle through the registered textures, all of them are drawn by the same call
+		  instances[i].textureIndex = textureSlots.empty() ? 0 : textureSlots[i % textureSlots.size()];
+	  }
+
+	  //host visible per frame like the uniform buffers, a frame in flight keeps reading its own copy
+	  VkDeviceSize bufferSize = sizeof(Verts::instance) * instanceCount;
+
+	  instanceBuffers.resize(framesInFlight);
+	  instanceBuffersMemory.resize(framesInFlight);
+	  instanceBuffersMapped.resize(framesInFlight);
+
+	  for (size_t i = 0; i < framesInFlight; i++) {
+		  //the culling pass reads the same buffer as a storage buffer
+		  createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | (gpuCulling ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i], instanceBuffersMemory[i]);
+
+		  instanceBuffersMapped[i] = instanceBuffersMemory[i].mapped;
+	  }
 
-	  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		  createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+	  if (drawMode == DrawMode::Instanced) {
+		  std::cout << "Drawing " << instanceCount << " instances with one draw call" << std::endl;
+	  }
+	  else {
+		  std::cout << "Drawing " << instanceCount << " objects with one draw each, per draw data in " << (drawMode == DrawMode::PushConstants ? "push constants" : "uniform buffers") << std::endl;
+	  }
 
-		  vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+	  //instances do not move, the hierarchy is built once over their world space boxes
+	  if (cpuCulling) {
+		  glm::vec3 boundsCenter = (meshBoundsMin + meshBoundsMax) * 0.5f;
+		  glm::vec3 boundsExtent = (meshBoundsMax - meshBoundsMin) * 0.5f;
+
+		  CullingBoxes boxes;
+		  boxes.resize(instanceCount);
+		  for (uint32_t i = 0; i < instanceCount; i++) {
+			  glm::vec3 center;
+			  glm::vec3 extent;
+			  transformBox(instances[i].model, boundsCenter, boundsExtent, center, extent);
+			  boxes.set(i, center, extent);
+		  }
+
+		  cullingBvh.build(boxes);
+		  cullingKernel = bestCullingKernel();
+		  visibleInstances.reserve(instanceCount);
+		  std::cout << "CPU culling with the " << cullingKernelName(cullingKernel) << " kernel over " << cullingBvh.nodeCount() << " BVH nodes" << std::endl;
 	  }
   }
 
+  //one contiguous copy per frame, whatever changed in instances since the last frame goes along
+  void Renderer::updateInstanceBuffer(uint32_t currentFrame) {
 
-  void Renderer::createDescriptorPool() {
+	  TRACE_ZONE("updateInstanceBuffer");
 
-	  std::array<VkDescriptorPoolSize,2> poolSize{};
-	  poolSize[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	  poolSize[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-	  poolSize[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	  poolSize[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	  Verts::instance* mapped = static_cast<Verts::instance*>(instanceBuffersMapped[currentFrame]);
 
-	  VkDescriptorPoolCreateInfo poolInfo{};
-	  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSize.size());
-	  poolInfo.pPoolSizes = poolSize.data();
-	  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	  //GPU culling needs every instance at its own index
+	  if (!cpuCulling || gpuCulling) {
+		  jobs.parallelFor(static_cast<uint32_t>(instances.size()), INSTANCE_UPDATE_GRAIN, [&](uint32_t begin, uint32_t end) {
+			  memcpy(mapped + begin, instances.data() + begin, sizeof(Verts::instance) * (end - begin));
+		  });
+		  drawInstanceCount = instanceCount;
+	  }
+	  else {
+		  //only the visible instances are packed to the front and drawn
+		  Frustum frustum = extractFrustum(frameTransforms.proj * frameTransforms.view * drawConstants.model);
+		  cullingBvh.cull(jobs, cullingKernel, frustum, visibleInstances);
+
+		  jobs.parallelFor(static_cast<uint32_t>(visibleInstances.size()), INSTANCE_UPDATE_GRAIN, [&](uint32_t begin, uint32_t end) {
+			  for (uint32_t i = begin; i < end; i++) {
+				  mapped[i] = instances[visibleInstances[i]];
+			  }
+		  });
+		  drawInstanceCount = static_cast<uint32_t>(visibleInstances.size());
+	  }
 
-	  if (vkCreateDescriptorPool(device,&poolInfo,nullptr,&descriptorPool) != VK_SUCCESS) {
-		  throw std::runtime_error("failed to create descriptor pool!");
+	  //one ring allocation for all drawn objects, draw i binds it at objectUniformOffset + i * objectUniformStride
+	  if (drawMode == DrawMode::UniformBuffers && drawInstanceCount > 0) {
+		  UniformAllocation blocks = uniformRing.allocate(objectUniformStride * drawInstanceCount);
+		  objectUniformOffset = blocks.offset;
+		  uint8_t* slots = static_cast<uint8_t*>(blocks.data);
+		  jobs.parallelFor(drawInstanceCount, INSTANCE_UPDATE_GRAIN, [&](uint32_t begin, uint32_t end) {
+			  for (uint32_t i = begin; i < end; i++) {
+				  UniformBufferObj::DrawConstants constants = objectDrawConstants(i);
+				  memcpy(slots + i * objectUniformStride, &constants, sizeof(constants));
+			  }
+		  });
 	  }
   }
 
-  //Descriptors describe how the object is to be drawn to the screen
-  void Renderer::createDescriptorSet() {
+  void Renderer::createGpuCulling() {
+
+	  if (!gpuCulling) {
+		  return;
+	  }
 
-	  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSet);
+	  //the draw count lives on the GPU and every draw picks its instance through firstInstance
+	  if (!enabledVulkan12Features.drawIndirectCount || !enabledFeatures.drawIndirectFirstInstance) {
+		  std::cout << "drawIndirectCount or drawIndirectFirstInstance not supported, GPU culling disabled" << std::endl;
+		  gpuCulling = false;
+		  return;
+	  }
+
+	  culling.init(device, memoryAllocator, descriptorAllocator, pipelineCache.get(), readFile("shaders/cull.spv"), instanceBuffers, instanceCount);
+	  std::cout << "GPU culling " << instanceCount << " objects with vkCmdDrawIndexedIndirectCount" << std::endl;
+  }
 
-	  VkDescriptorSetAllocateInfo allocationInfo{};
+  //compares the draw count of the last frame with the CPU reference test on the same frustum
+  void Renderer::validateGpuCulling() {
 
-	  allocationInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	  allocationInfo.descriptorPool = descriptorPool;
-	  allocationInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-	  allocationInfo.pSetLayouts = layouts.data();
-	  descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	  uint32_t lastFrame = (currentFrame + framesInFlight - 1) % framesInFlight;
+	  uint32_t gpuVisible = culling.visibleCount(lastFrame);
 
-	  if (vkAllocateDescriptorSets(device,&allocationInfo, descriptorSets.data()) != VK_SUCCESS) {
-		  throw std::runtime_error("Failed to allocate descriptor sets!");
+	  glm::vec3 boundsCenter = (meshBoundsMin + meshBoundsMax) * 0.5f;
+	  glm::vec3 boundsExtent = (meshBoundsMax - meshBoundsMin) * 0.5f;
+
+	  uint32_t cpuVisible = 0;
+	  for (const Verts::instance& object : instances) {
+		  glm::vec3 center;
+		  glm::vec3 extent;
+		  transformBox(object.model, boundsCenter, boundsExtent, center, extent);
+		  cpuVisible += isBoxVisible(cullFrustum, center, extent) ? 1 : 0;
 	  }
 
-	  //populate descriptor sets
-	  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		  
-		  VkDescriptorBufferInfo bufferInfo{};
-		  bufferInfo.buffer = uniformBuffers[i];
-		  bufferInfo.offset = 0;
-		  bufferInfo.range = sizeof(UniformBufferObj::UniformBufferObject);
-
-
-		  VkDescriptorImageInfo imgInfo{};
-		  imgInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		  imgInfo.imageView = textureView;
-		  imgInfo.sampler = textureSampler;
-
-		  std::array<VkWriteDescriptorSet, 2> descriptorWrite{};
-
-		  descriptorWrite[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		  descriptorWrite[0].dstSet = descriptorSets[i];
-		  descriptorWrite[0].dstBinding = 0;
-		  descriptorWrite[0].dstArrayElement = 0;
-		  descriptorWrite[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		  descriptorWrite[0].descriptorCount = 1;
-		  descriptorWrite[0].pBufferInfo = &bufferInfo;
-
-		  descriptorWrite[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		  descriptorWrite[1].dstSet = descriptorSets[i];
-		  descriptorWrite[1].dstBinding = 1;
-		  descriptorWrite[1].dstArrayElement = 0;
-		  descriptorWrite[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		  descriptorWrite[1].descriptorCount = 1;
-		  descriptorWrite[1].pImageInfo = &imgInfo;
-		
-		  vkUpdateDescriptorSets(device,static_cast<uint32_t>(descriptorWrite.size()),descriptorWrite.data(), 0, nullptr);
-	  
+	  std::cout << "GPU culling: " << gpuVisible << " of " << instanceCount << " objects visible, CPU reference " << cpuVisible
+		  << (gpuVisible == cpuVisible ? " (match)" : " (MISMATCH)") << std::endl;
+  }
+
+
+  //Descriptors describe how the object is to be drawn to the screen
+  //the set never changes, so it comes from the allocator's cache and is written once through the layout's template
+  //both uniform buffers cover one block of the ring, the dynamic offsets passed at bind time say which
+  void Renderer::createDescriptorSet() {
+
+	  std::vector<DescriptorInfo> contents = { bufferDescriptor(uniformRing.getBuffer(), 0, sizeof(UniformBufferObj::UniformBufferObject)) };
+
+	  //bindless textures live in the set BindlessTextures owns
+	  if (!bindless) {
+		  contents.push_back(imageDescriptor(textureView, textureSampler));
 	  }
 
+	  contents.push_back(bufferDescriptor(uniformRing.getBuffer(), 0, sizeof(UniformBufferObj::DrawConstants)));
+	  descriptorSet = descriptorAllocator.getCached(descriptorLayout, contents);
+
   }
 
   //a helper function so multaple Textures can be processed at once
-  VkImageView Renderer::createTextureView(VkImage texture, VkFormat format) {
+  VkImageView Renderer::createTextureView(VkImage texture, VkFormat format, uint32_t mipLevels) {
 
 	  VkImageViewCreateInfo viewInfo{};
 	  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1559,7 +2253,7 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	  viewInfo.format = format;
 	  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	  viewInfo.subresourceRange.baseMipLevel = 0;
-	  viewInfo.subresourceRange.levelCount = 1;
+	  viewInfo.subresourceRange.levelCount = mipLevels;
 	  viewInfo.subresourceRange.baseArrayLayer = 0;
 	  viewInfo.subresourceRange.layerCount = 1;
 	  
@@ -1573,7 +2267,24 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 
   //create image view to load onto a surface
   void Renderer::createTextureImage() {
-	  textureView = createTextureView(texture, VK_FORMAT_R8G8B8A8_SRGB);
+	  textureView = createTextureView(texture, textureFormat, textureMipLevels);
+	  for (const LoadedTexture& extra : extraTextures) {
+		  extraTextureViews.push_back(createTextureView(extra.image, extra.format, extra.mipLevels));
+	  }
+  }
+
+  //every texture takes one slot of the array, the instances store the slots
+  void Renderer::registerBindlessTextures() {
+
+	  if (!bindless) {
+		  return;
+	  }
+
+	  textureSlots.push_back(bindlessTextures.add(textureView, textureSampler));
+	  for (VkImageView view : extraTextureViews) {
+		  textureSlots.push_back(bindlessTextures.add(view, textureSampler));
+	  }
+	  std::cout << "Bindless textures: " << bindlessTextures.getCount() << " registered, instances cycle through them" << std::endl;
   }
 
   void Renderer::createTextureImageViews() {
@@ -1613,7 +2324,12 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
 	  sampleInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	  sampleInfo.mipLodBias = 0.0f;
 	  sampleInfo.minLod = 0.0f;
-	  sampleInfo.maxLod = 0.0f;
+	  //the whole chain, distant surfaces read the small levels instead of thrashing the texture cache on level 0
+	  //one sampler serves every bindless texture, each view limits its own chain
+	  sampleInfo.maxLod = static_cast<float>(textureMipLevels);
+	  for (const LoadedTexture& extra : extraTextures) {
+		  sampleInfo.maxLod = std::max(sampleInfo.maxLod, static_cast<float>(extra.mipLevels));
+	  }
 
 	  if (vkCreateSampler(device,&sampleInfo,nullptr,&textureSampler) != VK_SUCCESS) {
 		  throw std::runtime_error("Failed to create texture sampler!");
@@ -1624,21 +2340,29 @@ VkShaderModule Renderer::createShaderModule( std::vector<char> code) {
   //requires matrix and chrono libraris , standardly they should be packed with object they render
   void Renderer::updateUniformBuffer(uint32_t currentFrame) {
 
+	  TRACE_ZONE("updateUniformBuffer");
+
 	  static auto startTime = std::chrono::high_resolution_clock::now();
 	  auto currentTime = std::chrono::high_resolution_clock::now();
 
 	  //calculate the distance traveled since the start of the rendering process
 	  float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+	  if (fixedTimestep > 0.0) {
+		  time = static_cast<float>(simulatedFrames * fixedTimestep);
+	  }
+	  simulatedFrames++;
 
 	  //program the 3D model
 	  UniformBufferObj::UniformBufferObject RenderModel{};
 
-	  RenderModel.model = glm::rotate(glm::mat4(0.1f), time * glm::radians(5.0f), glm::vec3(0.0f, 0.0f, 0.1f));
+	  //the object transform travels with the draws, only the camera goes into the buffer
+	  drawConstants.model = glm::rotate(glm::mat4(0.1f), time * glm::radians(5.0f), glm::vec3(0.0f, 0.0f, 0.1f));
 	  RenderModel.view = glm::lookAt(glm::vec3(1.0f, 2.0f, 1.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 	  RenderModel.proj = glm::perspective(glm::radians(45.0f),swapChainExtent.width / (float) swapChainExtent.height,0.5f,10.0f);
 	  RenderModel.proj[1][1] *= -1;// since GLM was originaly intendet for openGL we have to invert the Y coordinates
 
 	  //copy the transformation data to buffer
-	  memcpy(uniformBuffersMapped[currentFrame], &RenderModel, sizeof(RenderModel));
+	  frameUniformOffset = uniformRing.push(RenderModel).offset;
+	  frameTransforms = RenderModel;
 
   }
@@ -1,10 +1,12 @@
 #pragma  once
 
 #include <cstring>
+#include <chrono>
 #include <optional>
 #include <limits>
 #include <algorithm>
 #include <cstdint>
+#include <cmath>
 #include <array>
 #include <iostream>
 #include <stdexcept>
@@ -16,9 +18,28 @@
 
 #include "Verts.cpp"
 #include "UniformBufferObj.cpp"
-
-
-
+#include "MemoryAllocator.h"
+#include "UploadService.h"
+#include "PipelineCache.h"
+#include "MeshFile.h"
+#include "GpuCulling.h"
+#include "Culling.h"
+#include "ParallelRecorder.h"
+#include "JobSystem.h"
+#include "FrameLimiter.h"
+#include "GpuProfiler.h"
+#include "CpuTrace.h"
+#include "TextureLoader.h"
+#include "BindlessTextures.h"
+#include "DescriptorAllocator.h"
+#include "UniformRing.h"
+
+
+
+//where the vertex shader gets the per draw data from, see UniformBufferObj::DrawConstants
+//Instanced draws every visible copy with one call, the others issue one draw per object
+//PushConstants pushes each object's block before its draw, UniformBuffers binds a descriptor set per object pointing at its uniform buffer slot
+enum class DrawMode { Instanced, PushConstants, UniformBuffers };
 
 //basic display initialisation structure
 class Renderer {
@@ -61,6 +82,11 @@ public:
 
 	void createSurface(); // windows specific
 
+	//headless rendering into offscreen images instead of the swapchain
+	void createOffscreenTargets();
+	void drawOffscreenFrame();
+	void saveOffscreenImage(const std::string&);
+
 	bool checkDeviceExtensionSupport(VkPhysicalDevice);
 
 	SwapChainSupportDetails querySwapchainSupport(VkPhysicalDevice);
@@ -68,6 +94,7 @@ public:
 	VkSurfaceFormatKHR choseSwapChainSurfaceFormat(const std::vector<VkSurfaceFormatKHR>);
 
 	VkPresentModeKHR choseSwapChainPresentMode(const std::vector<VkPresentModeKHR>);
+	static const char* presentModeName(VkPresentModeKHR);
 
 	VkExtent2D choseSwapExtent(const VkSurfaceCapabilitiesKHR);
 
@@ -87,19 +114,27 @@ public:
 
 	void recordCommandBuffer(VkCommandBuffer, uint32_t);
 
+	void bindDrawState(VkCommandBuffer);
+
+	void recordObjectDraws(VkCommandBuffer, uint32_t begin, uint32_t end);
+
+	UniformBufferObj::DrawConstants objectDrawConstants(uint32_t drawIndex) const;
+
+	void measureRecordingScaling();
+
 	void drawFrame();
 
 	void createSyncObject();
 
-	void createVertexBuffer(Verts);
+	void createGeometry();
 
-	void createIndexBuffer(Verts);
+	void createVertexBuffer(const void*, VkDeviceSize);
 
-	void copyBuffer(VkBuffer,VkBuffer,VkDeviceSize);
+	void createIndexBuffer(const void*, VkDeviceSize);
 
 	void createTexture();
 
-	void createImage(uint32_t , uint32_t , VkFormat , VkImageTiling , VkImageUsageFlags , VkMemoryPropertyFlags , VkImage& , VkDeviceMemory& );
+	void createImage(uint32_t , uint32_t , VkFormat , VkImageTiling , VkImageUsageFlags , VkMemoryPropertyFlags , VkImage& , MemoryAllocation& , uint32_t mipLevels = 1);
 
 	void createDescriptionSetLayout();
 
@@ -107,11 +142,19 @@ public:
 
 	void updateUniformBuffer(uint32_t);
 
-	void createDescriptorPool();
+	void createInstanceBuffers();
+
+	void updateInstanceBuffer(uint32_t);
+
+
+	void createGpuCulling();
+
+	void validateGpuCulling();
+
 
 	void createDescriptorSet();
 
-	VkImageView createTextureView(VkImage,VkFormat);
+	VkImageView createTextureView(VkImage,VkFormat,uint32_t mipLevels = 1);
 
 
 
@@ -119,22 +162,46 @@ public:
 	void recreateSwapChain();
 	void cleanupSwapChain();
     static void framebufferResizeCallback(GLFWwindow*, int, int);
+	static void keyCallback(GLFWwindow*, int, int, int, int);
+	void writeTrace();
 
 	//texture processing
 	VkCommandBuffer textureLoadStart();
 	VkImageView textureView;
 	VkSampler textureSampler;
 	void textureLoadEnd(VkCommandBuffer);
-	void transitionTextureLayout(VkImage , VkFormat , VkImageLayout , VkImageLayout );
-	void copyBufferToTexture(VkBuffer , VkImage , uint32_t , uint32_t );
 
 	void createTextureImage();
 	void createTextureImageViews();
 	void createTextureSampler();
+	void registerBindlessTextures();
 
 	//texture handling
 	VkImage texture;
-	VkDeviceMemory textureMemory;
+	MemoryAllocation textureMemory;
+	VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	uint32_t textureMipLevels = 1;
+
+	//KTX2 or DDS container from tools/TextureConverter, the PNG is decoded when the container is missing or its format unsupported
+	std::string texturePath = "textures/mr_bean.ktx2";
+	std::string textureFallbackPath = "textures/mr_bean.png";
+	MipmapMode mipmapMode = MipmapMode::Gpu;
+	TextureLoader textureLoader;
+
+	//decoded images and their CPU filtered chains are kept on disk between runs
+	bool useTextureCache = true;
+	std::string textureCachePath = "texture_cache";
+
+	//one texture array in its own set for every draw, instances select their texture by index (Vulkan 1.2 descriptor indexing)
+	bool bindless = false;
+	uint32_t bindlessCapacity = 4096;
+	BindlessTextures bindlessTextures;
+
+	//loaded next to texturePath in bindless mode, instances cycle through all of them
+	std::vector<std::string> bindlessTexturePaths;
+	std::vector<LoadedTexture> extraTextures;
+	std::vector<VkImageView> extraTextureViews;
+	std::vector<uint32_t> textureSlots;
 
 	uint32_t findMemoryType(uint32_t, VkMemoryPropertyFlags);
 
@@ -142,23 +209,80 @@ public:
 
 	//attributer of Verticies to be drawn on the screen
 	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	MemoryAllocation vertexBufferMemory;
 	//Index buffer
 	VkBuffer indexBuffer;
-	VkDeviceMemory indexBuffermemory;
+	MemoryAllocation indexBuffermemory;
+	uint32_t indexCount = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+	//mesh container loaded instead of the built in geometry, see tools/MeshConverter
+	std::string meshPath;
+	glm::vec3 meshBoundsMin = glm::vec3(-1.0f);
+	glm::vec3 meshBoundsMax = glm::vec3(1.0f);
+
+	//copies of the mesh drawn with a single instanced draw call
+	uint32_t instanceCount = 1;
 
 
 	bool hasIndexBuffer = true;
 	int vertexIndex;
 
-	void createBuffer(VkDeviceSize,VkBufferUsageFlags,VkMemoryPropertyFlags,VkBuffer&,VkDeviceMemory&);
+	void createBuffer(VkDeviceSize,VkBufferUsageFlags,VkMemoryPropertyFlags,VkBuffer&,MemoryAllocation&,AllocationStrategy = AllocationStrategy::Buddy);
+
+	//every buffer and image is sub-allocated from large per memory type blocks
+	DeviceMemoryAllocator memoryAllocator;
+
+	//staging copies that overlap with rendering instead of waiting for the queue to idle
+	UploadService uploads;
+	void createUploadService();
+	UploadHandle vertexUpload = 0;
+	UploadHandle indexUpload = 0;
+	UploadHandle textureUpload = 0;
+	UploadHandle startupUpload = 0;
 
 	//Variable to keep track of the physical device
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE; //initialization required before setup so we initialize with null
 
-	//width and height for the window initialization
-	const uint32_t WIDTH = 1920;
-	const uint32_t HEIGHT = 1080;
+	//optional features turned on in createLogicalDevice
+	VkPhysicalDeviceFeatures enabledFeatures{};
+	VkPhysicalDeviceVulkan12Features enabledVulkan12Features{};
+
+	//width and height for the window initialization, and of the offscreen targets when headless
+	uint32_t WIDTH = 1920;
+	uint32_t HEIGHT = 1080;
+
+	//headless mode renders a fixed number of frames without a window or surface
+	bool headless = false;
+	uint32_t headlessFrames = 60;
+	std::string headlessOutput;
+
+	//seconds of animation per frame, 0 follows the wall clock, benchmarks fix it so every run renders the same frames
+	double fixedTimestep = 0.0;
+	uint64_t simulatedFrames = 0;
+
+	//headless per frame CPU timings for the benchmark harness, only collected when recordFrameTimes is set
+	//frame time runs from one frame start to the next, submit time from the end of the fence wait to the return of vkQueueSubmit
+	bool recordFrameTimes = false;
+	std::vector<double> frameMilliseconds;
+	std::vector<double> submitMilliseconds;
+	std::chrono::steady_clock::time_point lastFrameStart{};
+
+	//time spent in recordCommandBuffer and the draw commands it recorded, collected with the frame times
+	std::vector<double> recordMilliseconds;
+	std::vector<uint32_t> recordedDraws;
+	uint32_t lastRecordedDraws = 0;
+
+	//Chrome trace of the CPU zones, written at exit and when F12 is pressed, empty disables recording
+	std::string traceOutput;
+
+	//compiled pipelines are kept on disk between runs
+	bool usePipelineCache = true;
+	std::string pipelineCachePath = "pipeline_cache.bin";
+	PipelineCache pipelineCache;
+
+	//offscreen color targets used in place of the swapchain images when headless
+	std::vector<MemoryAllocation> offscreenImagesMemory;
 
 	//structure we store the windows we create in
     GLFWwindow* window;
@@ -172,6 +296,9 @@ public:
 	//interface to display to the screen
 	VkQueue presentationQueue;
 
+	//interface for asynchronous copies, stays null when the device has no separate transfer family
+	VkQueue transferQueue = VK_NULL_HANDLE;
+
 	//surface to display to the window 
 	VkSurfaceKHR surface; //this is widnows specific
 
@@ -197,6 +324,18 @@ public:
 	//Graphical pipeline
 	VkPipeline graphicsPipeline;
 
+	//variant for meshes stored with Verts::packedVerts
+	VkPipeline packedGraphicsPipeline;
+	bool packedVertices = false;
+	//pushed once for instanced draws, per object draws start from a copy, holds the frame's object transform and the dequantization
+	UniformBufferObj::DrawConstants drawConstants{ glm::mat4(1.0f), glm::vec4(1.0f), glm::vec4(0.0f), glm::vec4(1.0f), 0 };
+
+	DrawMode drawMode = DrawMode::Instanced;
+
+	//DrawMode::UniformBuffers only, the drawn objects' blocks sit back to back in the ring from this offset on
+	uint32_t objectUniformOffset = 0;
+	VkDeviceSize objectUniformStride = 0;
+
 	//frame buffers
 	std::vector<VkFramebuffer> swapChainFrameBuffers;
 
@@ -213,13 +352,24 @@ public:
 	//keep track weather or not we resize
 	bool frameBufferResized = false;
 
-	//list of extensions to search for
-	const std::vector<const char*> deviceExtensions = {
+	//list of extensions to search for (cleared when running headless)
+	std::vector<const char*> deviceExtensions = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
 
-	//max frames we want to run parralel to each other
-	const int MAX_FRAMES_IN_FLIGHT = 2;
+	//frames the CPU may record ahead of the GPU, 1 for the lowest latency, 3 to keep the GPU busiest
+	uint32_t framesInFlight = 2;
+
+	//preferred presentation, falls back to the closest mode the surface supports
+	VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+	//optional frame rate cap, applied before acquiring the next image
+	FrameLimiter frameLimiter;
+
+	//timestamp scopes around the passes of recordCommandBuffer, printed when the render loop ends
+	bool gpuProfile = false;
+	GpuProfiler profiler;
+	double profiledUploadMilliseconds = 0.0;
 
 	//keep track of current frame
 	uint32_t currentFrame = 0;
@@ -228,17 +378,54 @@ public:
 	const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 
 	//Descriptor buffers
-	VkDescriptorSetLayout descriptorSet;
 	VkPipelineLayout descriptorPipelineLayout;
-	VkDescriptorPool descriptorPool;
-	std::vector<VkDescriptorSet> descriptorSets;
+	DescriptorAllocator descriptorAllocator;
+	DescriptorLayout descriptorLayout;
+
+	//one set for every frame and draw, its uniform buffers are dynamic and the offsets pick the blocks
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
 
 	//Uniform buffers
 	VkBuffer uniformIndexBuffer;
 	VkDeviceMemory UniformIndexBufferMemory;
-	std::vector<VkBuffer> uniformBuffers;
-	std::vector<VkDeviceMemory> uniformBuffersMemory;
-	std::vector<void*> uniformBuffersMapped;
+
+	//every per frame constant block, the frame's camera block is at frameUniformOffset
+	//headroom is what a frame may allocate on top of the blocks the renderer itself writes
+	static const VkDeviceSize UNIFORM_RING_HEADROOM = 64 * 1024;
+	UniformRing uniformRing;
+	uint32_t frameUniformOffset = 0;
+
+	//per instance transforms and colors, copied into the current frame's buffer every frame
+	//the copy is split into jobs of this many instances
+	static const uint32_t INSTANCE_UPDATE_GRAIN = 4096;
+	std::vector<Verts::instance> instances;
+	std::vector<VkBuffer> instanceBuffers;
+	std::vector<MemoryAllocation> instanceBuffersMemory;
+	std::vector<void*> instanceBuffersMapped;
+
+	//matrices of the frame being recorded
+	UniformBufferObj::UniformBufferObject frameTransforms{};
+
+	//compute pass that culls the instances and writes the indirect draws
+	bool gpuCulling = false;
+	GpuCulling culling;
+	Frustum cullFrustum{};
+
+	//CPU alternative, the visible instances are packed into the instance buffer before drawing
+	bool cpuCulling = false;
+	CullingKernel cullingKernel = CullingKernel::Scalar;
+	CullingBvh cullingBvh;
+	std::vector<uint32_t> visibleInstances;
+	uint32_t drawInstanceCount = 0;
+
+	//0 records inline on the main thread, otherwise the draw list is split into this many slices recorded as jobs
+	uint32_t recordThreads = 0;
+	bool recordScaling = false;
+	ParallelRecorder recorder;
+
+	//worker threads for culling, instance updates and recording, the main thread joins in while it waits
+	uint32_t jobWorkers = JobSystem::defaultWorkerCount();
+	JobSystem jobs;
 
 	//validation layer settings
     //Validation layers are deactivated as they cause a crash on cleanup
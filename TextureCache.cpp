@@ -0,0 +1,182 @@
+#include "TextureCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "MappedFile.h"
+
+
+//FNV-1a over 8 byte words with a fold after every step, a byte at a time would cost as much as some of the decodes it replaces
+static uint64_t hashBytes(const uint8_t* data, size_t size) {
+
+	uint64_t hash = 14695981039346656037ull;
+	size_t offset = 0;
+	for (; offset + 8 <= size; offset += 8) {
+		uint64_t word;
+		memcpy(&word, data + offset, 8);
+		hash = (hash ^ word) * 1099511628211ull;
+		hash ^= hash >> 32;
+	}
+	for (; offset < size; offset++) {
+		hash = (hash ^ data[offset]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static int64_t microsecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TextureCache::init(const std::string& directory) {
+	this->directory = directory;
+}
+
+void TextureCache::lookup(TextureSource& source) {
+
+	source.cachePath.clear();
+	source.cached = false;
+	if (source.container || source.levelOffsets.size() > TEXTURE_CACHE_MAX_LEVELS) {
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.open(source.path)) {
+		return;
+	}
+	source.sourceHash = hashBytes(file.data(), file.size());
+	source.sourceSize = file.size();
+	file.close();
+	hashMicroseconds += microsecondsSince(start);
+
+	//same content in the same format and layout is the same entry, wherever the source lives
+	char name[96];
+	snprintf(name, sizeof(name), "%016llx_%u_%u_%u.rtc", static_cast<unsigned long long>(source.sourceHash), static_cast<uint32_t>(source.format),
+		source.mipLevels, static_cast<uint32_t>(source.levelOffsets.size()));
+	source.cachePath = (std::filesystem::path(directory) / name).string();
+
+	MappedFile entry;
+	if (entry.open(source.cachePath) && entry.size() >= sizeof(TextureCacheFileHeader)) {
+		TextureCacheFileHeader header;
+		memcpy(&header, entry.data(), sizeof(header));
+		source.cached = validate(source, header, entry.size());
+	}
+}
+
+bool TextureCache::load(const TextureSource& source, uint8_t* destination) {
+
+	auto start = std::chrono::steady_clock::now();
+
+	MappedFile entry;
+	if (!entry.open(source.cachePath) || entry.size() < sizeof(TextureCacheFileHeader)) {
+		return false;
+	}
+
+	TextureCacheFileHeader header;
+	memcpy(&header, entry.data(), sizeof(header));
+	if (!validate(source, header, entry.size())) {
+		return false;
+	}
+
+	//the levels are stored exactly as they are staged, one copy out of the page cache and done
+	memcpy(destination, entry.data() + header.dataOffset, static_cast<size_t>(header.dataSize));
+
+	hits++;
+	savedMicroseconds += static_cast<int64_t>(header.decodeMilliseconds * 1000.0f) - microsecondsSince(start);
+	return true;
+}
+
+//write next to the entry and rename over it, a crash mid write leaves no half entry behind
+void TextureCache::store(const TextureSource& source, const uint8_t* data, double decodeMilliseconds) {
+
+	misses++;
+
+	TextureCacheFileHeader header{};
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.sourceHash = source.sourceHash;
+	header.sourceSize = source.sourceSize;
+	header.format = static_cast<uint32_t>(source.format);
+	header.width = source.width;
+	header.height = source.height;
+	header.mipLevels = source.mipLevels;
+	header.levelCount = static_cast<uint32_t>(source.levelOffsets.size());
+	header.decodeMilliseconds = static_cast<float>(decodeMilliseconds);
+	header.dataOffset = (sizeof(header) + TEXTURE_CACHE_ALIGNMENT - 1) & ~(TEXTURE_CACHE_ALIGNMENT - 1);
+	header.dataSize = source.stagingSize;
+	for (size_t level = 0; level < source.levelOffsets.size(); level++) {
+		header.levelOffsets[level] = source.levelOffsets[level];
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	std::string tempPath = source.cachePath + "." + std::to_string(nextTempFile++) + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return;
+		}
+
+		std::vector<char> padding(static_cast<size_t>(header.dataOffset - sizeof(header)), 0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(padding.data(), padding.size());
+		file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(header.dataSize));
+		if (!file) {
+			file.close();
+			std::filesystem::remove(tempPath, error);
+			return;
+		}
+	}
+
+	//std::filesystem::rename replaces the target on windows too, unlike std::rename
+	std::filesystem::rename(tempPath, source.cachePath, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+TextureCacheStats TextureCache::getStats() const {
+
+	TextureCacheStats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.savedMilliseconds = savedMicroseconds / 1000.0;
+	stats.hashMilliseconds = hashMicroseconds / 1000.0;
+	return stats;
+}
+
+void TextureCache::printStats() const {
+
+	TextureCacheStats stats = getStats();
+	uint32_t lookups = stats.hits + stats.misses;
+	if (lookups == 0) {
+		return;
+	}
+
+	std::cout << "Texture cache: " << stats.hits << "/" << lookups << " hits (" << 100 * stats.hits / lookups << "%), "
+		<< stats.savedMilliseconds << " ms of decoding saved, " << stats.hashMilliseconds << " ms hashing sources in " << directory << std::endl;
+}
+
+bool TextureCache::validate(const TextureSource& source, const TextureCacheFileHeader& header, size_t fileSize) const {
+
+	if (header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION ||
+		header.sourceHash != source.sourceHash || header.sourceSize != source.sourceSize ||
+		header.format != static_cast<uint32_t>(source.format) || header.width != source.width || header.height != source.height ||
+		header.mipLevels != source.mipLevels || header.levelCount != source.levelOffsets.size() ||
+		header.dataSize != source.stagingSize || header.dataOffset % TEXTURE_CACHE_ALIGNMENT != 0 ||
+		header.dataOffset < sizeof(header) || header.dataOffset + header.dataSize > fileSize) {
+		return false;
+	}
+
+	for (uint32_t level = 0; level < header.levelCount; level++) {
+		if (header.levelOffsets[level] != source.levelOffsets[level]) {
+			return false;
+		}
+	}
+	return true;
+}
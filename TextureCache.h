@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "TextureDecoder.h"
+
+
+static const uint32_t TEXTURE_CACHE_MAGIC = 0x43545852; // "RXTC"
+static const uint32_t TEXTURE_CACHE_VERSION = 1;
+static const uint64_t TEXTURE_CACHE_ALIGNMENT = 4096;
+static const uint32_t TEXTURE_CACHE_MAX_LEVELS = 16;
+
+//front of every cache entry, the pixels start at the next page boundary so the mapping hands out page aligned levels
+//the whole key is stored too, the file name alone could collide
+struct TextureCacheFileHeader {
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t levelCount;
+
+	//what decoding took when the entry was written, a hit saves that minus the copy
+	float decodeMilliseconds;
+
+	uint64_t dataOffset;
+	uint64_t dataSize;
+
+	//relative to dataOffset, laid out exactly like the staging range
+	uint64_t levelOffsets[TEXTURE_CACHE_MAX_LEVELS];
+
+};
+
+struct TextureCacheStats {
+
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+
+	//decode time of every hit minus the time spent copying it out of the cache
+	double savedMilliseconds = 0.0;
+
+	//reading and hashing the sources, paid on hits and misses alike
+	double hashMilliseconds = 0.0;
+
+};
+
+//content addressed cache of decoded images and their CPU filtered mip chains, one file per source content and staged layout
+//a hit is mapped and copied into staging memory in one go instead of decoding the source again
+//containers are never cached, they are mapped the same way already
+class TextureCache {
+
+public:
+
+	//entries live in directory, which is created on the first store
+	void init(const std::string& directory);
+
+	//hashes the source file and points the source at its entry, call after planMipChain since the key includes the staged layout
+	//safe to call from several threads at once
+	void lookup(TextureSource&);
+
+	//copies a looked up entry, false when it vanished or broke since the lookup
+	bool load(const TextureSource&, uint8_t* destination);
+
+	//writes the staged bytes of a freshly decoded source, a failed write only costs the next start its hit
+	void store(const TextureSource&, const uint8_t* data, double decodeMilliseconds);
+
+	TextureCacheStats getStats() const;
+	void printStats() const;
+
+private:
+
+	//every field of the key has to match the source and the data has to fit the file
+	bool validate(const TextureSource&, const TextureCacheFileHeader&, size_t fileSize) const;
+
+	std::string directory;
+
+	std::atomic<uint32_t> hits{ 0 };
+	std::atomic<uint32_t> misses{ 0 };
+	std::atomic<int64_t> savedMicroseconds{ 0 };
+	std::atomic<int64_t> hashMicroseconds{ 0 };
+
+	//temp files get unique names, identical sources decoded at the same time write the same entry
+	std::atomic<uint32_t> nextTempFile{ 0 };
+
+};
@@ -0,0 +1,116 @@
+#include "TextureDecoder.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "CpuTrace.h"
+#include "Mipmaps.h"
+#include "TextureCache.h"
+
+
+bool probeTexture(const std::string& path, TextureSource& source) {
+
+	source = TextureSource();
+	source.path = path;
+
+	//containers are told apart by their magic, so a failed open just means the file is something else
+	TextureFile file;
+	if (file.open(path)) {
+		source.container = true;
+		source.format = file.format();
+		source.width = file.width();
+		source.height = file.height();
+		source.mipLevels = file.levelCount();
+		for (uint32_t level = 0; level < file.levelCount(); level++) {
+			source.levelOffsets.push_back(source.stagingSize);
+			source.stagingSize += file.levelSize(level);
+		}
+		return true;
+	}
+
+	int width, height, channels;
+	if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+		return false;
+	}
+
+	source.format = TextureFormat::RGBA8Srgb;
+	source.width = static_cast<uint32_t>(width);
+	source.height = static_cast<uint32_t>(height);
+	planMipChain(source, 1, false);
+	return true;
+}
+
+void planMipChain(TextureSource& source, uint32_t mipLevels, bool cpuFiltered) {
+
+	if (source.container) {
+		return;
+	}
+
+	source.mipLevels = mipLevels;
+	if (cpuFiltered && mipLevels > 1) {
+		source.stagingSize = mipChainLayout(source.width, source.height, source.levelOffsets);
+	}
+	else {
+		source.levelOffsets = { 0 };
+		source.stagingSize = uint64_t(source.width) * source.height * 4;
+	}
+}
+
+void decodeTexture(const TextureSource& source, uint8_t* destination, TextureCache* cache) {
+
+	TRACE_ZONE("decodeTexture");
+
+	if (cache != nullptr && source.cached && cache->load(source, destination)) {
+		return;
+	}
+
+	if (source.container) {
+		TextureFile file;
+		if (!file.open(source.path) || file.levelCount() != source.levelOffsets.size()) {
+			throw std::runtime_error("Failed to load texture!");
+		}
+		for (uint32_t level = 0; level < file.levelCount(); level++) {
+			memcpy(destination + source.levelOffsets[level], file.levelData(level), static_cast<size_t>(file.levelSize(level)));
+		}
+		return;
+	}
+
+	//stb_image always allocates its own output, so pixels are decoded into cached memory and copied once,
+	//the chain is filtered there too since staging memory may be write combined and slow to read back
+	auto start = std::chrono::steady_clock::now();
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(source.path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels || uint32_t(width) != source.width || uint32_t(height) != source.height) {
+		stbi_image_free(pixels);
+		throw std::runtime_error("Failed to load texture!");
+	}
+
+	std::vector<uint8_t> chain;
+	const uint8_t* staged = pixels;
+	if (source.levelOffsets.size() > 1) {
+		std::vector<uint64_t> levelOffsets;
+		chain = buildMipChain(pixels, source.width, source.height, source.format == TextureFormat::RGBA8Srgb, levelOffsets);
+		staged = chain.data();
+	}
+	memcpy(destination, staged, static_cast<size_t>(source.stagingSize));
+
+	if (cache != nullptr && !source.cachePath.empty()) {
+		cache->store(source, staged, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	stbi_image_free(pixels);
+}
+
+void decodeTextures(JobSystem& jobs, const std::vector<TextureSource>& sources, const std::vector<uint8_t*>& destinations, TextureCache* cache) {
+
+	//a decode takes milliseconds, far longer than scheduling a job, so every texture is its own job
+	jobs.parallelFor(static_cast<uint32_t>(sources.size()), 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t index = begin; index < end; index++) {
+			decodeTexture(sources[index], destinations[index], cache);
+		}
+	});
+}
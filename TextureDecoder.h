@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "TextureFile.h"
+
+
+//CPU half of texture loading, free of Vulkan so bench/TextureDecodeBench runs without a GPU
+//probing only reads headers, so the staging size of every texture is known before anything is decoded
+
+//how one texture lands in staging memory, filled in by probeTexture
+struct TextureSource {
+
+	std::string path;
+
+	//KTX2 and DDS levels are copied as stored, anything else is decoded to RGBA8 with stb_image
+	bool container = false;
+
+	TextureFormat format = TextureFormat::Undefined;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	//levels of the image, decoded images may stage only level 0 and have the rest blitted
+	uint32_t mipLevels = 1;
+
+	//one entry per staged level, relative to the start of the texture's staging range
+	std::vector<uint64_t> levelOffsets;
+	uint64_t stagingSize = 0;
+
+	//filled in by TextureCache::lookup for decoded images, cachePath stays empty when caching is off
+	uint64_t sourceHash = 0;
+	uint64_t sourceSize = 0;
+	std::string cachePath;
+
+	//a matching entry exists, decodeTexture copies it instead of decoding
+	bool cached = false;
+
+};
+
+class TextureCache;
+
+//reads the header only, false when the file is missing or neither a container nor an image stb_image reads
+bool probeTexture(const std::string& path, TextureSource&);
+
+//gives a decoded image mipLevels levels, cpuFiltered stages the whole chain, otherwise level 0 alone is staged
+void planMipChain(TextureSource&, uint32_t mipLevels, bool cpuFiltered);
+
+//writes the staged levels to destination, which has to hold stagingSize bytes
+//with a cache, looked up sources are copied from their entry and decoded ones are stored for the next start
+//safe to call from several threads at once, throws when the file changed or broke since it was probed
+void decodeTexture(const TextureSource&, uint8_t* destination, TextureCache* cache = nullptr);
+
+//one job per texture, sources[i] is written to destinations[i]
+void decodeTextures(JobSystem&, const std::vector<TextureSource>&, const std::vector<uint8_t*>& destinations, TextureCache* cache = nullptr);
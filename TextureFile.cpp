@@ -0,0 +1,447 @@
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "Mipmaps.h"
+
+
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+static uint32_t fourCC(char a, char b, char c, char d) {
+	return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+}
+
+static const TextureFormatInfo TEXTURE_FORMATS[] = {
+	{ TextureFormat::RGBA8Unorm, "RGBA8_UNORM", 1, 1, 4, false, 28 },
+	{ TextureFormat::RGBA8Srgb, "RGBA8_SRGB", 1, 1, 4, true, 29 },
+	{ TextureFormat::BC1Unorm, "BC1_UNORM", 4, 4, 8, false, 71 },
+	{ TextureFormat::BC1Srgb, "BC1_SRGB", 4, 4, 8, true, 72 },
+	{ TextureFormat::BC3Unorm, "BC3_UNORM", 4, 4, 16, false, 77 },
+	{ TextureFormat::BC3Srgb, "BC3_SRGB", 4, 4, 16, true, 78 },
+	{ TextureFormat::BC5Unorm, "BC5_UNORM", 4, 4, 16, false, 83 },
+	{ TextureFormat::BC7Unorm, "BC7_UNORM", 4, 4, 16, false, 98 },
+	{ TextureFormat::BC7Srgb, "BC7_SRGB", 4, 4, 16, true, 99 },
+	{ TextureFormat::ETC2Unorm, "ETC2_RGBA8_UNORM", 4, 4, 16, false, 0 },
+	{ TextureFormat::ETC2Srgb, "ETC2_RGBA8_SRGB", 4, 4, 16, true, 0 },
+	{ TextureFormat::ASTC4x4Unorm, "ASTC_4x4_UNORM", 4, 4, 16, false, 0 },
+	{ TextureFormat::ASTC4x4Srgb, "ASTC_4x4_SRGB", 4, 4, 16, true, 0 },
+};
+
+//fixed part of the KTX2 header, the level index follows directly
+struct Ktx2Header {
+
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+
+};
+
+struct Ktx2Level {
+
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+
+};
+
+//DDS_HEADER with the magic in front and the DX10 extension behind, the converter always writes the extension
+struct DdsHeader {
+
+	uint32_t magic;
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	uint32_t pixelFormatSize;
+	uint32_t pixelFormatFlags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t bitMasks[4];
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+
+};
+
+struct DdsHeaderDx10 {
+
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+static_assert(sizeof(DdsHeader) == 128, "DDS header layout");
+
+static const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40;
+static const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+static const uint32_t DDSCAPS2_CUBEMAP = 0x200, DDSCAPS2_VOLUME = 0x200000;
+static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+
+const TextureFormatInfo* findTextureFormat(TextureFormat format) {
+
+	for (const TextureFormatInfo& info : TEXTURE_FORMATS) {
+		if (info.format == format) {
+			return &info;
+		}
+	}
+	return nullptr;
+}
+
+uint64_t textureLevelSize(const TextureFormatInfo& info, uint32_t width, uint32_t height, uint32_t level) {
+
+	uint64_t levelWidth = std::max(1u, width >> level);
+	uint64_t levelHeight = std::max(1u, height >> level);
+	return (levelWidth + info.blockWidth - 1) / info.blockWidth * ((levelHeight + info.blockHeight - 1) / info.blockHeight) * info.blockBytes;
+}
+
+//bit offset, bit length and channel id of one sample of a data format descriptor
+//channel ids follow khr_df.h, 15 is alpha for RGBSDA, BC3 and ETC2
+struct DescriptorSample {
+
+	uint32_t offset;
+	uint32_t length;
+	uint32_t channel;
+
+};
+
+struct DescriptorLayout {
+
+	uint32_t colorModel;
+	uint32_t sampleCount;
+	DescriptorSample samples[4];
+
+};
+
+static const DescriptorLayout RGBA8_LAYOUT = { 1, 4, { { 0, 8, 0 }, { 8, 8, 1 }, { 16, 8, 2 }, { 24, 8, 15 } } };
+static const DescriptorLayout BC1_LAYOUT = { 128, 1, { { 0, 64, 1 } } }; // BC1A_ALPHAPRESENT
+static const DescriptorLayout BC3_LAYOUT = { 130, 2, { { 0, 64, 15 }, { 64, 64, 0 } } };
+static const DescriptorLayout BC5_LAYOUT = { 132, 2, { { 0, 64, 0 }, { 64, 64, 1 } } };
+static const DescriptorLayout BC7_LAYOUT = { 134, 1, { { 0, 128, 0 } } };
+static const DescriptorLayout ETC2_LAYOUT = { 161, 2, { { 0, 64, 15 }, { 64, 64, 2 } } };
+static const DescriptorLayout ASTC_LAYOUT = { 162, 1, { { 0, 128, 0 } } };
+
+//basic data format descriptor block, KTX2 requires one even though the loader only reads vkFormat
+static std::vector<uint32_t> buildDataFormatDescriptor(const TextureFormatInfo& info) {
+
+	const DescriptorLayout* layout = &ASTC_LAYOUT;
+	switch (info.format) {
+	case TextureFormat::RGBA8Unorm:
+	case TextureFormat::RGBA8Srgb:
+		layout = &RGBA8_LAYOUT;
+		break;
+	case TextureFormat::BC1Unorm:
+	case TextureFormat::BC1Srgb:
+		layout = &BC1_LAYOUT;
+		break;
+	case TextureFormat::BC3Unorm:
+	case TextureFormat::BC3Srgb:
+		layout = &BC3_LAYOUT;
+		break;
+	case TextureFormat::BC5Unorm:
+		layout = &BC5_LAYOUT;
+		break;
+	case TextureFormat::BC7Unorm:
+	case TextureFormat::BC7Srgb:
+		layout = &BC7_LAYOUT;
+		break;
+	case TextureFormat::ETC2Unorm:
+	case TextureFormat::ETC2Srgb:
+		layout = &ETC2_LAYOUT;
+		break;
+	default:
+		break;
+	}
+
+	uint32_t blockSize = 24 + 16 * layout->sampleCount;
+	std::vector<uint32_t> words;
+	words.push_back(4 + blockSize);
+	words.push_back(0); // vendor Khronos, basic descriptor type
+	words.push_back(2 | blockSize << 16); // version 2
+	//BT.709 primaries, sRGB or linear transfer, straight alpha
+	words.push_back(layout->colorModel | 1u << 8 | (info.srgb ? 2u : 1u) << 16);
+	words.push_back((info.blockWidth - 1) | (info.blockHeight - 1) << 8);
+	words.push_back(info.blockBytes);
+	words.push_back(0);
+
+	for (uint32_t i = 0; i < layout->sampleCount; i++) {
+		const DescriptorSample& sample = layout->samples[i];
+
+		//alpha is never sRGB encoded, the linear qualifier says so
+		uint32_t channel = sample.channel;
+		if (info.srgb && channel == 15) {
+			channel |= 0x10;
+		}
+		bool uncompressed = info.blockWidth == 1;
+		words.push_back(sample.offset | (sample.length - 1) << 16 | channel << 24);
+		words.push_back(0);
+		words.push_back(0);
+		words.push_back(uncompressed ? (1u << sample.length) - 1 : UINT32_MAX);
+	}
+	return words;
+}
+
+static bool validLevels(const TextureData& texture, const TextureFormatInfo* info) {
+
+	if (info == nullptr || texture.width == 0 || texture.height == 0 || texture.levels.empty()) {
+		return false;
+	}
+	for (uint32_t level = 0; level < texture.levels.size(); level++) {
+		if (texture.levels[level].size() != textureLevelSize(*info, texture.width, texture.height, level)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool writeKtx2File(const std::string& path, const TextureData& texture) {
+
+	const TextureFormatInfo* info = findTextureFormat(texture.format);
+	if (!validLevels(texture, info)) {
+		return false;
+	}
+
+	uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+	std::vector<uint32_t> descriptor = buildDataFormatDescriptor(*info);
+
+	Ktx2Header header{};
+	memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = static_cast<uint32_t>(texture.format);
+	header.typeSize = 1;
+	header.pixelWidth = texture.width;
+	header.pixelHeight = texture.height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level));
+	header.dfdByteLength = static_cast<uint32_t>(descriptor.size() * sizeof(uint32_t));
+
+	//mip padding, smallest level first, each level aligned to lcm(block size, 4) which is the block size or 4
+	uint64_t alignment = std::max<uint64_t>(4, info->blockBytes);
+	std::vector<Ktx2Level> index(levelCount);
+	uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+	for (uint32_t level = levelCount; level-- > 0;) {
+		offset = (offset + alignment - 1) / alignment * alignment;
+		index[level].byteOffset = offset;
+		index[level].byteLength = texture.levels[level].size();
+		index[level].uncompressedByteLength = texture.levels[level].size();
+		offset += texture.levels[level].size();
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Ktx2Level));
+	file.write(reinterpret_cast<const char*>(descriptor.data()), header.dfdByteLength);
+
+	const char padding[16] = {};
+	uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+	for (uint32_t level = levelCount; level-- > 0;) {
+		file.write(padding, index[level].byteOffset - written);
+		file.write(reinterpret_cast<const char*>(texture.levels[level].data()), texture.levels[level].size());
+		written = index[level].byteOffset + index[level].byteLength;
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool writeDdsFile(const std::string& path, const TextureData& texture) {
+
+	const TextureFormatInfo* info = findTextureFormat(texture.format);
+	if (!validLevels(texture, info) || info->dxgiFormat == 0) {
+		return false;
+	}
+
+	uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+
+	DdsHeader header{};
+	header.magic = DDS_MAGIC;
+	header.size = 124;
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | (levelCount > 1 ? DDSD_MIPMAPCOUNT : 0);
+	header.height = texture.height;
+	header.width = texture.width;
+	header.pitchOrLinearSize = static_cast<uint32_t>(texture.levels[0].size());
+	header.mipMapCount = levelCount;
+	header.pixelFormatSize = 32;
+	header.pixelFormatFlags = DDPF_FOURCC;
+	header.fourCC = fourCC('D', 'X', '1', '0');
+	header.caps = DDSCAPS_TEXTURE | (levelCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+	DdsHeaderDx10 extension{};
+	extension.dxgiFormat = info->dxgiFormat;
+	extension.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+	extension.arraySize = 1;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	//levels follow the headers largest first without padding
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&extension), sizeof(extension));
+	for (const std::vector<uint8_t>& level : texture.levels) {
+		file.write(reinterpret_cast<const char*>(level.data()), level.size());
+	}
+
+	return static_cast<bool>(file);
+}
+
+
+bool TextureFile::open(const std::string& path) {
+
+	levels.clear();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	bool valid = false;
+	if (file.size() >= sizeof(KTX2_IDENTIFIER) && memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+		valid = parseKtx2();
+	}
+	else if (file.size() >= sizeof(uint32_t)) {
+		uint32_t magic;
+		memcpy(&magic, file.data(), sizeof(magic));
+		valid = magic == DDS_MAGIC && parseDds();
+	}
+
+	//every level has to lie inside the mapping and match the size its format implies, the runtime copies them without further checks
+	const TextureFormatInfo* info = findTextureFormat(textureFormat);
+	valid = valid && info != nullptr && textureWidth > 0 && textureHeight > 0;
+	for (uint32_t level = 0; valid && level < levels.size(); level++) {
+		valid = levels[level].offset <= file.size() && levels[level].size <= file.size() - levels[level].offset &&
+			levels[level].size == textureLevelSize(*info, textureWidth, textureHeight, level);
+	}
+
+	if (!valid) {
+		close();
+	}
+	return valid;
+}
+
+bool TextureFile::parseKtx2() {
+
+	if (file.size() < sizeof(Ktx2Header)) {
+		return false;
+	}
+
+	Ktx2Header header;
+	memcpy(&header, file.data(), sizeof(header));
+
+	//a level count of 0 asks the loader to generate the chain, only level 0 is stored then
+	//levels past the 1x1 one would have no size, their extents and offsets are rejected before anything reads them
+	uint32_t levelCount = std::max(1u, header.levelCount);
+	if (header.supercompressionScheme != 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1 ||
+		levelCount > mipLevelCount(header.pixelWidth, header.pixelHeight) || sizeof(Ktx2Header) + uint64_t(levelCount) * sizeof(Ktx2Level) > file.size()) {
+		return false;
+	}
+
+	textureFormat = static_cast<TextureFormat>(header.vkFormat);
+	textureWidth = header.pixelWidth;
+	textureHeight = header.pixelHeight;
+
+	levels.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		Ktx2Level entry;
+		memcpy(&entry, file.data() + sizeof(Ktx2Header) + level * sizeof(Ktx2Level), sizeof(entry));
+		levels[level] = { entry.byteOffset, entry.byteLength };
+	}
+	return true;
+}
+
+bool TextureFile::parseDds() {
+
+	if (file.size() < sizeof(DdsHeader)) {
+		return false;
+	}
+
+	DdsHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (header.size != 124 || header.pixelFormatSize != 32 || (header.caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) != 0) {
+		return false;
+	}
+
+	uint64_t dataOffset = sizeof(DdsHeader);
+	textureFormat = TextureFormat::Undefined;
+
+	if ((header.pixelFormatFlags & DDPF_FOURCC) != 0 && header.fourCC == fourCC('D', 'X', '1', '0')) {
+		if (file.size() < sizeof(DdsHeader) + sizeof(DdsHeaderDx10)) {
+			return false;
+		}
+		DdsHeaderDx10 extension;
+		memcpy(&extension, file.data() + sizeof(DdsHeader), sizeof(extension));
+		if (extension.resourceDimension != DDS_DIMENSION_TEXTURE2D || extension.arraySize > 1) {
+			return false;
+		}
+		for (const TextureFormatInfo& info : TEXTURE_FORMATS) {
+			if (info.dxgiFormat != 0 && info.dxgiFormat == extension.dxgiFormat) {
+				textureFormat = info.format;
+			}
+		}
+		dataOffset += sizeof(DdsHeaderDx10);
+	}
+	//legacy headers carry no color space, they are read as UNORM
+	else if ((header.pixelFormatFlags & DDPF_FOURCC) != 0) {
+		if (header.fourCC == fourCC('D', 'X', 'T', '1')) {
+			textureFormat = TextureFormat::BC1Unorm;
+		}
+		else if (header.fourCC == fourCC('D', 'X', 'T', '5')) {
+			textureFormat = TextureFormat::BC3Unorm;
+		}
+		else if (header.fourCC == fourCC('A', 'T', 'I', '2') || header.fourCC == fourCC('B', 'C', '5', 'U')) {
+			textureFormat = TextureFormat::BC5Unorm;
+		}
+	}
+	else if ((header.pixelFormatFlags & DDPF_RGB) != 0 && (header.pixelFormatFlags & DDPF_ALPHAPIXELS) != 0 && header.rgbBitCount == 32 &&
+		header.bitMasks[0] == 0xFF && header.bitMasks[1] == 0xFF00 && header.bitMasks[2] == 0xFF0000 && header.bitMasks[3] == 0xFF000000) {
+		textureFormat = TextureFormat::RGBA8Unorm;
+	}
+
+	const TextureFormatInfo* info = findTextureFormat(textureFormat);
+	if (info == nullptr) {
+		return false;
+	}
+
+	textureWidth = header.width;
+	textureHeight = header.height;
+	uint32_t levelCount = (header.flags & DDSD_MIPMAPCOUNT) != 0 ? std::max(1u, header.mipMapCount) : 1;
+	if (levelCount > mipLevelCount(textureWidth, textureHeight)) {
+		return false;
+	}
+
+	levels.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		levels[level] = { dataOffset, textureLevelSize(*info, textureWidth, textureHeight, level) };
+		dataOffset += levels[level].size;
+	}
+	return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+
+//KTX2 and DDS containers of block compressed textures, written by tools/TextureConverter and mapped into staging memory at runtime
+//only single 2D images with an optional mip chain, no arrays, cube maps, volumes or supercompression
+
+//values are the VkFormat numbers, which is also what KTX2 stores, so this stays free of the Vulkan headers
+enum class TextureFormat : uint32_t {
+	Undefined = 0,
+	RGBA8Unorm = 37,
+	RGBA8Srgb = 43,
+	BC1Unorm = 133, // BC1_RGBA, one bit alpha
+	BC1Srgb = 134,
+	BC3Unorm = 137,
+	BC3Srgb = 138,
+	BC5Unorm = 141, // two channels, normal maps
+	BC7Unorm = 145,
+	BC7Srgb = 146,
+	ETC2Unorm = 151, // ETC2_R8G8B8A8
+	ETC2Srgb = 152,
+	ASTC4x4Unorm = 157,
+	ASTC4x4Srgb = 158
+};
+
+struct TextureFormatInfo {
+
+	TextureFormat format;
+	const char* name;
+	uint32_t blockWidth;
+	uint32_t blockHeight;
+	uint32_t blockBytes;
+	bool srgb;
+
+	//DXGI_FORMAT for the DDS DX10 header, 0 when DDS cannot store the format
+	uint32_t dxgiFormat;
+
+};
+
+//null for formats the loader does not know
+const TextureFormatInfo* findTextureFormat(TextureFormat);
+
+//bytes of one mip level, partial blocks at the edges count as whole blocks
+uint64_t textureLevelSize(const TextureFormatInfo&, uint32_t width, uint32_t height, uint32_t level);
+
+//texture while it is being converted, never used on the runtime path
+struct TextureData {
+
+	TextureFormat format = TextureFormat::Undefined;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	//level 0 first
+	std::vector<std::vector<uint8_t>> levels;
+
+};
+
+bool writeKtx2File(const std::string& path, const TextureData&);
+
+//fails for formats without a DXGI code (ETC2, ASTC)
+bool writeDdsFile(const std::string& path, const TextureData&);
+
+
+//read only view of a mapped KTX2 or DDS file, the container is told apart by its magic and not by the extension
+//level pointers stay valid until close
+class TextureFile {
+
+public:
+
+	//returns false when the file is missing, truncated, not KTX2 or DDS, or uses a format or feature the loader does not handle
+	bool open(const std::string& path);
+	void close() { file.close(); levels.clear(); }
+
+	TextureFormat format() const { return textureFormat; }
+	uint32_t width() const { return textureWidth; }
+	uint32_t height() const { return textureHeight; }
+	uint32_t levelCount() const { return static_cast<uint32_t>(levels.size()); }
+
+	//level 0 is the largest, KTX2 stores the levels smallest first and DDS largest first
+	const uint8_t* levelData(uint32_t level) const { return file.data() + levels[level].offset; }
+	uint64_t levelSize(uint32_t level) const { return levels[level].size; }
+
+	size_t fileSize() const { return file.size(); }
+
+private:
+
+	struct Level {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	bool parseKtx2();
+	bool parseDds();
+
+	MappedFile file;
+
+	TextureFormat textureFormat = TextureFormat::Undefined;
+	uint32_t textureWidth = 0;
+	uint32_t textureHeight = 0;
+	std::vector<Level> levels;
+
+};
@@ -0,0 +1,191 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include "CpuTrace.h"
+#include "Mipmaps.h"
+
+
+void TextureLoader::init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator& allocator, UploadService& uploads, JobSystem& jobs, MipmapMode mipmapMode, const std::string& cacheDirectory) {
+
+	this->physicalDevice = physicalDevice;
+	this->device = device;
+	this->allocator = &allocator;
+	this->uploads = &uploads;
+	this->jobs = &jobs;
+	this->mipmapMode = mipmapMode;
+
+	caching = !cacheDirectory.empty();
+	cache.init(cacheDirectory);
+}
+
+std::vector<LoadedTexture> TextureLoader::load(const std::vector<TextureRequest>& requests) {
+
+	TRACE_ZONE("TextureLoader::load");
+	auto start = std::chrono::steady_clock::now();
+
+	//probing opens every file and hashes the cached ones, which is worth spreading over the workers once there are hundreds
+	std::vector<TextureSource> sources(requests.size());
+	std::vector<char> fellBack(requests.size(), 0);
+	std::vector<char> found(requests.size(), 0);
+	jobs->parallelFor(static_cast<uint32_t>(requests.size()), 16, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t index = begin; index < end; index++) {
+			if (probe(requests[index].path, sources[index])) {
+				found[index] = 1;
+			}
+			else if (!requests[index].fallbackPath.empty() && probe(requests[index].fallbackPath, sources[index])) {
+				found[index] = 1;
+				fellBack[index] = 1;
+			}
+		}
+	});
+
+	//images are created on this thread, the allocator is not thread safe
+	std::vector<LoadedTexture> textures(requests.size());
+	uint32_t gpuMipmapped = 0;
+	for (size_t index = 0; index < requests.size(); index++) {
+		if (!found[index]) {
+			throw std::runtime_error("Failed to load texture " + requests[index].path + "!");
+		}
+		if (fellBack[index]) {
+			std::cout << "Texture: " << requests[index].path << " is missing or cannot be sampled, decoding " << requests[index].fallbackPath << std::endl;
+		}
+		bool generatesLevels = sources[index].levelOffsets.size() < sources[index].mipLevels;
+		gpuMipmapped += generatesLevels ? 1 : 0;
+		createImage(sources[index], generatesLevels, textures[index]);
+	}
+
+	//batches are cut in request order, texture starts are aligned for the largest block size and the copy offset rules
+	uint32_t batchCount = 0;
+	VkDeviceSize stagedBytes = 0;
+	for (size_t first = 0; first < sources.size();) {
+
+		std::vector<VkDeviceSize> offsets;
+		VkDeviceSize batchBytes = 0;
+		size_t last = first;
+		while (last < sources.size() && (last == first || batchBytes + sources[last].stagingSize <= BATCH_STAGING_BYTES)) {
+			offsets.push_back(batchBytes);
+			batchBytes = (batchBytes + sources[last].stagingSize + 15) & ~VkDeviceSize(15);
+			last++;
+		}
+
+		uploads->beginBatch("Textures");
+		UploadService::StagingRange staging = uploads->reserveStaging(batchBytes);
+
+		std::vector<TextureSource> batchSources(sources.begin() + first, sources.begin() + last);
+		std::vector<uint8_t*> destinations;
+		for (VkDeviceSize offset : offsets) {
+			destinations.push_back(staging.data + offset);
+		}
+		decodeTextures(*jobs, batchSources, destinations, caching ? &cache : nullptr);
+
+		//the copy of this batch runs while the next one is decoded
+		for (size_t index = first; index < last; index++) {
+			std::vector<VkDeviceSize> levelOffsets(sources[index].levelOffsets.begin(), sources[index].levelOffsets.end());
+			uploads->uploadImage(staging, offsets[index - first], textures[index].image, textures[index].width, textures[index].height, textures[index].mipLevels, levelOffsets);
+		}
+		UploadHandle handle = uploads->submitBatch();
+		for (size_t index = first; index < last; index++) {
+			textures[index].upload = handle;
+		}
+
+		batchCount++;
+		stagedBytes += batchBytes;
+		first = last;
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Textures: " << textures.size() << " loaded on " << jobs->getThreadCount() << " threads in " << milliseconds << " ms, "
+		<< stagedBytes / 1024 << " KiB staged in " << batchCount << " batches";
+	if (gpuMipmapped > 0) {
+		std::cout << ", " << gpuMipmapped << " mip chains blitted on the GPU";
+	}
+	std::cout << std::endl;
+	if (caching) {
+		cache.printStats();
+	}
+
+	return textures;
+}
+
+void TextureLoader::destroy(LoadedTexture& texture) {
+
+	vkDestroyImage(device, texture.image, nullptr);
+	allocator->free(texture.memory);
+	texture.image = VK_NULL_HANDLE;
+}
+
+//BC is a desktop feature and ETC2/ASTC mostly a mobile one, the format properties tell what this device samples
+bool TextureLoader::canSample(VkFormat format) const {
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+	VkFormatFeatureFlags sampleFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (formatProperties.optimalTilingFeatures & sampleFeatures) == sampleFeatures;
+}
+
+//blits read from the image itself and filter linearly, not every format supports both
+bool TextureLoader::canBlit(VkFormat format) const {
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+	VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+}
+
+//runs on job threads, vkGetPhysicalDeviceFormatProperties needs no synchronization
+bool TextureLoader::probe(const std::string& path, TextureSource& source) {
+
+	if (!probeTexture(path, source)) {
+		return false;
+	}
+	if (source.container) {
+		return canSample(static_cast<VkFormat>(source.format));
+	}
+
+	//containers carry their own chain, decoded images get theirs blitted or filtered here
+	uint32_t mipLevels = mipmapMode == MipmapMode::Off ? 1 : mipLevelCount(source.width, source.height);
+	bool gpuMipmaps = mipmapMode == MipmapMode::Gpu && canBlit(static_cast<VkFormat>(source.format));
+	planMipChain(source, mipLevels, !gpuMipmaps);
+	if (caching) {
+		cache.lookup(source);
+	}
+	return true;
+}
+
+void TextureLoader::createImage(const TextureSource& source, bool generatesLevels, LoadedTexture& texture) {
+
+	texture.path = source.path;
+	texture.format = static_cast<VkFormat>(source.format);
+	texture.width = source.width;
+	texture.height = source.height;
+	texture.mipLevels = source.mipLevels;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = source.width;
+	imageInfo.extent.height = source.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = source.mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = texture.format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (generatesLevels ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture image!");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, texture.image, &requirements);
+
+	texture.memory = allocator->allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceType::Optimal, AllocationStrategy::Buddy);
+	vkBindImageMemory(device, texture.image, texture.memory.memory, texture.memory.offset);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "MemoryAllocator.h"
+#include "TextureCache.h"
+#include "TextureDecoder.h"
+#include "UploadService.h"
+
+
+//how texture mip chains are built, Gpu still falls back to Cpu for formats without linear filtered blits
+enum class MipmapMode { Gpu, Cpu, Off };
+
+//path is a KTX2/DDS container or an image stb_image reads, fallbackPath is used when path is missing or the device cannot sample its format
+struct TextureRequest {
+	std::string path;
+	std::string fallbackPath;
+};
+
+//device local texture, destroyed through TextureLoader::destroy
+struct LoadedTexture {
+
+	std::string path;
+	VkImage image = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipLevels = 1;
+
+	//the batch copying the texture, the graphics queue waits for it by itself
+	UploadHandle upload = 0;
+
+};
+
+//loads many textures at once: headers are probed and images created up front, then the pixels are decoded on the job system
+//straight into persistently mapped staging memory, and every batch that fits the staging budget is handed to the upload service as one submit
+class TextureLoader {
+
+public:
+
+	//decoded images are cached in cacheDirectory, empty turns the cache off
+	void init(VkPhysicalDevice, VkDevice, DeviceMemoryAllocator&, UploadService&, JobSystem&, MipmapMode, const std::string& cacheDirectory = "");
+
+	//results are in request order, throws when neither path nor fallbackPath of a request can be loaded
+	//no upload batch may be open, the loader opens its own
+	std::vector<LoadedTexture> load(const std::vector<TextureRequest>&);
+
+	void destroy(LoadedTexture&);
+
+	//staging memory one batch may take, a texture larger than this goes in a batch of its own
+	static const VkDeviceSize BATCH_STAGING_BYTES = 64ull * 1024 * 1024;
+
+private:
+
+	bool canSample(VkFormat) const;
+	bool canBlit(VkFormat) const;
+	bool probe(const std::string& path, TextureSource&);
+	void createImage(const TextureSource&, bool generatesLevels, LoadedTexture&);
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+	UploadService* uploads = nullptr;
+	JobSystem* jobs = nullptr;
+	MipmapMode mipmapMode = MipmapMode::Gpu;
+
+	bool caching = false;
+	TextureCache cache;
+
+};
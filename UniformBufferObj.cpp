@@ -10,10 +10,20 @@ class UniformBufferObj {
 
 public:
 
+	//per frame, written once before recording
 	struct UniformBufferObject {
-		glm::mat4 model;
 		glm::mat4 view;
 		glm::mat4 proj;
 	};
 
+	//per draw data, pushed before every draw or once for the whole instanced draw
+	//DrawMode::UniformBuffers writes the same block into a uniform buffer slot per object instead
+	struct DrawConstants {
+		glm::mat4 model; // object transform, instanced draws multiply the instance's on top
+		glm::vec4 scale; // turns quantized positions back into object space, identity for float vertices
+		glm::vec4 offset;
+		glm::vec4 color; // rgb multiplied with the vertex color, alpha unused
+		uint32_t textureIndex; // slot in the bindless texture array
+	};
+
 };
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+void UniformRing::init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator& allocator, VkDeviceSize bytesPerFrame, uint32_t framesInFlight) {
+
+	this->device = device;
+	this->allocator = &allocator;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+	frameSize = alignedSize(bytesPerFrame);
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = frameSize * framesInFlight;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform ring buffer!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	//coherent so writes need no flush, the buddy strategy since the ring is one large long lived buffer
+	memory = allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ResourceType::Linear, AllocationStrategy::Buddy);
+	vkBindBufferMemory(device, buffer, memory.memory, memory.offset);
+
+	frameBegin = 0;
+	head = 0;
+	peakBytes = 0;
+}
+
+void UniformRing::destroy() {
+
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+	vkDestroyBuffer(device, buffer, nullptr);
+	allocator->free(memory);
+	buffer = VK_NULL_HANDLE;
+}
+
+void UniformRing::beginFrame(uint32_t frame) {
+
+	peakBytes = std::max(peakBytes, head - frameBegin);
+	frameBegin = frame * frameSize;
+	head = frameBegin;
+}
+
+UniformAllocation UniformRing::allocate(VkDeviceSize size) {
+
+	VkDeviceSize aligned = alignedSize(size);
+	if (head + aligned > frameBegin + frameSize) {
+		throw std::runtime_error("Failed to allocate uniform block, the frame's partition of the ring is full!");
+	}
+
+	UniformAllocation allocation;
+	allocation.data = static_cast<uint8_t*>(memory.mapped) + head;
+	allocation.offset = static_cast<uint32_t>(head);
+	head += aligned;
+	return allocation;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "MemoryAllocator.h"
+
+
+//one block written this frame, data is the mapped pointer and offset the dynamic offset to bind it with
+struct UniformAllocation {
+	void* data = nullptr;
+	uint32_t offset = 0;
+};
+
+//every per frame constant block comes out of one persistently mapped host visible uniform buffer
+//the buffer is split into a partition per frame in flight, and each partition is filled front to back by bumping an aligned head
+//nothing is freed on its own, beginFrame drops the whole partition once the frame that read it has finished
+//descriptors bind the buffer once as UNIFORM_BUFFER_DYNAMIC and every bind passes the offsets of the blocks it uses
+class UniformRing {
+
+public:
+
+	//largest minUniformBufferOffsetAlignment the spec allows, for sizing partitions before the device is known
+	static const VkDeviceSize MAX_ALIGNMENT = 256;
+
+	//bytesPerFrame is rounded up to the device's minUniformBufferOffsetAlignment
+	void init(VkPhysicalDevice, VkDevice, DeviceMemoryAllocator&, VkDeviceSize bytesPerFrame, uint32_t framesInFlight);
+	void destroy();
+
+	//the frame's fence must have signalled
+	void beginFrame(uint32_t frame);
+
+	//O(1), the offset is aligned for dynamic uniform buffers, throws when the frame's partition is full
+	UniformAllocation allocate(VkDeviceSize size);
+
+	template<typename T>
+	UniformAllocation push(const T& value) {
+		UniformAllocation allocation = allocate(sizeof(T));
+		memcpy(allocation.data, &value, sizeof(T));
+		return allocation;
+	}
+
+	//stride of consecutive blocks of this size in one allocation, so each can be bound with its own dynamic offset
+	VkDeviceSize alignedSize(VkDeviceSize size) const { return (size + alignment - 1) / alignment * alignment; }
+
+	VkBuffer getBuffer() const { return buffer; }
+	VkDeviceSize getFrameSize() const { return frameSize; }
+
+	//most bytes any frame used, to size bytesPerFrame
+	VkDeviceSize getPeakBytes() const { return peakBytes; }
+
+private:
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+
+	VkDeviceSize alignment = 256;
+	VkDeviceSize frameSize = 0;
+
+	//absolute offsets into the buffer, the current partition is [frameBegin, frameBegin + frameSize)
+	VkDeviceSize frameBegin = 0;
+	VkDeviceSize head = 0;
+	VkDeviceSize peakBytes = 0;
+
+};
@@ -0,0 +1,604 @@
+#include "UploadService.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+
+void UploadService::init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceMemoryAllocator& allocator, uint32_t graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> transferFamily, VkQueue transferQueue, bool hostQueryReset) {
+
+	this->device = device;
+	this->allocator = &allocator;
+	this->graphicsFamily = graphicsFamily;
+	this->graphicsQueue = graphicsQueue;
+	this->hostQueryReset = hostQueryReset;
+
+	//without a separate family the copies are recorded on the graphics queue and no ownership transfer is needed
+	dedicatedTransfer = transferFamily.has_value() && transferFamily.value() != graphicsFamily && transferQueue != VK_NULL_HANDLE;
+	this->transferFamily = dedicatedTransfer ? transferFamily.value() : graphicsFamily;
+	this->transferQueue = dedicatedTransfer ? transferQueue : graphicsQueue;
+
+	//timestamps are only meaningful when the copy queue has valid bits
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+	uint32_t validBits = queueFamilyProperties[this->transferFamily].timestampValidBits;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	timestampsSupported = validBits > 0 && (!dedicatedTransfer || hostQueryReset);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = this->transferFamily;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create transfer command pool!");
+	}
+
+	if (dedicatedTransfer) {
+		poolInfo.queueFamilyIndex = graphicsFamily;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &acquirePool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create acquire command pool!");
+		}
+	}
+}
+
+void UploadService::destroy() {
+
+	//a batch nobody submitted still owns staging memory
+	if (openBatch.has_value()) {
+		submitBatch();
+	}
+
+	for (PendingUpload& upload : pending) {
+		vkWaitForFences(device, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+		retire(upload);
+	}
+	pending.clear();
+
+	if (acquirePool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(device, acquirePool, nullptr);
+		acquirePool = VK_NULL_HANDLE;
+	}
+	if (transferPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(device, transferPool, nullptr);
+		transferPool = VK_NULL_HANDLE;
+	}
+}
+
+void UploadService::beginBatch(const std::string& label) {
+
+	if (openBatch.has_value()) {
+		throw std::runtime_error("Upload batch already open!");
+	}
+
+	openBatch.emplace();
+	openBatch->handle = nextHandle++;
+	openBatch->label = label;
+}
+
+UploadHandle UploadService::submitBatch() {
+
+	if (!openBatch.has_value()) {
+		throw std::runtime_error("No upload batch open!");
+	}
+
+	PendingUpload batch = std::move(openBatch.value());
+	openBatch.reset();
+
+	return submit(batch);
+}
+
+UploadHandle UploadService::uploadBuffer(const void* data, VkDeviceSize size, VkBuffer destination, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+
+	bool single = !openBatch.has_value();
+	if (single) {
+		beginBatch();
+	}
+
+	openBatch->bufferCopies.push_back({ stage(data, size), destination, size, dstStage, dstAccess });
+
+	return single ? submitBatch() : openBatch->handle;
+}
+
+UploadHandle UploadService::uploadImage(const void* data, VkDeviceSize size, VkImage destination, uint32_t width, uint32_t height, uint32_t mipLevels, const std::vector<VkDeviceSize>& levelOffsets) {
+
+	if (levelOffsets.size() > mipLevels) {
+		throw std::runtime_error("Failed to upload image, more levels than the image has!");
+	}
+
+	bool single = !openBatch.has_value();
+	if (single) {
+		beginBatch();
+	}
+
+	ImageCopy copy{ stage(data, size), destination, width, height, mipLevels, levelOffsets };
+	if (copy.levelOffsets.empty()) {
+		copy.levelOffsets.push_back(0);
+	}
+	openBatch->imageCopies.push_back(copy);
+
+	return single ? submitBatch() : openBatch->handle;
+}
+
+UploadService::StagingRange UploadService::reserveStaging(VkDeviceSize size) {
+
+	if (!openBatch.has_value()) {
+		throw std::runtime_error("Failed to reserve staging memory, no upload batch is open!");
+	}
+
+	StagingBuffer staging = createStagingBuffer(size);
+	return { staging.buffer, static_cast<uint8_t*>(staging.memory.mapped), size };
+}
+
+UploadHandle UploadService::uploadImage(const StagingRange& staging, VkDeviceSize offset, VkImage destination, uint32_t width, uint32_t height, uint32_t mipLevels, const std::vector<VkDeviceSize>& levelOffsets) {
+
+	if (!openBatch.has_value()) {
+		throw std::runtime_error("Failed to upload image, reserved staging memory needs an open batch!");
+	}
+	if (levelOffsets.size() > mipLevels) {
+		throw std::runtime_error("Failed to upload image, more levels than the image has!");
+	}
+
+	ImageCopy copy{ staging.buffer, destination, width, height, mipLevels, levelOffsets };
+	if (copy.levelOffsets.empty()) {
+		copy.levelOffsets.push_back(0);
+	}
+	for (VkDeviceSize& levelOffset : copy.levelOffsets) {
+		levelOffset += offset;
+	}
+	openBatch->imageCopies.push_back(copy);
+
+	return openBatch->handle;
+}
+
+bool UploadService::isComplete(UploadHandle handle) {
+
+	PendingUpload* upload = findUpload(handle);
+
+	//collected uploads are no longer tracked
+	if (upload == nullptr) {
+		return true;
+	}
+
+	return vkGetFenceStatus(device, upload->fence) == VK_SUCCESS;
+}
+
+void UploadService::wait(UploadHandle handle) {
+
+	PendingUpload* upload = findUpload(handle);
+
+	if (upload != nullptr) {
+		auto start = std::chrono::steady_clock::now();
+		vkWaitForFences(device, 1, &upload->fence, VK_TRUE, UINT64_MAX);
+		upload->cpuWaitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+void UploadService::collect() {
+
+	auto finished = std::remove_if(pending.begin(), pending.end(), [this](PendingUpload& upload) {
+		if (vkGetFenceStatus(device, upload.fence) != VK_SUCCESS) {
+			return false;
+		}
+		retire(upload);
+		return true;
+	});
+
+	pending.erase(finished, pending.end());
+}
+
+//copy the data into its own persistently mapped staging buffer
+VkBuffer UploadService::stage(const void* data, VkDeviceSize size) {
+
+	StagingBuffer staging = createStagingBuffer(size);
+	memcpy(staging.memory.mapped, data, static_cast<size_t>(size));
+	return staging.buffer;
+}
+
+//the open batch owns the buffer from here on
+UploadService::StagingBuffer UploadService::createStagingBuffer(VkDeviceSize size) {
+
+	StagingBuffer staging;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &staging.buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create staging buffer!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, staging.buffer, &memRequirements);
+
+	staging.memory = allocator->allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ResourceType::Linear, AllocationStrategy::Linear);
+	vkBindBufferMemory(device, staging.buffer, staging.memory.memory, staging.memory.offset);
+
+	openBatch->staging.push_back(staging);
+	openBatch->bytes += size;
+
+	return staging;
+}
+
+//record every copy of the batch with one barrier before and one barrier after the copies
+void UploadService::record(PendingUpload& upload) {
+
+	upload.transferCommands = beginCommands(transferPool);
+	if (dedicatedTransfer) {
+		upload.acquireCommands = beginCommands(acquirePool);
+	}
+
+	if (upload.timestamps != VK_NULL_HANDLE) {
+		if (!dedicatedTransfer) {
+			vkCmdResetQueryPool(upload.transferCommands, upload.timestamps, 0, 2);
+		}
+		vkCmdWriteTimestamp(upload.transferCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, upload.timestamps, 0);
+	}
+
+	VkImageMemoryBarrier imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageBarrier.subresourceRange.baseMipLevel = 0;
+	imageBarrier.subresourceRange.baseArrayLayer = 0;
+	imageBarrier.subresourceRange.layerCount = 1;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+	//images start out undefined so the transfer queue can take them without an acquire
+	std::vector<VkImageMemoryBarrier> transferBarriers;
+	for (const ImageCopy& copy : upload.imageCopies) {
+		imageBarrier.image = copy.destination;
+		imageBarrier.subresourceRange.levelCount = copy.mipLevels;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.srcAccessMask = 0;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		transferBarriers.push_back(imageBarrier);
+	}
+
+	if (!transferBarriers.empty()) {
+		vkCmdPipelineBarrier(upload.transferCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, static_cast<uint32_t>(transferBarriers.size()), transferBarriers.data());
+	}
+
+	for (const BufferCopy& copy : upload.bufferCopies) {
+		VkBufferCopy copyRegion{};
+		copyRegion.size = copy.size;
+		vkCmdCopyBuffer(upload.transferCommands, copy.source, copy.destination, 1, &copyRegion);
+	}
+
+	for (const ImageCopy& copy : upload.imageCopies) {
+		std::vector<VkBufferImageCopy> regions(copy.levelOffsets.size());
+		for (uint32_t level = 0; level < regions.size(); level++) {
+			VkBufferImageCopy& region = regions[level];
+			region.bufferOffset = copy.levelOffsets[level];
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = { std::max(1u, copy.width >> level), std::max(1u, copy.height >> level), 1 };
+		}
+		vkCmdCopyBufferToImage(upload.transferCommands, copy.source, copy.destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+	}
+
+	//on a dedicated queue the after barriers release ownership and the graphics queue acquires with identical barriers
+	//layout changes are part of the ownership transfer so release and acquire describe the same transition
+	std::vector<VkBufferMemoryBarrier> releaseBuffers;
+	std::vector<VkBufferMemoryBarrier> acquireBuffers;
+	std::vector<VkImageMemoryBarrier> releaseImages;
+	std::vector<VkImageMemoryBarrier> acquireImages;
+	VkPipelineStageFlags& dstStages = upload.dstStages;
+
+	for (const BufferCopy& copy : upload.bufferCopies) {
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.buffer = copy.destination;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dedicatedTransfer ? 0 : copy.dstAccess;
+		barrier.srcQueueFamilyIndex = dedicatedTransfer ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = dedicatedTransfer ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+		releaseBuffers.push_back(barrier);
+
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = copy.dstAccess;
+		acquireBuffers.push_back(barrier);
+
+		dstStages |= copy.dstStage;
+	}
+
+	for (const ImageCopy& copy : upload.imageCopies) {
+		dstStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		//blits need a graphics queue, generated images move over still in TRANSFER_DST and are finished by generateMipLevels
+		bool generates = copy.generatesLevels();
+		if (generates && !dedicatedTransfer) {
+			continue;
+		}
+		VkAccessFlags consumerAccess = generates ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+
+		imageBarrier.image = copy.destination;
+		imageBarrier.subresourceRange.levelCount = copy.mipLevels;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.newLayout = generates ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.dstAccessMask = dedicatedTransfer ? 0 : consumerAccess;
+		imageBarrier.srcQueueFamilyIndex = dedicatedTransfer ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = dedicatedTransfer ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+		releaseImages.push_back(imageBarrier);
+
+		imageBarrier.srcAccessMask = 0;
+		imageBarrier.dstAccessMask = consumerAccess;
+		acquireImages.push_back(imageBarrier);
+
+		if (generates) {
+			dstStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+		}
+	}
+
+	if (dstStages != 0) {
+		vkCmdPipelineBarrier(upload.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, dedicatedTransfer ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : dstStages, 0,
+			0, nullptr,
+			static_cast<uint32_t>(releaseBuffers.size()), releaseBuffers.data(),
+			static_cast<uint32_t>(releaseImages.size()), releaseImages.data());
+
+		if (dedicatedTransfer) {
+			vkCmdPipelineBarrier(upload.acquireCommands, dstStages, dstStages, 0,
+				0, nullptr,
+				static_cast<uint32_t>(acquireBuffers.size()), acquireBuffers.data(),
+				static_cast<uint32_t>(acquireImages.size()), acquireImages.data());
+		}
+	}
+
+	//after the acquire on a dedicated queue, right behind the copies otherwise
+	VkCommandBuffer graphicsCommands = dedicatedTransfer ? upload.acquireCommands : upload.transferCommands;
+	for (const ImageCopy& copy : upload.imageCopies) {
+		if (copy.generatesLevels()) {
+			generateMipLevels(graphicsCommands, copy);
+		}
+	}
+
+	if (upload.timestamps != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(upload.transferCommands, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, upload.timestamps, 1);
+	}
+
+	vkEndCommandBuffer(upload.transferCommands);
+	if (dedicatedTransfer) {
+		vkEndCommandBuffer(upload.acquireCommands);
+	}
+}
+
+//halves the last copied level down to 1x1 with linear filtered blits, each level is a blit source once and then handed to the fragment shader
+//every level enters in TRANSFER_DST_OPTIMAL and leaves in SHADER_READ_ONLY_OPTIMAL
+void UploadService::generateMipLevels(VkCommandBuffer commandBuffer, const ImageCopy& copy) {
+
+	uint32_t firstGenerated = static_cast<uint32_t>(copy.levelOffsets.size());
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = copy.destination;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	//copied levels above the blit source are done already
+	if (firstGenerated > 1) {
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = firstGenerated - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	barrier.subresourceRange.levelCount = 1;
+
+	for (uint32_t level = firstGenerated; level < copy.mipLevels; level++) {
+		int32_t sourceWidth = static_cast<int32_t>(std::max(1u, copy.width >> (level - 1)));
+		int32_t sourceHeight = static_cast<int32_t>(std::max(1u, copy.height >> (level - 1)));
+
+		//the level above was written by a copy or the previous blit
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageBlit blit{};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { sourceWidth, sourceHeight, 1 };
+		blit.dstSubresource = blit.srcSubresource;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { std::max(1, sourceWidth / 2), std::max(1, sourceHeight / 2), 1 };
+		vkCmdBlitImage(commandBuffer, copy.destination, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, copy.destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	//the smallest level is only ever written
+	barrier.subresourceRange.baseMipLevel = copy.mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+UploadHandle UploadService::submit(PendingUpload& upload) {
+
+	if (timestampsSupported) {
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = 2;
+
+		if (vkCreateQueryPool(device, &queryInfo, nullptr, &upload.timestamps) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create upload query pool!");
+		}
+		if (dedicatedTransfer) {
+			vkResetQueryPool(device, upload.timestamps, 0, 2);
+		}
+	}
+
+	record(upload);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkCreateFence(device, &fenceInfo, nullptr, &upload.fence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create upload fence!");
+	}
+
+	VkSubmitInfo transferSubmit{};
+	transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	transferSubmit.commandBufferCount = 1;
+	transferSubmit.pCommandBuffers = &upload.transferCommands;
+
+	if (!dedicatedTransfer) {
+		//later graphics submissions are ordered behind the barrier recorded with the copies
+		if (vkQueueSubmit(transferQueue, 1, &transferSubmit, upload.fence) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit upload!");
+		}
+	}
+	else {
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &upload.transferFinished) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create upload semaphore!");
+		}
+
+		transferSubmit.signalSemaphoreCount = 1;
+		transferSubmit.pSignalSemaphores = &upload.transferFinished;
+
+		if (vkQueueSubmit(transferQueue, 1, &transferSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit upload!");
+		}
+
+		//the acquire only blocks the stages that consume the data, everything else keeps running
+		VkSubmitInfo acquireSubmit{};
+		acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireSubmit.waitSemaphoreCount = 1;
+		acquireSubmit.pWaitSemaphores = &upload.transferFinished;
+		acquireSubmit.pWaitDstStageMask = &upload.dstStages;
+		acquireSubmit.commandBufferCount = 1;
+		acquireSubmit.pCommandBuffers = &upload.acquireCommands;
+
+		if (vkQueueSubmit(graphicsQueue, 1, &acquireSubmit, upload.fence) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit upload acquire!");
+		}
+	}
+
+	upload.submitTime = std::chrono::steady_clock::now();
+
+	UploadHandle handle = upload.handle;
+	pending.push_back(std::move(upload));
+
+	return handle;
+}
+
+//fold the timings into the totals and give back everything the upload owned
+void UploadService::retire(PendingUpload& upload) {
+
+	double gpuMilliseconds = -1.0;
+	if (upload.timestamps != VK_NULL_HANDLE) {
+		uint64_t ticks[2] = {};
+		if (vkGetQueryPoolResults(device, upload.timestamps, 0, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			gpuMilliseconds = static_cast<double>((ticks[1] - ticks[0]) & timestampMask) * timestampPeriod / 1e6;
+			stats.gpuMilliseconds += gpuMilliseconds;
+		}
+		vkDestroyQueryPool(device, upload.timestamps, nullptr);
+	}
+
+	stats.batchCount++;
+	stats.copyCount += static_cast<uint32_t>(upload.bufferCopies.size() + upload.imageCopies.size());
+	stats.bytes += upload.bytes;
+	stats.cpuWaitMilliseconds += upload.cpuWaitMilliseconds;
+
+	if (!upload.label.empty()) {
+		//completion is only noticed when polled, so the latency is an upper bound
+		double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload.submitTime).count();
+
+		std::cout << upload.label << " uploads: " << upload.bufferCopies.size() + upload.imageCopies.size() << " copies, "
+			<< upload.bytes / 1024 << " KiB in one submit, GPU ";
+		if (gpuMilliseconds >= 0.0) {
+			std::cout << gpuMilliseconds << " ms";
+		}
+		else {
+			std::cout << "n/a";
+		}
+		std::cout << ", CPU waited " << upload.cpuWaitMilliseconds << " ms, retired " << latency << " ms after submit" << std::endl;
+	}
+
+	vkDestroyFence(device, upload.fence, nullptr);
+	if (upload.transferFinished != VK_NULL_HANDLE) {
+		vkDestroySemaphore(device, upload.transferFinished, nullptr);
+	}
+
+	vkFreeCommandBuffers(device, transferPool, 1, &upload.transferCommands);
+	if (upload.acquireCommands != VK_NULL_HANDLE) {
+		vkFreeCommandBuffers(device, acquirePool, 1, &upload.acquireCommands);
+	}
+
+	for (StagingBuffer& staging : upload.staging) {
+		vkDestroyBuffer(device, staging.buffer, nullptr);
+		allocator->free(staging.memory);
+	}
+}
+
+VkCommandBuffer UploadService::beginCommands(VkCommandPool pool) {
+
+	VkCommandBufferAllocateInfo allocationInfo{};
+	allocationInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocationInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocationInfo.commandPool = pool;
+	allocationInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &allocationInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate upload command buffer!");
+	}
+
+	VkCommandBufferBeginInfo startInfo{};
+	startInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	startInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &startInfo);
+
+	return commandBuffer;
+}
+
+UploadService::PendingUpload* UploadService::findUpload(UploadHandle handle) {
+
+	for (PendingUpload& upload : pending) {
+		if (upload.handle == handle) {
+			return &upload;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+
+//identifies a submitted upload, 0 is never handed out
+using UploadHandle = uint64_t;
+
+//totals over every batch the service has retired
+struct UploadStats {
+
+	uint32_t batchCount = 0;
+	uint32_t copyCount = 0;
+	VkDeviceSize bytes = 0;
+
+	//time the copy queue spent executing upload commands, from timestamp queries
+	double gpuMilliseconds = 0.0;
+
+	//time the CPU spent blocked in wait()
+	double cpuWaitMilliseconds = 0.0;
+
+};
+
+//copies staging data into device local buffers and images without stalling the CPU
+//uploads run on a dedicated transfer queue when the device has one and are then handed to the graphics queue
+class UploadService {
+
+public:
+
+	void init(VkPhysicalDevice, VkDevice, DeviceMemoryAllocator&, uint32_t graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> transferFamily, VkQueue transferQueue, bool hostQueryReset);
+	void destroy();
+
+	//every upload between beginBatch and submitBatch shares one command buffer, one set of barriers and one fence
+	//uploads outside of a batch are submitted on their own
+	void beginBatch(const std::string& label = "");
+	UploadHandle submitBatch();
+
+	//data is copied into staging memory before returning, the caller can release it right away
+	//inside a batch the returned handle is the batch handle
+	UploadHandle uploadBuffer(const void* data, VkDeviceSize size, VkBuffer destination, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	//data holds one level per entry of levelOffsets starting at level 0, no offsets means level 0 alone at offset 0
+	//levels of the mipLevels the data does not cover are blitted down from the last copied one on the graphics queue,
+	//which needs a format with linear filter blit support and an image created with TRANSFER_SRC usage
+	UploadHandle uploadImage(const void* data, VkDeviceSize size, VkImage destination, uint32_t width, uint32_t height, uint32_t mipLevels = 1, const std::vector<VkDeviceSize>& levelOffsets = {});
+
+	//persistently mapped staging memory the caller fills itself, e.g. from job threads, instead of having it copied in
+	//only inside a batch, which owns the memory and releases it once the batch is retired
+	struct StagingRange {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		uint8_t* data = nullptr;
+		VkDeviceSize size = 0;
+	};
+	StagingRange reserveStaging(VkDeviceSize size);
+
+	//same as above with the levels already in a reserved range, levelOffsets are relative to offset
+	UploadHandle uploadImage(const StagingRange&, VkDeviceSize offset, VkImage destination, uint32_t width, uint32_t height, uint32_t mipLevels = 1, const std::vector<VkDeviceSize>& levelOffsets = {});
+
+	//poll or block on a single upload
+	bool isComplete(UploadHandle);
+	void wait(UploadHandle);
+
+	//release staging memory and command buffers of finished uploads, call once per frame
+	void collect();
+
+	bool hasDedicatedTransferQueue() const { return dedicatedTransfer; }
+	const UploadStats& getStats() const { return stats; }
+
+private:
+
+	struct BufferCopy {
+		VkBuffer source;
+		VkBuffer destination;
+		VkDeviceSize size;
+		VkPipelineStageFlags dstStage;
+		VkAccessFlags dstAccess;
+	};
+
+	struct ImageCopy {
+		VkBuffer source;
+		VkImage destination;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+
+		//one entry per copied level, every level after them is generated
+		std::vector<VkDeviceSize> levelOffsets;
+
+		bool generatesLevels() const { return levelOffsets.size() < mipLevels; }
+	};
+
+	struct StagingBuffer {
+		VkBuffer buffer;
+		MemoryAllocation memory;
+	};
+
+	struct PendingUpload {
+		UploadHandle handle = 0;
+		std::string label;
+
+		std::vector<BufferCopy> bufferCopies;
+		std::vector<ImageCopy> imageCopies;
+		std::vector<StagingBuffer> staging;
+		VkDeviceSize bytes = 0;
+
+		//stages that consume the uploaded data, the acquire waits on the semaphore there
+		VkPipelineStageFlags dstStages = 0;
+
+		VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+		VkCommandBuffer acquireCommands = VK_NULL_HANDLE;
+		VkSemaphore transferFinished = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+
+		//begin and end timestamps of the copy commands, null when the queue cannot time them
+		VkQueryPool timestamps = VK_NULL_HANDLE;
+
+		std::chrono::steady_clock::time_point submitTime;
+		double cpuWaitMilliseconds = 0.0;
+	};
+
+	VkBuffer stage(const void* data, VkDeviceSize size);
+	StagingBuffer createStagingBuffer(VkDeviceSize size);
+	void record(PendingUpload&);
+	void generateMipLevels(VkCommandBuffer, const ImageCopy&);
+	UploadHandle submit(PendingUpload&);
+	void retire(PendingUpload&);
+	VkCommandBuffer beginCommands(VkCommandPool);
+	PendingUpload* findUpload(UploadHandle);
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* allocator = nullptr;
+
+	uint32_t graphicsFamily = 0;
+	uint32_t transferFamily = 0;
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+
+	//true when copies run on their own queue family and ownership has to be transferred
+	bool dedicatedTransfer = false;
+
+	//transfer queues cannot reset queries in a command buffer, so timing there needs host side resets
+	bool timestampsSupported = false;
+	bool hostQueryReset = false;
+	uint64_t timestampMask = 0;
+	float timestampPeriod = 1.0f;
+
+	VkCommandPool transferPool = VK_NULL_HANDLE;
+	VkCommandPool acquirePool = VK_NULL_HANDLE;
+
+	//the batch being collected, the handle is assigned up front so uploads can return it
+	std::optional<PendingUpload> openBatch;
+
+	std::vector<PendingUpload> pending;
+	UploadHandle nextHandle = 1;
+
+	UploadStats stats;
+
+};
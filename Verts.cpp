@@ -5,19 +5,21 @@
 #include <vector>
 #include <string>
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR // Windows specific
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 
 
 class Verts {
 
 public:
 
-	const std::string imgPath = "textures/mr_bean.png";
-
 	struct verts {
 
 		glm::vec3 pos; // position of verticies
@@ -63,6 +65,91 @@ public:
 
 	};
 
+	//quantized layout, 16 bytes instead of 32, matches PackedMeshVertex in mesh containers
+	struct packedVerts {
+
+		uint16_t pos[4]; // unorm relative to the mesh bounds, dequantized in the vertex shader, w is padding
+		uint8_t color[4]; // unorm, alpha unused
+		uint16_t texture[2]; // half floats so tiling coordinates outside 0..1 survive
+
+		static VkVertexInputBindingDescription getBindingDescription() {
+
+			VkVertexInputBindingDescription bindingDescription{};
+			bindingDescription.binding = 0;
+			bindingDescription.stride = sizeof(packedVerts);
+			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+			return bindingDescription;
+		}
+
+		//same locations as verts so both layouts share one vertex shader
+		static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+			std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+
+			attributeDescriptions[0].binding = 0;
+			attributeDescriptions[0].location = 0;
+			attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+			attributeDescriptions[0].offset = offsetof(packedVerts, pos);
+
+			attributeDescriptions[1].binding = 0;
+			attributeDescriptions[1].location = 1;
+			attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+			attributeDescriptions[1].offset = offsetof(packedVerts, color);
+
+			attributeDescriptions[2].binding = 0;
+			attributeDescriptions[2].location = 2;
+			attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+			attributeDescriptions[2].offset = offsetof(packedVerts, texture);
+
+			return attributeDescriptions;
+		}
+
+	};
+
+	//per instance data, stepped once per instance from a second vertex binding
+	struct instance {
+
+		glm::mat4 model; // placement relative to the object transform in the uniform buffer
+		glm::vec3 color; // multiplied with the vertex color
+		uint32_t textureIndex; // slot in the bindless texture array, packed into what used to be the unused color alpha
+
+		static VkVertexInputBindingDescription getBindingDescription() {
+
+			VkVertexInputBindingDescription bindingDescription{};
+			bindingDescription.binding = 1;
+			bindingDescription.stride = sizeof(instance);
+			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+			return bindingDescription;
+		}
+
+		//a mat4 attribute takes one location per column
+		//the color is three floats, shaders reading it as a vec4 get an alpha of 1
+		static std::array<VkVertexInputAttributeDescription, 6> getAttributeDescriptions() {
+			std::array<VkVertexInputAttributeDescription, 6> attributeDescriptions{};
+
+			for (uint32_t column = 0; column < 4; column++) {
+				attributeDescriptions[column].binding = 1;
+				attributeDescriptions[column].location = 3 + column;
+				attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+				attributeDescriptions[column].offset = offsetof(instance, model) + sizeof(glm::vec4) * column;
+			}
+
+			attributeDescriptions[4].binding = 1;
+			attributeDescriptions[4].location = 7;
+			attributeDescriptions[4].format = VK_FORMAT_R32G32B32_SFLOAT;
+			attributeDescriptions[4].offset = offsetof(instance, color);
+
+			attributeDescriptions[5].binding = 1;
+			attributeDescriptions[5].location = 8;
+			attributeDescriptions[5].format = VK_FORMAT_R32_UINT;
+			attributeDescriptions[5].offset = offsetof(instance, textureIndex);
+
+			return attributeDescriptions;
+		}
+
+	};
+
 	//verticies and indices to be rendered
 	const std::vector<verts> verticies = {
 
@@ -79,7 +166,8 @@ public:
 
 	};
 
-	const std::vector<uint32_t> indicies = { 0,1,2,2,3,0, 4, 5, 6, 6, 7, 4 };
+	//8 vertices fit 16 bit indices, half the index bandwidth of 32 bit
+	const std::vector<uint16_t> indicies = { 0,1,2,2,3,0, 4, 5, 6, 6, 7, 4 };
 	
 
 
@@ -0,0 +1,121 @@
+//measures CPU frustum culling, CPU only so it runs without a GPU
+//usage: CullingBench [objects] [iterations]
+//every kernel, linear, through the BVH and through the BVH as jobs, is checked against the scalar reference before it is timed
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "Culling.h"
+#include "JobSystem.h"
+
+
+static double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+
+	uint32_t objectCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1000000;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+	//objects scattered through a cube around a camera looking down +x, roughly a sixth of them in view
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+	CullingBoxes boxes;
+	boxes.resize(objectCount);
+	std::vector<glm::vec3> centers(objectCount);
+	std::vector<glm::vec3> extents(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		centers[i] = glm::vec3(position(random), position(random), position(random));
+		extents[i] = glm::vec3(size(random), size(random), size(random));
+		boxes.set(i, centers[i], extents[i]);
+	}
+
+	//same conventions as updateUniformBuffer
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.5f, 400.0f);
+	proj[1][1] *= -1;
+	Frustum frustum = extractFrustum(proj * view);
+
+	std::vector<uint32_t> reference;
+	for (uint32_t i = 0; i < objectCount; i++) {
+		if (isBoxVisible(frustum, centers[i], extents[i])) {
+			reference.push_back(i);
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	CullingBvh bvh;
+	bvh.build(boxes);
+	double buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << objectCount << " objects, " << reference.size() << " visible, BVH of " << bvh.nodeCount() << " nodes built in " << buildMilliseconds << " ms" << std::endl;
+
+	std::vector<uint32_t> ids(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		ids[i] = i;
+	}
+
+	CullingKernel best = bestCullingKernel();
+	std::vector<CullingKernel> kernels = { CullingKernel::Scalar };
+	if (best != CullingKernel::Scalar) {
+		kernels.push_back(CullingKernel::SSE);
+	}
+	if (best == CullingKernel::AVX2) {
+		kernels.push_back(CullingKernel::AVX2);
+	}
+
+	JobSystem jobs;
+	jobs.init(JobSystem::defaultWorkerCount());
+
+	std::vector<uint32_t> visible;
+	visible.reserve(objectCount);
+	bool correct = true;
+
+	const char* methods[] = { " linear: ", " bvh:    ", " jobs:   " };
+
+	for (CullingKernel kernel : kernels) {
+		for (int method = 0; method < 3; method++) {
+
+			std::vector<double> times;
+			for (int i = 0; i < iterations; i++) {
+				start = std::chrono::steady_clock::now();
+				if (method == 2) {
+					bvh.cull(jobs, kernel, frustum, visible);
+				}
+				else if (method == 1) {
+					bvh.cull(kernel, frustum, visible);
+				}
+				else {
+					visible.clear();
+					cullBoxes(kernel, frustum, boxes, ids.data(), 0, objectCount, visible);
+				}
+				times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			//the BVH reorders objects, compare as sets
+			std::sort(visible.begin(), visible.end());
+			bool match = visible == reference;
+			correct = correct && match;
+
+			double microseconds = median(times);
+			std::cout << cullingKernelName(kernel) << methods[method] << objectCount / microseconds << " objects/us, "
+				<< microseconds << " us" << (match ? "" : "  MISMATCH against scalar reference") << std::endl;
+		}
+	}
+
+	jobs.destroy();
+
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,236 @@
+//stress tests and throughput of the job system, CPU only so it runs on any machine
+//usage: JobSystemBench [stress rounds]
+//every stress check has to pass before anything is timed, the exit code reports failures
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+
+
+static bool check(bool condition, const std::string& what) {
+	if (!condition) {
+		std::cout << "FAILED: " << what << std::endl;
+	}
+	return condition;
+}
+
+static double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+//binary tree of jobs where every job spawns its children from inside the job, so the tree is spread by stealing
+static void spawnTree(JobSystem& jobs, JobCounter& counter, uint32_t depth, std::atomic<uint32_t>& leaves) {
+	if (depth == 0) {
+		leaves.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	for (int child = 0; child < 2; child++) {
+		jobs.run([&jobs, &counter, depth, &leaves] { spawnTree(jobs, counter, depth - 1, leaves); }, &counter);
+	}
+}
+
+static bool stressTree(JobSystem& jobs) {
+
+	const uint32_t depth = 14;
+	std::atomic<uint32_t> leaves{ 0 };
+	JobCounter counter;
+	spawnTree(jobs, counter, depth, leaves);
+	jobs.wait(counter);
+
+	return check(leaves.load() == (1u << depth), "nested spawning lost or repeated jobs");
+}
+
+//stages where every job of a stage depends on the counter of the stage before
+static bool stressDependencies(JobSystem& jobs) {
+
+	const uint32_t stageCount = 16;
+	const uint32_t stageWidth = 64;
+
+	std::vector<JobCounter> counters(stageCount);
+	std::vector<std::atomic<uint32_t>> finished(stageCount);
+	std::atomic<uint32_t> violations{ 0 };
+
+	for (uint32_t stage = 0; stage < stageCount; stage++) {
+		finished[stage] = 0;
+		for (uint32_t job = 0; job < stageWidth; job++) {
+			jobs.run([&, stage] {
+				if (stage > 0 && finished[stage - 1].load() != stageWidth) {
+					violations.fetch_add(1);
+				}
+				finished[stage].fetch_add(1);
+			}, &counters[stage], stage > 0 ? &counters[stage - 1] : nullptr);
+		}
+	}
+	jobs.wait(counters[stageCount - 1]);
+
+	bool complete = true;
+	for (uint32_t stage = 0; stage < stageCount; stage++) {
+		complete = complete && finished[stage].load() == stageWidth;
+	}
+	return check(violations.load() == 0, "a job ran before its dependency finished") && check(complete, "dependent jobs did not all run");
+}
+
+//every index of random sized loops is visited exactly once
+static bool stressParallelFor(JobSystem& jobs, std::mt19937& random) {
+
+	std::uniform_int_distribution<uint32_t> countDistribution(0, 100000);
+	std::uniform_int_distribution<uint32_t> grainDistribution(1, 5000);
+
+	bool correct = true;
+	for (int loop = 0; loop < 8; loop++) {
+		uint32_t count = countDistribution(random);
+		std::vector<std::atomic<uint8_t>> visits(count);
+		for (std::atomic<uint8_t>& visit : visits) {
+			visit = 0;
+		}
+
+		jobs.parallelFor(count, grainDistribution(random), [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				visits[i].fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+
+		for (const std::atomic<uint8_t>& visit : visits) {
+			correct = correct && visit.load() == 1;
+		}
+	}
+	return check(correct, "parallelFor skipped or repeated an index");
+}
+
+//a throwing job reaches the waiter and leaves the system usable
+static bool stressExceptions(JobSystem& jobs) {
+
+	JobCounter counter;
+	std::atomic<uint32_t> ran{ 0 };
+	for (int job = 0; job < 256; job++) {
+		jobs.run([&ran, job] {
+			ran.fetch_add(1);
+			if (job == 100) {
+				throw std::runtime_error("job failure");
+			}
+		}, &counter);
+	}
+
+	bool caught = false;
+	try {
+		jobs.wait(counter);
+	}
+	catch (const std::runtime_error&) {
+		caught = true;
+	}
+	return check(caught, "exception of a job was not rethrown by wait") && check(ran.load() == 256, "jobs after a throwing job did not run");
+}
+
+//jobs per microsecond for jobs that do nothing, measures the scheduler alone
+static double emptyJobThroughput(JobSystem& jobs, uint32_t jobCount) {
+
+	std::vector<double> times;
+	for (int repetition = 0; repetition < 5; repetition++) {
+		auto start = std::chrono::steady_clock::now();
+
+		//the main thread hands out batches so most jobs are pushed by workers and taken by stealing
+		JobCounter counter;
+		const uint32_t batches = 64;
+		for (uint32_t batch = 0; batch < batches; batch++) {
+			jobs.run([&jobs, &counter, jobCount] {
+				for (uint32_t job = 0; job < jobCount / batches; job++) {
+					jobs.run([] {}, &counter);
+				}
+			}, &counter);
+		}
+		jobs.wait(counter);
+
+		times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+	}
+	return jobCount / median(times);
+}
+
+//milliseconds for a compute bound loop split with parallelFor
+static double parallelForTime(JobSystem& jobs, std::vector<float>& values) {
+
+	std::vector<double> times;
+	for (int repetition = 0; repetition < 5; repetition++) {
+		auto start = std::chrono::steady_clock::now();
+
+		jobs.parallelFor(static_cast<uint32_t>(values.size()), 1024, [&values](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				float x = values[i];
+				for (int step = 0; step < 32; step++) {
+					x = std::sqrt(x * x + 1.0f) * 0.5f;
+				}
+				values[i] = x;
+			}
+		});
+
+		times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	return median(times);
+}
+
+int main(int argc, char** argv) {
+
+	int rounds = argc > 1 ? std::atoi(argv[1]) : 50;
+	uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threads = 1; threads < cores; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(cores);
+
+	//stress with more threads than cores too, preemption in the middle of a steal is where races show up
+	std::vector<uint32_t> stressThreadCounts = threadCounts;
+	stressThreadCounts.push_back(cores * 2);
+
+	std::mt19937 random(1234);
+	bool correct = true;
+
+	for (uint32_t threads : stressThreadCounts) {
+		JobSystem jobs;
+		jobs.init(threads - 1);
+
+		bool passed = true;
+		for (int round = 0; round < rounds && passed; round++) {
+			passed = stressTree(jobs) && stressDependencies(jobs) && stressParallelFor(jobs, random) && stressExceptions(jobs);
+		}
+		correct = correct && passed;
+		std::cout << "stress " << threads << " threads, " << rounds << " rounds: " << (passed ? "passed" : "FAILED") << std::endl;
+
+		jobs.destroy();
+	}
+
+	if (!correct) {
+		return EXIT_FAILURE;
+	}
+
+	std::vector<float> values(1 << 20);
+	double singleThreaded = 0.0;
+
+	for (uint32_t threads : threadCounts) {
+		JobSystem jobs;
+		jobs.init(threads - 1);
+
+		double jobsPerMicrosecond = emptyJobThroughput(jobs, 1 << 20);
+		std::fill(values.begin(), values.end(), 1.0f);
+		double milliseconds = parallelForTime(jobs, values);
+		if (threads == 1) {
+			singleThreaded = milliseconds;
+		}
+
+		std::cout << threads << " threads: " << jobsPerMicrosecond << " empty jobs/us, parallelFor " << milliseconds << " ms, " << singleThreaded / milliseconds << "x" << std::endl;
+
+		jobs.destroy();
+	}
+
+	return EXIT_SUCCESS;
+}
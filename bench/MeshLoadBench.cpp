@@ -0,0 +1,132 @@
+//measures how fast mesh containers reach staging memory, CPU only so it runs without a GPU
+//usage: MeshLoadBench [file.mesh] [iterations >= 1]
+//without a file a synthetic grid of about 4M vertices is written to bench_grid.mesh first and deleted again on exit
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MeshFile.h"
+
+
+static MeshData createGrid(uint32_t size) {
+
+	MeshData mesh;
+	mesh.vertices.reserve(size_t(size) * size);
+	mesh.indices.reserve(size_t(size - 1) * (size - 1) * 6);
+
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			float u = x / float(size - 1);
+			float v = y / float(size - 1);
+			mesh.vertices.push_back({ { u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.0f }, { u, v, 1.0f }, { u, v } });
+		}
+	}
+
+	for (uint32_t y = 0; y + 1 < size; y++) {
+		for (uint32_t x = 0; x + 1 < size; x++) {
+			uint32_t corner = y * size + x;
+			mesh.indices.insert(mesh.indices.end(), { corner, corner + 1, corner + size + 1, corner + size + 1, corner + size, corner });
+		}
+	}
+
+	return mesh;
+}
+
+static double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+
+	std::string path = argc > 1 ? argv[1] : "bench_grid.mesh";
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+
+	//the median needs at least one sample
+	if (iterations < 1) {
+		std::cout << "usage: " << argv[0] << " [file.mesh] [iterations >= 1]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	//the grid is a few hundred MiB, nothing but this run uses it
+	bool generated = argc < 2;
+	if (generated) {
+		if (!writeMeshFile(path, createGrid(2048))) {
+			std::cout << "Failed to write " << path << std::endl;
+			std::remove(path.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	MeshFile probe;
+	if (!probe.open(path)) {
+		std::cout << "Failed to open mesh " << path << std::endl;
+		if (generated) {
+			std::remove(path.c_str());
+		}
+		return EXIT_FAILURE;
+	}
+	size_t payload = size_t(probe.stream(MeshStreamType::Vertex)->size + probe.stream(MeshStreamType::Index)->size);
+	std::cout << path << ": " << probe.header().vertexCount << " vertices, " << probe.header().indexCount << " indices, "
+		<< payload / (1024.0 * 1024.0) << " MiB of streams" << std::endl;
+	probe.close();
+
+	//stands in for the persistently mapped staging buffer
+	std::unique_ptr<uint8_t[]> staging(new uint8_t[payload]);
+
+	std::vector<double> streamedTimes;
+	std::vector<double> mappedTimes;
+
+	for (int i = 0; i < iterations; i++) {
+
+		//old path: read into vectors, then copy into staging
+		auto start = std::chrono::steady_clock::now();
+		{
+			std::ifstream file(path, std::ios::binary);
+			MeshFileHeader header;
+			file.read(reinterpret_cast<char*>(&header), sizeof(header));
+			std::vector<MeshStreamHeader> streams(header.streamCount);
+			file.read(reinterpret_cast<char*>(streams.data()), streams.size() * sizeof(MeshStreamHeader));
+
+			size_t offset = 0;
+			for (const MeshStreamHeader& stream : streams) {
+				std::vector<char> data(static_cast<size_t>(stream.size));
+				file.seekg(static_cast<std::streamoff>(stream.offset));
+				file.read(data.data(), data.size());
+				memcpy(staging.get() + offset, data.data(), data.size());
+				offset += data.size();
+			}
+		}
+		streamedTimes.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+		//new path: map the container and copy the streams straight into staging
+		start = std::chrono::steady_clock::now();
+		{
+			MeshFile mesh;
+			mesh.open(path);
+
+			const MeshStreamHeader* vertices = mesh.stream(MeshStreamType::Vertex);
+			const MeshStreamHeader* indices = mesh.stream(MeshStreamType::Index);
+			memcpy(staging.get(), mesh.streamData(*vertices), static_cast<size_t>(vertices->size));
+			memcpy(staging.get() + vertices->size, mesh.streamData(*indices), static_cast<size_t>(indices->size));
+		}
+		mappedTimes.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	double megabytes = payload / (1024.0 * 1024.0);
+	std::cout << "ifstream + vector: " << megabytes / median(streamedTimes) << " MiB/s (median of " << iterations << ")" << std::endl;
+	std::cout << "mmap -> staging:   " << megabytes / median(mappedTimes) << " MiB/s (median of " << iterations << ")" << std::endl;
+
+	if (generated) {
+		std::remove(path.c_str());
+	}
+	return EXIT_SUCCESS;
+}
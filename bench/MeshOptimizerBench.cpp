@@ -0,0 +1,129 @@
+//measures the mesh optimization stages with the FIFO vertex cache simulator, CPU only so it runs without a GPU
+//usage: MeshOptimizerBench [file.mesh]
+//without a file a grid is split into unshared triangles and shuffled, the worst case an importer can hand over
+//overdraw is rasterized along the three axes before and after the overdraw pass, the grid is wrapped into a bumpy sphere so views see it overlap itself
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+
+
+static MeshData createShuffledGrid(uint32_t size) {
+
+	MeshData grid;
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			float u = x / float(size - 1);
+			float v = y / float(size - 1);
+			float theta = u * 6.2831853f;
+			float phi = v * 3.1415927f;
+			float radius = 1.0f + 0.3f * std::sin(theta * 8.0f) * std::sin(phi * 8.0f);
+			float normal[3] = { std::sin(phi) * std::cos(theta), std::sin(phi) * std::sin(theta), std::cos(phi) };
+			grid.vertices.push_back({ { normal[0] * radius, normal[1] * radius, normal[2] * radius }, { normal[0], normal[1], normal[2] }, { u, v } });
+		}
+	}
+
+	std::vector<uint32_t> triangles;
+	for (uint32_t y = 0; y + 1 < size; y++) {
+		for (uint32_t x = 0; x + 1 < size; x++) {
+			uint32_t corner = y * size + x;
+			triangles.insert(triangles.end(), { corner, corner + 1, corner + size + 1, corner + size + 1, corner + size, corner });
+		}
+	}
+
+	std::vector<uint32_t> order(triangles.size() / 3);
+	for (uint32_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+	//every corner gets its own vertex copy, deduplication has to find the sharing again
+	MeshData mesh;
+	for (uint32_t triangle : order) {
+		for (int corner = 0; corner < 3; corner++) {
+			mesh.indices.push_back(uint32_t(mesh.vertices.size()));
+			mesh.vertices.push_back(grid.vertices[triangles[triangle * 3 + corner]]);
+		}
+	}
+
+	return mesh;
+}
+
+static void report(const char* stage, const MeshData& mesh, double milliseconds) {
+	VertexCacheStats stats = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+	std::cout << stage << ": " << mesh.vertices.size() << " vertices, ACMR " << stats.acmr << ", ATVR " << stats.atvr;
+	if (milliseconds >= 0.0) {
+		std::cout << " (" << milliseconds << " ms)";
+	}
+	std::cout << std::endl;
+}
+
+int main(int argc, char** argv) {
+
+	MeshData mesh;
+	if (argc > 1) {
+		MeshFile file;
+		if (!file.open(argv[1]) || file.header().vertexFormat != static_cast<uint32_t>(MeshVertexFormat::Float32)) {
+			std::cout << "Failed to open float mesh " << argv[1] << std::endl;
+			return EXIT_FAILURE;
+		}
+		const MeshStreamHeader* vertices = file.stream(MeshStreamType::Vertex);
+		const MeshStreamHeader* indices = file.stream(MeshStreamType::Index);
+		mesh.vertices.resize(file.header().vertexCount);
+		memcpy(mesh.vertices.data(), file.streamData(*vertices), static_cast<size_t>(vertices->size));
+
+		mesh.indices.resize(file.header().indexCount);
+		if (file.header().indexSize == sizeof(uint16_t)) {
+			const uint16_t* source = static_cast<const uint16_t*>(file.streamData(*indices));
+			mesh.indices.assign(source, source + file.header().indexCount);
+		}
+		else {
+			memcpy(mesh.indices.data(), file.streamData(*indices), static_cast<size_t>(indices->size));
+		}
+	}
+	else {
+		mesh = createShuffledGrid(512);
+	}
+
+	std::cout << mesh.indices.size() / 3 << " triangles" << std::endl;
+	report("input", mesh, -1.0);
+
+	auto start = std::chrono::steady_clock::now();
+	deduplicateVertices(mesh);
+	report("deduplicate", mesh, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	start = std::chrono::steady_clock::now();
+	optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	report("vertex cache", mesh, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	OverdrawStats overdrawBefore = analyzeOverdraw(mesh.indices, mesh.vertices);
+	start = std::chrono::steady_clock::now();
+	optimizeOverdraw(mesh.indices, mesh.vertices);
+	report("overdraw", mesh, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	OverdrawStats overdrawAfter = analyzeOverdraw(mesh.indices, mesh.vertices);
+	std::cout << "overdraw " << overdrawBefore.overdraw << " -> " << overdrawAfter.overdraw << " shaded per covered pixel" << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	optimizeVertexFetch(mesh);
+	report("vertex fetch", mesh, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	//first use order means every index is at most one past the highest index seen so far
+	uint32_t highest = 0;
+	bool linear = true;
+	for (uint32_t index : mesh.indices) {
+		linear = linear && index <= highest + 1;
+		highest = std::max(highest, index);
+	}
+	std::cout << "fetch order " << (linear ? "linear" : "not linear") << ", " << (mesh.vertices.size() <= 65535 ? 16 : 32) << " bit indices" << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,344 @@
+//renders a fixed number of headless frames with a fixed animation timestep and reports frame, submit and GPU time percentiles as JSON
+//usage: RendererBench [--frames N] [--warmup N] [--width W] [--height H] [--instances N] [--frames-in-flight 1-3] [--timestep seconds]
+//                     [--mesh file.mesh] [--cpu-culling | --gpu-culling] [--record-threads N] [--draw-mode instanced|push|ubo] [--texture file] [--mipmaps gpu|cpu|off]
+//                     [--bindless] [--bindless-texture file]... [--output result.json] [--baseline file.json | --baseline-if-exists file.json] [--threshold fraction]
+//with a baseline every metric that got slower by more than the threshold is flagged and the exit code is 1
+//a baseline recorded with a different config is not compared at all, the differences are listed and the exit code is 1
+//draws_per_ms is recorded draw commands over recording time, run --draw-mode push and ubo with the same instances to compare per draw data paths
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Renderer.h"
+
+
+//differences below this are timer noise no matter how large they are relative to the baseline
+static const double MIN_REGRESSION_MILLISECONDS = 0.05;
+
+//same nearest rank percentile as the GPU profiler
+static double percentile(std::vector<double> values, int percent) {
+	if (values.empty()) {
+		return 0.0;
+	}
+	std::sort(values.begin(), values.end());
+	return values[(values.size() - 1) * percent / 100];
+}
+
+static double mean(const std::vector<double>& values) {
+	double sum = 0.0;
+	for (double value : values) {
+		sum += value;
+	}
+	return values.empty() ? 0.0 : sum / values.size();
+}
+
+//mean, p50, p95 and p99 of one timing, in the order they are written
+static void addMetrics(std::vector<std::pair<std::string, double>>& metrics, const std::string& name, const std::vector<double>& values) {
+	metrics.push_back({ name + "_ms_mean", mean(values) });
+	metrics.push_back({ name + "_ms_p50", percentile(values, 50) });
+	metrics.push_back({ name + "_ms_p95", percentile(values, 95) });
+	metrics.push_back({ name + "_ms_p99", percentile(values, 99) });
+}
+
+//reads one object of a result file as the JSON text of each value, the harness writes it flat with numbers and strings
+//without escapes, so a scan for "name": value is enough
+static bool readObject(const std::string& text, const std::string& key, std::map<std::string, std::string>& values) {
+
+	size_t objectKey = text.find("\"" + key + "\"");
+	if (objectKey == std::string::npos) {
+		return false;
+	}
+	size_t position = text.find('{', objectKey);
+	size_t end = text.find('}', position);
+	if (position == std::string::npos || end == std::string::npos) {
+		return false;
+	}
+
+	while (true) {
+		size_t nameBegin = text.find('"', position);
+		if (nameBegin == std::string::npos || nameBegin > end) {
+			break;
+		}
+		size_t nameEnd = text.find('"', nameBegin + 1);
+		size_t valueBegin = text.find_first_not_of(" \t\r\n", text.find(':', nameEnd) + 1);
+		size_t valueEnd = text[valueBegin] == '"' ? text.find('"', valueBegin + 1) + 1 : text.find_first_of(",}\r\n", valueBegin);
+
+		values[text.substr(nameBegin + 1, nameEnd - nameBegin - 1)] = text.substr(valueBegin, valueEnd - valueBegin);
+		position = valueEnd;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+
+	Renderer app;
+	app.headless = true;
+	app.fixedTimestep = 1.0 / 60.0;
+	app.recordFrameTimes = true;
+	app.gpuProfile = true;
+	app.instanceCount = 10000;
+
+	uint32_t frames = 300;
+	uint32_t warmup = 30;
+	std::string output;
+	std::string baseline;
+	bool baselineRequired = false;
+	double threshold = 0.10;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--frames" && hasValue) {
+			frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--warmup" && hasValue) {
+			warmup = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--width" && hasValue) {
+			app.WIDTH = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--height" && hasValue) {
+			app.HEIGHT = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--instances" && hasValue) {
+			app.instanceCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--frames-in-flight" && hasValue) {
+			app.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--timestep" && hasValue) {
+			app.fixedTimestep = std::stod(argv[++i]);
+		}
+		else if (arg == "--mesh" && hasValue) {
+			app.meshPath = argv[++i];
+		}
+		else if (arg == "--cpu-culling") {
+			app.cpuCulling = true;
+		}
+		else if (arg == "--gpu-culling") {
+			app.gpuCulling = true;
+		}
+		else if (arg == "--record-threads" && hasValue) {
+			app.recordThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--texture" && hasValue) {
+			app.texturePath = argv[++i];
+		}
+		else if (arg == "--draw-mode" && hasValue) {
+			std::string mode = argv[++i];
+			if (mode == "instanced") {
+				app.drawMode = DrawMode::Instanced;
+			}
+			else if (mode == "push") {
+				app.drawMode = DrawMode::PushConstants;
+			}
+			else if (mode == "ubo") {
+				app.drawMode = DrawMode::UniformBuffers;
+			}
+			else {
+				std::cout << "unknown draw mode " << mode << ", expected instanced, push or ubo" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--bindless") {
+			app.bindless = true;
+		}
+		else if (arg == "--bindless-texture" && hasValue) {
+			app.bindless = true;
+			app.bindlessTexturePaths.push_back(argv[++i]);
+		}
+		else if (arg == "--mipmaps" && hasValue) {
+			std::string mode = argv[++i];
+			if (mode == "gpu") {
+				app.mipmapMode = MipmapMode::Gpu;
+			}
+			else if (mode == "cpu") {
+				app.mipmapMode = MipmapMode::Cpu;
+			}
+			else if (mode == "off") {
+				app.mipmapMode = MipmapMode::Off;
+			}
+			else {
+				std::cout << "unknown mipmap mode " << mode << ", expected gpu, cpu or off" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--output" && hasValue) {
+			output = argv[++i];
+		}
+		else if ((arg == "--baseline" || arg == "--baseline-if-exists") && hasValue) {
+			baselineRequired = arg == "--baseline";
+			baseline = argv[++i];
+		}
+		else if (arg == "--threshold" && hasValue) {
+			threshold = std::stod(argv[++i]);
+		}
+		else {
+			std::cout << "usage: " << argv[0] << " [--frames N] [--warmup N] [--width W] [--height H] [--instances N] [--frames-in-flight 1-3] [--timestep seconds]"
+				<< " [--mesh file.mesh] [--cpu-culling | --gpu-culling] [--record-threads N] [--draw-mode instanced|push|ubo] [--texture file] [--mipmaps gpu|cpu|off] [--bindless] [--bindless-texture file]... [--output result.json] [--baseline file.json | --baseline-if-exists file.json] [--threshold fraction]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	//warmup frames absorb pipeline creation and first use costs and are not reported
+	//GPU samples arrive framesInFlight frames late, the run collects the last ones after vkDeviceWaitIdle so the history holds exactly the measured frames
+	app.headlessFrames = warmup + frames;
+	app.profiler.setHistorySize(frames);
+
+	try {
+		app.run();
+	}
+	catch (const std::exception& e) {
+		std::cout << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	auto dropWarmup = [warmup](std::vector<double>& values) {
+		values.erase(values.begin(), values.begin() + std::min<size_t>(warmup, values.size()));
+	};
+	dropWarmup(app.frameMilliseconds);
+	dropWarmup(app.submitMilliseconds);
+	dropWarmup(app.recordMilliseconds);
+	app.recordedDraws.erase(app.recordedDraws.begin(), app.recordedDraws.begin() + std::min<size_t>(warmup, app.recordedDraws.size()));
+
+	std::vector<std::pair<std::string, double>> metrics;
+	addMetrics(metrics, "frame", app.frameMilliseconds);
+	addMetrics(metrics, "submit", app.submitMilliseconds);
+	addMetrics(metrics, "record", app.recordMilliseconds);
+
+	//higher is better, so it is reported but left out of the regression check
+	double recordedDraws = 0.0;
+	double recordMilliseconds = 0.0;
+	for (size_t i = 0; i < app.recordedDraws.size(); i++) {
+		recordedDraws += app.recordedDraws[i];
+		recordMilliseconds += app.recordMilliseconds[i];
+	}
+	metrics.push_back({ "draws_per_ms", recordMilliseconds > 0.0 ? recordedDraws / recordMilliseconds : 0.0 });
+	for (const GpuScopeStats& scope : app.profiler.getStats()) {
+		if (scope.name == "frame") {
+			metrics.push_back({ "gpu_ms_mean", scope.averageMilliseconds });
+			metrics.push_back({ "gpu_ms_p50", scope.p50Milliseconds });
+			metrics.push_back({ "gpu_ms_p95", scope.p95Milliseconds });
+			metrics.push_back({ "gpu_ms_p99", scope.p99Milliseconds });
+		}
+	}
+
+	//read after the run, GPU culling falls back to instanced draws and is turned off on devices without indirect count
+	const char* drawModeName = app.drawMode == DrawMode::PushConstants ? "push" : app.drawMode == DrawMode::UniformBuffers ? "ubo" : "instanced";
+	const char* cullingName = app.gpuCulling ? "gpu" : app.cpuCulling ? "cpu" : "none";
+	const char* mipmapName = app.mipmapMode == MipmapMode::Off ? "off" : app.mipmapMode == MipmapMode::Cpu ? "cpu" : "gpu";
+
+	std::string bindlessPaths;
+	for (const std::string& path : app.bindlessTexturePaths) {
+		bindlessPaths += (bindlessPaths.empty() ? "" : ";") + path;
+	}
+
+	std::stringstream timestep;
+	timestep << std::fixed << std::setprecision(4) << app.fixedTimestep;
+
+	//values as they appear in the JSON, a baseline is only comparable when all of them match
+	std::vector<std::pair<std::string, std::string>> config = {
+		{ "frames", std::to_string(frames) },
+		{ "warmup", std::to_string(warmup) },
+		{ "width", std::to_string(app.WIDTH) },
+		{ "height", std::to_string(app.HEIGHT) },
+		{ "instances", std::to_string(app.instanceCount) },
+		{ "framesInFlight", std::to_string(app.framesInFlight) },
+		{ "timestep", timestep.str() },
+		{ "texture", "\"" + app.texturePath + "\"" },
+		{ "mipLevels", std::to_string(app.textureMipLevels) },
+		{ "bindlessTextures", std::to_string(app.textureSlots.size()) },
+		{ "drawMode", std::string("\"") + drawModeName + "\"" },
+		{ "mesh", "\"" + app.meshPath + "\"" },
+		{ "culling", std::string("\"") + cullingName + "\"" },
+		{ "recordThreads", std::to_string(app.recordThreads) },
+		{ "mipmaps", std::string("\"") + mipmapName + "\"" },
+		{ "bindlessTexturePaths", "\"" + bindlessPaths + "\"" }
+	};
+
+	std::stringstream json;
+	json << std::fixed << std::setprecision(4);
+	json << "{\n  \"config\": {";
+	for (size_t i = 0; i < config.size(); i++) {
+		json << (i ? ", " : "") << "\"" << config[i].first << "\": " << config[i].second;
+	}
+	json << "},\n";
+	json << "  \"metrics\": {";
+	for (size_t i = 0; i < metrics.size(); i++) {
+		json << (i ? "," : "") << "\n    \"" << metrics[i].first << "\": " << metrics[i].second;
+	}
+	json << "\n  }\n}\n";
+
+	std::cout << json.str();
+	if (!output.empty()) {
+		std::ofstream file(output, std::ios::trunc);
+		file << json.str();
+	}
+
+	if (baseline.empty()) {
+		return EXIT_SUCCESS;
+	}
+
+	std::ifstream baselineFile(baseline);
+	std::stringstream baselineText;
+	baselineText << baselineFile.rdbuf();
+
+	std::map<std::string, std::string> baselineMetrics;
+	if (!baselineFile.is_open() || !readObject(baselineText.str(), "metrics", baselineMetrics)) {
+		if (baselineRequired) {
+			std::cout << "Failed to read baseline " << baseline << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "No baseline at " << baseline << ", copy " << (output.empty() ? "the result" : output) << " there to compare later runs against it" << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	//numbers from another configuration say nothing about this one, refuse instead of reporting them
+	std::map<std::string, std::string> baselineConfig;
+	readObject(baselineText.str(), "config", baselineConfig);
+
+	bool configMatches = true;
+	for (const auto& setting : config) {
+		auto found = baselineConfig.find(setting.first);
+		std::string before = found == baselineConfig.end() ? "missing" : found->second;
+		if (before != setting.second) {
+			if (configMatches) {
+				std::cout << "CONFIG MISMATCH: " << baseline << " was recorded with different settings, not comparing:" << std::endl;
+			}
+			std::cout << "  " << std::left << std::setw(16) << setting.first << std::right << before << " -> " << setting.second << std::endl;
+			configMatches = false;
+		}
+	}
+	if (!configMatches) {
+		std::cout << "Run with the baseline's settings or replace " << baseline << " with " << (output.empty() ? "this result" : output) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	//only slower counts
+	bool regressed = false;
+	std::cout << "Against " << baseline << " (threshold " << threshold * 100.0 << "%):" << std::endl;
+	for (const auto& metric : metrics) {
+		auto found = baselineMetrics.find(metric.first);
+		if (found == baselineMetrics.end() || metric.first.find("_ms_") == std::string::npos) {
+			continue;
+		}
+		double before = std::strtod(found->second.c_str(), nullptr);
+		double after = metric.second;
+		bool slower = after > before * (1.0 + threshold) && after - before > MIN_REGRESSION_MILLISECONDS;
+		regressed = regressed || slower;
+
+		std::cout << "  " << std::left << std::setw(16) << metric.first << std::right << std::fixed << std::setprecision(3)
+			<< before << " -> " << after << " ms" << (before > 0.0 ? "  (" + std::to_string(static_cast<int>((after / before - 1.0) * 100.0)) + "%)" : "")
+			<< (slower ? "  REGRESSION" : "") << std::endl;
+	}
+
+	return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+//startup texture load time against thread count, CPU only so it runs without a GPU
+//usage: TextureDecodeBench [count] [--cpu-mipmaps] [--cache dir] [files...]
+//without files the bundled PNG is loaded count times, which decodes the same amount of data as count distinct textures of its size
+//--cache empties dir, then times a cold start that fills the texture cache against a warm start that copies out of it
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Mipmaps.h"
+#include "TextureCache.h"
+#include "TextureDecoder.h"
+
+
+static double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+
+	uint32_t count = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 128;
+	bool cpuMipmaps = false;
+	std::string cacheDirectory;
+	std::vector<std::string> files;
+	for (int argument = 2; argument < argc; argument++) {
+		if (std::strcmp(argv[argument], "--cpu-mipmaps") == 0) {
+			cpuMipmaps = true;
+		}
+		else if (std::strcmp(argv[argument], "--cache") == 0 && argument + 1 < argc) {
+			cacheDirectory = argv[++argument];
+		}
+		else {
+			files.push_back(argv[argument]);
+		}
+	}
+	if (files.empty()) {
+		files.push_back("textures/mr_bean.png");
+	}
+	if (count == 0) {
+		std::cout << "usage: " << argv[0] << " [count] [--cpu-mipmaps] [--cache dir] [files...]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	//probed once like the loader does before any image exists, every texture gets its own aligned slice of one staging block
+	std::vector<TextureSource> sources(count);
+	std::vector<uint64_t> offsets(count);
+	uint64_t stagingSize = 0;
+	for (uint32_t index = 0; index < count; index++) {
+		const std::string& path = files[index % files.size()];
+		if (!probeTexture(path, sources[index])) {
+			std::cout << "Failed to load " << path << std::endl;
+			return EXIT_FAILURE;
+		}
+		planMipChain(sources[index], cpuMipmaps ? mipLevelCount(sources[index].width, sources[index].height) : 1, cpuMipmaps);
+		offsets[index] = stagingSize;
+		stagingSize = (stagingSize + sources[index].stagingSize + 15) & ~uint64_t(15);
+	}
+
+	//stands in for the persistently mapped staging buffer
+	std::unique_ptr<uint8_t[]> staging(new uint8_t[stagingSize]);
+	std::vector<uint8_t*> destinations;
+	for (uint64_t offset : offsets) {
+		destinations.push_back(staging.get() + offset);
+	}
+
+	std::cout << count << " textures from " << files.size() << " files, " << stagingSize / 1024 << " KiB staged"
+		<< (cpuMipmaps ? ", mip chains filtered on the CPU" : "") << std::endl;
+
+	//1, 2, 4, ... threads up to every hardware thread, the calling thread counts as one
+	uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(hardwareThreads);
+
+	double singleThreaded = 0.0;
+	for (uint32_t threads : threadCounts) {
+
+		JobSystem jobs;
+		jobs.init(threads - 1);
+
+		//the first round warms the file cache so every thread count reads from memory
+		std::vector<double> times;
+		for (int round = 0; round < 6; round++) {
+			auto start = std::chrono::steady_clock::now();
+			decodeTextures(jobs, sources, destinations);
+			if (round > 0) {
+				times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+		}
+		jobs.destroy();
+
+		double milliseconds = median(times);
+		if (threads == 1) {
+			singleThreaded = milliseconds;
+		}
+		std::cout << threads << " threads: " << milliseconds << " ms, " << count * 1000.0 / milliseconds << " textures/s, "
+			<< singleThreaded / milliseconds << "x" << std::endl;
+	}
+
+	if (cacheDirectory.empty()) {
+		return EXIT_SUCCESS;
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all(cacheDirectory, error);
+
+	JobSystem jobs;
+	jobs.init(hardwareThreads - 1);
+
+	//each start is timed from the lookup, hashing the sources is part of what the cache costs
+	for (const char* start : { "cold", "warm" }) {
+
+		TextureCache cache;
+		cache.init(cacheDirectory);
+
+		auto begin = std::chrono::steady_clock::now();
+		jobs.parallelFor(count, 16, [&](uint32_t first, uint32_t end) {
+			for (uint32_t index = first; index < end; index++) {
+				cache.lookup(sources[index]);
+			}
+		});
+		decodeTextures(jobs, sources, destinations, &cache);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+		std::cout << start << " cache, " << hardwareThreads << " threads: " << milliseconds << " ms, ";
+		cache.printStats();
+	}
+	jobs.destroy();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+//compares decoding a PNG against mapping a block compressed container, CPU only so it runs without a GPU
+//usage: TextureLoadBench [file.png] [iterations]
+//the containers are converted from the PNG first and written next to the working directory as bench_texture.*
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "Mipmaps.h"
+#include "TextureFile.h"
+
+
+static double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+
+	std::string path = argc > 1 ? argv[1] : "textures/mr_bean.png";
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels) {
+		std::cout << "Failed to load " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<uint64_t> levelOffsets;
+	std::vector<uint8_t> chain = buildMipChain(pixels, width, height, true, levelOffsets);
+	stbi_image_free(pixels);
+
+	//stands in for the persistently mapped staging buffer
+	std::unique_ptr<uint8_t[]> staging(new uint8_t[chain.size()]);
+
+	//old path: decode and filter the chain on every launch
+	std::vector<double> decodeTimes;
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		stbi_uc* decoded = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		std::vector<uint64_t> offsets;
+		std::vector<uint8_t> levels = buildMipChain(decoded, width, height, true, offsets);
+		memcpy(staging.get(), levels.data(), levels.size());
+		stbi_image_free(decoded);
+		decodeTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	std::cout << path << ": " << width << "x" << height << ", " << levelOffsets.size() << " levels" << std::endl;
+	std::cout << "PNG decode + mips -> staging: " << median(decodeTimes) << " ms, " << chain.size() / 1024 << " KiB in VRAM" << std::endl;
+
+	for (TextureFormat format : { TextureFormat::RGBA8Srgb, TextureFormat::BC1Srgb, TextureFormat::BC3Srgb, TextureFormat::BC7Srgb }) {
+
+		const TextureFormatInfo* info = findTextureFormat(format);
+
+		auto start = std::chrono::steady_clock::now();
+		TextureData texture;
+		texture.format = format;
+		texture.width = static_cast<uint32_t>(width);
+		texture.height = static_cast<uint32_t>(height);
+		for (uint32_t level = 0; level < levelOffsets.size(); level++) {
+			texture.levels.push_back(compressImage(format, chain.data() + levelOffsets[level], std::max(1, width >> level), std::max(1, height >> level)));
+		}
+		double encodeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::string containerPath = "bench_texture.ktx2";
+		if (!writeKtx2File(containerPath, texture)) {
+			std::cout << "Failed to write " << containerPath << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		//new path: map the container and copy every level straight into staging
+		std::vector<double> loadTimes;
+		uint64_t bytes = 0;
+		for (int i = 0; i < iterations; i++) {
+			start = std::chrono::steady_clock::now();
+			TextureFile file;
+			if (!file.open(containerPath)) {
+				std::cout << "Failed to open " << containerPath << std::endl;
+				return EXIT_FAILURE;
+			}
+			bytes = 0;
+			for (uint32_t level = 0; level < file.levelCount(); level++) {
+				memcpy(staging.get() + bytes, file.levelData(level), static_cast<size_t>(file.levelSize(level)));
+				bytes += file.levelSize(level);
+			}
+			loadTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		std::cout << info->name << " KTX2 map -> staging: " << median(loadTimes) << " ms, " << bytes / 1024 << " KiB in VRAM ("
+			<< double(chain.size()) / bytes << "x smaller), offline encode " << encodeMilliseconds << " ms" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+//compares the float vertex layout with the packed layout on a large mesh, CPU only
+//usage: VertexFormatBench [file.mesh] [iterations]
+//reports memory footprint, quantization error and how fast each layout streams through a fetch and decode loop
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MeshFile.h"
+
+
+static MeshData createGrid(uint32_t size) {
+
+	MeshData mesh;
+	mesh.vertices.reserve(size_t(size) * size);
+
+	//a wavy surface so every axis carries real range
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			float u = x / float(size - 1);
+			float v = y / float(size - 1);
+			float height = 0.25f * std::sin(u * 20.0f) * std::cos(v * 20.0f);
+			mesh.vertices.push_back({ { u * 100.0f - 50.0f, v * 100.0f - 50.0f, height }, { u, v, 1.0f - u }, { u * 4.0f, v * 4.0f } });
+		}
+	}
+
+	return mesh;
+}
+
+static double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+
+	MeshData mesh;
+	if (argc > 1) {
+		MeshFile file;
+		if (!file.open(argv[1]) || file.header().vertexFormat != static_cast<uint32_t>(MeshVertexFormat::Float32)) {
+			std::cout << "Failed to open float mesh " << argv[1] << std::endl;
+			return EXIT_FAILURE;
+		}
+		const MeshStreamHeader* vertices = file.stream(MeshStreamType::Vertex);
+		mesh.vertices.resize(file.header().vertexCount);
+		memcpy(mesh.vertices.data(), file.streamData(*vertices), static_cast<size_t>(vertices->size));
+	}
+	else {
+		mesh = createGrid(2048);
+	}
+
+	float boundsMin[3];
+	float boundsMax[3];
+	computeMeshBounds(mesh, boundsMin, boundsMax);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<PackedMeshVertex> packed = packMeshVertices(mesh, boundsMin, boundsMax);
+	double packSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	float scale[3];
+	for (int axis = 0; axis < 3; axis++) {
+		scale[axis] = (boundsMax[axis] - boundsMin[axis]) / 65535.0f;
+	}
+
+	//worst error against the float source, positions relative to the largest extent
+	double maxPositionError = 0.0;
+	double maxTextureError = 0.0;
+	double extent = std::max({ boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] });
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			double decoded = packed[i].pos[axis] * double(scale[axis]) + boundsMin[axis];
+			maxPositionError = std::max(maxPositionError, std::abs(decoded - mesh.vertices[i].pos[axis]));
+		}
+		for (int axis = 0; axis < 2; axis++) {
+			maxTextureError = std::max(maxTextureError, double(std::abs(halfToFloat(packed[i].texture[axis]) - mesh.vertices[i].texture[axis])));
+		}
+	}
+
+	//decode every vertex the way the input assembler and vertex shader would and keep a checksum so nothing is optimized out
+	std::vector<double> floatTimes;
+	std::vector<double> packedTimes;
+	double checksum = 0.0;
+
+	for (int i = 0; i < iterations; i++) {
+		start = std::chrono::steady_clock::now();
+		float sum = 0.0f;
+		for (const MeshVertex& vertex : mesh.vertices) {
+			sum += vertex.pos[0] + vertex.pos[1] + vertex.pos[2] + vertex.color[0] + vertex.texture[0];
+		}
+		floatTimes.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		checksum += sum;
+
+		start = std::chrono::steady_clock::now();
+		sum = 0.0f;
+		for (const PackedMeshVertex& vertex : packed) {
+			sum += vertex.pos[0] * scale[0] + boundsMin[0] + vertex.pos[1] * scale[1] + boundsMin[1] + vertex.pos[2] * scale[2] + boundsMin[2] +
+				vertex.color[0] * (1.0f / 255.0f) + halfToFloat(vertex.texture[0]);
+		}
+		packedTimes.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		checksum += sum;
+	}
+
+	double floatMegabytes = mesh.vertices.size() * sizeof(MeshVertex) / (1024.0 * 1024.0);
+	double packedMegabytes = packed.size() * sizeof(PackedMeshVertex) / (1024.0 * 1024.0);
+	double vertexMillions = mesh.vertices.size() / 1e6;
+
+	std::cout << mesh.vertices.size() << " vertices, packed in " << packSeconds * 1000.0 << " ms" << std::endl;
+	std::cout << "float:  " << sizeof(MeshVertex) << " B/vertex, " << floatMegabytes << " MiB, " << vertexMillions / median(floatTimes) << " Mvertices/s" << std::endl;
+	std::cout << "packed: " << sizeof(PackedMeshVertex) << " B/vertex, " << packedMegabytes << " MiB, " << vertexMillions / median(packedTimes) << " Mvertices/s" << std::endl;
+	std::cout << "max position error " << maxPositionError << " (" << maxPositionError / extent * 100.0 << "% of extent), max uv error " << maxTextureError << std::endl;
+	std::cout << "checksum " << checksum << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -1,10 +1,145 @@
 #pragma once
 #include "Renderer.h"
 
-int main() {
+int main(int argc, char** argv) {
 
     Renderer app;
 
+    std::string usage = std::string("usage: ") + argv[0] + " [--headless] [--frames N] [--output file.ppm] [--pipeline-cache file | --no-pipeline-cache] [--mesh file.mesh] [--instances N] [--gpu-culling | --cpu-culling] [--record-threads N] [--draw-mode instanced|push|ubo] [--record-scaling] [--job-workers N] [--frames-in-flight 1-3] [--present-mode fifo|fifo-relaxed|mailbox|immediate] [--fps N] [--gpu-profile] [--trace file.json] [--texture file.(ktx2|dds|png)] [--texture-cache dir | --no-texture-cache] [--bindless] [--bindless-texture file]... [--mipmaps gpu|cpu|off]";
+
+    //command line options, std::stoul and std::stod throw on values that are not numbers
+    int i = 1;
+    try {
+        for (; i < argc; i++) {
+            std::string arg = argv[i];
+
+            if (arg == "--headless") {
+                app.headless = true;
+            }
+            else if (arg == "--frames" && i + 1 < argc) {
+                app.headlessFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--output" && i + 1 < argc) {
+                app.headlessOutput = argv[++i];
+            }
+            else if (arg == "--pipeline-cache" && i + 1 < argc) {
+                app.pipelineCachePath = argv[++i];
+            }
+            else if (arg == "--no-pipeline-cache") {
+                app.usePipelineCache = false;
+            }
+            else if (arg == "--mesh" && i + 1 < argc) {
+                app.meshPath = argv[++i];
+            }
+            else if (arg == "--instances" && i + 1 < argc) {
+                app.instanceCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--gpu-culling") {
+                app.gpuCulling = true;
+            }
+            else if (arg == "--cpu-culling") {
+                app.cpuCulling = true;
+            }
+            else if (arg == "--record-threads" && i + 1 < argc) {
+                app.recordThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--draw-mode" && i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "instanced") {
+                    app.drawMode = DrawMode::Instanced;
+                }
+                else if (mode == "push") {
+                    app.drawMode = DrawMode::PushConstants;
+                }
+                else if (mode == "ubo") {
+                    app.drawMode = DrawMode::UniformBuffers;
+                }
+                else {
+                    std::cout << "unknown draw mode " << mode << ", expected instanced, push or ubo" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            else if (arg == "--record-scaling") {
+                app.recordScaling = true;
+            }
+            else if (arg == "--job-workers" && i + 1 < argc) {
+                app.jobWorkers = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--frames-in-flight" && i + 1 < argc) {
+                app.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--present-mode" && i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "fifo") {
+                    app.requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+                }
+                else if (mode == "fifo-relaxed") {
+                    app.requestedPresentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+                }
+                else if (mode == "mailbox") {
+                    app.requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+                }
+                else if (mode == "immediate") {
+                    app.requestedPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+                }
+                else {
+                    std::cout << "unknown present mode " << mode << ", expected fifo, fifo-relaxed, mailbox or immediate" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            else if (arg == "--fps" && i + 1 < argc) {
+                app.frameLimiter.setTargetFps(std::stod(argv[++i]));
+            }
+            else if (arg == "--gpu-profile") {
+                app.gpuProfile = true;
+            }
+            else if (arg == "--trace" && i + 1 < argc) {
+                app.traceOutput = argv[++i];
+            }
+            else if (arg == "--texture" && i + 1 < argc) {
+                app.texturePath = argv[++i];
+            }
+            else if (arg == "--texture-cache" && i + 1 < argc) {
+                app.textureCachePath = argv[++i];
+            }
+            else if (arg == "--no-texture-cache") {
+                app.useTextureCache = false;
+            }
+            else if (arg == "--bindless") {
+                app.bindless = true;
+            }
+            else if (arg == "--bindless-texture" && i + 1 < argc) {
+                app.bindless = true;
+                app.bindlessTexturePaths.push_back(argv[++i]);
+            }
+            else if (arg == "--mipmaps" && i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "gpu") {
+                    app.mipmapMode = MipmapMode::Gpu;
+                }
+                else if (mode == "cpu") {
+                    app.mipmapMode = MipmapMode::Cpu;
+                }
+                else if (mode == "off") {
+                    app.mipmapMode = MipmapMode::Off;
+                }
+                else {
+                    std::cout << "unknown mipmap mode " << mode << ", expected gpu, cpu or off" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            else {
+                std::cout << usage << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        std::cout << "invalid value " << argv[i] << " for " << argv[i - 1] << std::endl;
+        std::cout << usage << std::endl;
+        return EXIT_FAILURE;
+    }
+
     try {
         app.run();
     }
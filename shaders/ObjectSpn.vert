@@ -1,19 +1,55 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObj::UniformBufferObject {
-    mat4 model;
+//per frame, the object transform comes with the draw
+layout(binding = 0) uniform UniformBufferObject {
     mat4 view;
     mat4 proj;
+} frame;
+
+//packed positions arrive as 0..1 across the mesh bounds, float positions use scale 1 and offset 0
+struct DrawData {
+    mat4 model;
+    vec4 scale;
+    vec4 offset;
+    vec4 color;
+    uint textureIndex;
+};
+
+layout(push_constant) uniform DrawConstants {
+    DrawData data;
+} draw;
+
+//only read when every object has a uniform buffer slot of its own
+layout(binding = 2) uniform ObjectUniforms {
+    DrawData data;
 } object;
 
+//0 instanced, the instance attributes go on top of the pushed transform
+//1 one draw per object with its data pushed, 2 one draw per object with its data in a uniform buffer
+layout(constant_id = 0) const uint DRAW_SOURCE = 0;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec3 textureCoordinates;
+layout(location = 2) in vec2 textureCoordinates;
+
+//per instance, advanced once per instance by binding 1
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in vec4 instanceColor;
 
 layout(location = 0) out vec3 fragColor;
-layout(location = 1) out vec2 fragTextureCoordinates
+layout(location = 1) out vec2 fragTextureCoordinates;
+
 void main() {
-    gl_Position = object.proj * object.view * object.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    DrawData data = DRAW_SOURCE == 2 ? object.data : draw.data;
+    mat4 model = data.model;
+    vec3 color = data.color.rgb;
+    if (DRAW_SOURCE == 0) {
+        model = model * instanceModel;
+        color = instanceColor.rgb;
+    }
+
+    vec3 position = inPosition * data.scale.xyz + data.offset.xyz;
+    gl_Position = frame.proj * frame.view * model * vec4(position, 1.0);
+    fragColor = inColor * color;
     fragTextureCoordinates = textureCoordinates;
 }
\ No newline at end of file
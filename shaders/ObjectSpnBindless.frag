@@ -0,0 +1,16 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 textureCoordinates;
+layout(location = 2) flat in uint fragTexture;
+
+//every registered texture in one array, sized when the set is allocated
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    //instances of one draw may pick different textures, so the index is not uniform across the subgroup
+    outColor = texture(textures[nonuniformEXT(fragTexture)], textureCoordinates * 4);
+}
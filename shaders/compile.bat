@@ -1,3 +1,6 @@
 C:/VulkanSDK/1.3.275.0/Bin/glslc.exe ObjectSpn.vert -o vert.spv
 C:/VulkanSDK/1.3.275.0/Bin/glslc.exe ObjectSpn.frag -o frag.spv
+C:/VulkanSDK/1.3.275.0/Bin/glslc.exe Cull.comp -o cull.spv
+C:/VulkanSDK/1.3.275.0/Bin/glslc.exe ObjectSpnBindless.vert -o vert_bindless.spv
+C:/VulkanSDK/1.3.275.0/Bin/glslc.exe ObjectSpnBindless.frag -o frag_bindless.spv
 pause
\ No newline at end of file
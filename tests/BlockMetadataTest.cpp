@@ -0,0 +1,178 @@
+//CPU only checks of the linear, pool and buddy placement behind DeviceMemoryAllocator, no Vulkan device or headers required
+//usage: BlockMetadataTest, prints every failed check and exits with 1 when there was one
+
+#include <cstdlib>
+#include <iostream>
+
+#include "BlockMetadata.h"
+
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+			failures++; \
+		} \
+	} while (0)
+
+//true when the last byte of the first range and the first byte of the second fall on the same granularity page
+static bool sharePage(uint64_t firstOffset, uint64_t firstSize, uint64_t secondOffset, uint64_t granularity) {
+	return (firstOffset + firstSize - 1) / granularity == secondOffset / granularity;
+}
+
+static void testLinear() {
+
+	uint64_t offset = 0;
+
+	//alignment
+	LinearBlockMetadata aligned(4096, 1);
+	CHECK(aligned.allocate(100, 1, ResourceType::Linear, offset) && offset == 0);
+	CHECK(aligned.allocate(10, 256, ResourceType::Linear, offset) && offset == 256);
+	CHECK(aligned.allocate(1, 64, ResourceType::Linear, offset) && offset == 320);
+
+	//a linear and an optimal resource never share a page, resources of one type may
+	LinearBlockMetadata granular(8192, 1024);
+	uint64_t bufferOffset = 0;
+	CHECK(granular.allocate(100, 16, ResourceType::Linear, bufferOffset) && bufferOffset == 0);
+	CHECK(granular.allocate(100, 16, ResourceType::Linear, offset) && offset == 112);
+	uint64_t imageOffset = 0;
+	CHECK(granular.allocate(100, 16, ResourceType::Optimal, imageOffset) && imageOffset == 1024);
+	CHECK(!sharePage(offset, 100, imageOffset, 1024));
+	CHECK(granular.allocate(100, 16, ResourceType::Optimal, offset) && offset == 1136);
+
+	//exhaustion, and space only comes back once everything above it is freed
+	LinearBlockMetadata full(4096, 1);
+	uint64_t first = 0;
+	uint64_t second = 0;
+	CHECK(full.allocate(2048, 1, ResourceType::Linear, first));
+	CHECK(full.allocate(2048, 1, ResourceType::Linear, second));
+	CHECK(!full.allocate(1, 1, ResourceType::Linear, offset));
+	CHECK(full.largestFreeRange() == 0);
+	full.free(first);
+	CHECK(full.largestFreeRange() == 0);
+	CHECK(full.allocationCount == 1 && full.used == 2048);
+	full.free(second);
+	CHECK(full.empty() && full.used == 0 && full.largestFreeRange() == 4096);
+	CHECK(full.allocate(4096, 1, ResourceType::Linear, offset) && offset == 0);
+}
+
+static void testPool() {
+
+	uint64_t offset = 0;
+
+	//four slots handed out lowest first
+	PoolBlockMetadata pool(1024, 1, 256);
+	for (uint64_t slot = 0; slot < 4; slot++) {
+		CHECK(pool.allocate(200, 16, ResourceType::Linear, offset) && offset == slot * 256);
+	}
+
+	//exhaustion
+	CHECK(!pool.allocate(1, 1, ResourceType::Linear, offset));
+	CHECK(pool.largestFreeRange() == 0);
+
+	//a freed slot is the next one reused
+	pool.free(512);
+	CHECK(pool.allocationCount == 3 && pool.used == 768);
+	CHECK(pool.largestFreeRange() == 256);
+	CHECK(pool.allocate(256, 256, ResourceType::Optimal, offset) && offset == 512);
+
+	//requests bigger than a slot or aligned beyond it are refused
+	PoolBlockMetadata strict(1024, 1, 256);
+	CHECK(!strict.allocate(257, 1, ResourceType::Linear, offset));
+	CHECK(!strict.allocate(16, 512, ResourceType::Linear, offset));
+	CHECK(strict.empty());
+}
+
+static void testBuddy() {
+
+	uint64_t offset = 0;
+
+	//split: the first 256 bytes split the block down and leave one free buddy per level
+	BuddyBlockMetadata buddy(4096, 1, 256);
+	uint64_t small = 0;
+	CHECK(buddy.allocate(256, 1, ResourceType::Linear, small) && small == 0);
+	CHECK(buddy.largestFreeRange() == 2048);
+	uint64_t medium = 0;
+	CHECK(buddy.allocate(1000, 1, ResourceType::Linear, medium) && medium == 1024);
+	CHECK(buddy.used == 256 + 1024);
+
+	//merge: freeing both returns the whole block in one piece
+	buddy.free(small);
+	buddy.free(medium);
+	CHECK(buddy.empty() && buddy.used == 0);
+	CHECK(buddy.largestFreeRange() == 4096);
+	CHECK(buddy.allocate(4096, 1, ResourceType::Linear, offset) && offset == 0);
+	buddy.free(0);
+
+	//alignment beyond the size picks a node aligned to it
+	CHECK(buddy.allocate(100, 1024, ResourceType::Linear, offset) && offset % 1024 == 0);
+	CHECK(buddy.allocate(100, 1024, ResourceType::Linear, offset) && offset % 1024 == 0 && offset != 0);
+
+	//nodes are never smaller than the granularity, so neighbours of different types never share a page
+	BuddyBlockMetadata granular(8192, 1024, 1024);
+	uint64_t bufferOffset = 0;
+	uint64_t imageOffset = 0;
+	CHECK(granular.allocate(100, 16, ResourceType::Linear, bufferOffset));
+	CHECK(granular.allocate(100, 16, ResourceType::Optimal, imageOffset));
+	CHECK(!sharePage(bufferOffset, 100, imageOffset, 1024) && !sharePage(imageOffset, 100, bufferOffset, 1024));
+
+	//exhaustion
+	BuddyBlockMetadata full(1024, 1, 256);
+	CHECK(full.allocate(1024, 1, ResourceType::Linear, offset));
+	CHECK(!full.allocate(1, 1, ResourceType::Linear, offset));
+	CHECK(!full.allocate(2048, 1, ResourceType::Linear, offset));
+}
+
+static void testFragmentation() {
+
+	uint64_t offset = 0;
+
+	//nothing free counts as unfragmented
+	BuddyBlockMetadata buddy(4096, 1, 256);
+	CHECK(buddy.allocate(4096, 1, ResourceType::Linear, offset));
+	CHECK(blockFragmentation({ &buddy }) == 0.0f);
+	buddy.free(0);
+	CHECK(blockFragmentation({ &buddy }) == 0.0f);
+
+	//two free quarters that are not buddies of each other: 2048 bytes free, 1024 in one piece
+	for (int i = 0; i < 4; i++) {
+		CHECK(buddy.allocate(1024, 1, ResourceType::Linear, offset) && offset == uint64_t(i) * 1024);
+	}
+	buddy.free(0);
+	buddy.free(2048);
+	CHECK(blockFragmentation({ &buddy }) == 0.5f);
+
+	//freeing the buddies merges everything back
+	buddy.free(1024);
+	buddy.free(3072);
+	CHECK(blockFragmentation({ &buddy }) == 0.0f);
+
+	//summed over blocks: a full pool adds nothing, an empty linear block adds contiguous space
+	PoolBlockMetadata pool(512, 1, 256);
+	CHECK(pool.allocate(256, 1, ResourceType::Linear, offset));
+	CHECK(pool.allocate(256, 1, ResourceType::Linear, offset));
+	LinearBlockMetadata linear(2048, 1);
+	for (int i = 0; i < 4; i++) {
+		CHECK(buddy.allocate(1024, 1, ResourceType::Linear, offset));
+	}
+	buddy.free(0);
+	buddy.free(2048);
+	CHECK(blockFragmentation({ &buddy, &pool, &linear }) == 1.0f - 3072.0f / 4096.0f);
+}
+
+int main() {
+
+	testLinear();
+	testPool();
+	testBuddy();
+	testFragmentation();
+
+	if (failures > 0) {
+		std::cout << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "All block metadata checks passed" << std::endl;
+	return EXIT_SUCCESS;
+}
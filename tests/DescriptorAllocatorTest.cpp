@@ -0,0 +1,160 @@
+//checks that DescriptorAllocator chains grow, keep their pools across frames and cache persistent sets, on any Vulkan 1.1 device
+//usage: DescriptorAllocatorTest, prints every failed check and exits with 1 when there was one, lavapipe is enough
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include "DescriptorAllocator.h"
+
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+			failures++; \
+		} \
+	} while (0)
+
+static void allocateSets(DescriptorAllocator& descriptors, const DescriptorLayout& layout, const std::vector<DescriptorInfo>& contents, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		CHECK(descriptors.allocateFrame(layout, contents) != VK_NULL_HANDLE);
+	}
+}
+
+//pools start at two sets, so a handful of sets is enough to make a chain grow
+static void testChains(VkDevice device, VkBuffer buffer) {
+
+	DescriptorAllocator descriptors;
+	descriptors.init(device, 2, 2);
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	DescriptorLayout layout = descriptors.createLayout({ binding });
+	std::vector<DescriptorInfo> contents = { bufferDescriptor(buffer, 0, VK_WHOLE_SIZE) };
+
+	//7 sets fill pools of 2 and 4 sets and spill into a third of 8
+	descriptors.beginFrame(0);
+	allocateSets(descriptors, layout, contents, 7);
+	CHECK(descriptors.getStats().poolCount == 3);
+	CHECK(descriptors.getStats().frameAllocations == 7);
+
+	//the other frame's chain starts small again, 3 sets need pools of 2 and 4 rather than one of 16
+	descriptors.beginFrame(1);
+	allocateSets(descriptors, layout, contents, 3);
+	CHECK(descriptors.getStats().poolCount == 5);
+
+	//resetting a frame reuses its pools
+	descriptors.beginFrame(0);
+	allocateSets(descriptors, layout, contents, 7);
+	CHECK(descriptors.getStats().poolCount == 5);
+	CHECK(descriptors.getStats().peakFrameAllocations == 7);
+
+	//persistent sets have a chain of their own and equal contents return the same set
+	VkDescriptorSet cached = descriptors.getCached(layout, contents);
+	CHECK(cached != VK_NULL_HANDLE);
+	CHECK(descriptors.getCached(layout, contents) == cached);
+	CHECK(descriptors.getStats().poolCount == 6);
+	CHECK(descriptors.getStats().cachedSets == 1 && descriptors.getStats().cacheHits == 1);
+
+	descriptors.destroyLayout(layout);
+	descriptors.destroy();
+}
+
+int main() {
+
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "DescriptorAllocatorTest";
+	appInfo.apiVersion = VK_API_VERSION_1_1;
+
+	VkInstanceCreateInfo instanceInfo{};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+
+	VkInstance instance;
+	if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+		std::cout << "Failed to create instance!" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	//any device will do, descriptor pools behave the same on all of them
+	uint32_t deviceCount = 1;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, &physicalDevice);
+	if (physicalDevice == VK_NULL_HANDLE) {
+		std::cout << "Failed to find a Vulkan device!" << std::endl;
+		vkDestroyInstance(instance, nullptr);
+		return EXIT_FAILURE;
+	}
+
+	float priority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo{};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = 0;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &priority;
+
+	VkDeviceCreateInfo deviceInfo{};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+
+	VkDevice device;
+	if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+		std::cout << "Failed to create logical device!" << std::endl;
+		vkDestroyInstance(instance, nullptr);
+		return EXIT_FAILURE;
+	}
+
+	//the sets point at one small storage buffer, it only has to be valid
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = 256;
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkBuffer buffer;
+	vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, buffer, &requirements);
+	uint32_t memoryType = 0;
+	while ((requirements.memoryTypeBits & (1u << memoryType)) == 0) {
+		memoryType++;
+	}
+
+	VkMemoryAllocateInfo memoryInfo{};
+	memoryInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryInfo.allocationSize = requirements.size;
+	memoryInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+	vkAllocateMemory(device, &memoryInfo, nullptr, &memory);
+	vkBindBufferMemory(device, buffer, memory, 0);
+
+	try {
+		testChains(device, buffer);
+	}
+	catch (const std::exception& e) {
+		std::cout << e.what() << std::endl;
+		failures++;
+	}
+
+	vkDestroyBuffer(device, buffer, nullptr);
+	vkFreeMemory(device, memory, nullptr);
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+
+	if (failures > 0) {
+		std::cout << failures << " checks failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "All descriptor allocator checks passed" << std::endl;
+	return EXIT_SUCCESS;
+}
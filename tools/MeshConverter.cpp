@@ -0,0 +1,287 @@
+//offline importer, converts OBJ and glTF assets into the binary mesh container the renderer maps at runtime
+//usage: MeshConverter [--packed] [--no-optimize] input.(obj|gltf|glb|mesh) output.mesh
+//OBJ needs tinyobjloader (MESH_CONVERTER_OBJ) and glTF needs cgltf (MESH_CONVERTER_GLTF), float .mesh input is always read and optimized again
+
+#ifdef MESH_CONVERTER_OBJ
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#endif
+
+#ifdef MESH_CONVERTER_GLTF
+#define CGLTF_IMPLEMENTATION
+#include <cgltf.h>
+#endif
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+
+
+static bool endsWith(const std::string& value, const std::string& suffix) {
+	return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+#ifdef MESH_CONVERTER_OBJ
+static bool importObj(const std::string& path, MeshData& mesh) {
+
+	tinyobj::ObjReaderConfig config;
+	config.triangulate = true;
+	config.vertex_color = true;
+
+	tinyobj::ObjReader reader;
+	if (!reader.ParseFromFile(path, config)) {
+		std::cout << reader.Error() << std::endl;
+		return false;
+	}
+
+	const tinyobj::attrib_t& attrib = reader.GetAttrib();
+
+	//obj indexes positions and texture coordinates separately, one output vertex per distinct pair
+	std::map<std::pair<int, int>, uint32_t> uniqueVertices;
+
+	for (const tinyobj::shape_t& shape : reader.GetShapes()) {
+		for (const tinyobj::index_t& index : shape.mesh.indices) {
+
+			auto key = std::make_pair(index.vertex_index, index.texcoord_index);
+			auto found = uniqueVertices.find(key);
+			if (found != uniqueVertices.end()) {
+				mesh.indices.push_back(found->second);
+				continue;
+			}
+
+			MeshVertex vertex{};
+			for (int axis = 0; axis < 3; axis++) {
+				vertex.pos[axis] = attrib.vertices[3 * index.vertex_index + axis];
+				vertex.color[axis] = attrib.colors.empty() ? 1.0f : attrib.colors[3 * index.vertex_index + axis];
+			}
+			if (index.texcoord_index >= 0) {
+				//obj puts the texture origin bottom left, vulkan samples from the top left
+				vertex.texture[0] = attrib.texcoords[2 * index.texcoord_index + 0];
+				vertex.texture[1] = 1.0f - attrib.texcoords[2 * index.texcoord_index + 1];
+			}
+
+			uint32_t newIndex = static_cast<uint32_t>(mesh.vertices.size());
+			uniqueVertices.emplace(key, newIndex);
+			mesh.vertices.push_back(vertex);
+			mesh.indices.push_back(newIndex);
+		}
+	}
+
+	return true;
+}
+#endif
+
+#ifdef MESH_CONVERTER_GLTF
+static void importGltfPrimitive(const cgltf_primitive& primitive, const float* world, MeshData& mesh) {
+
+	const cgltf_accessor* positions = nullptr;
+	const cgltf_accessor* colors = nullptr;
+	const cgltf_accessor* texcoords = nullptr;
+
+	for (cgltf_size i = 0; i < primitive.attributes_count; i++) {
+		const cgltf_attribute& attribute = primitive.attributes[i];
+		if (attribute.type == cgltf_attribute_type_position) {
+			positions = attribute.data;
+		}
+		else if (attribute.type == cgltf_attribute_type_color && attribute.index == 0) {
+			colors = attribute.data;
+		}
+		else if (attribute.type == cgltf_attribute_type_texcoord && attribute.index == 0) {
+			texcoords = attribute.data;
+		}
+	}
+
+	if (primitive.type != cgltf_primitive_type_triangles || positions == nullptr) {
+		return;
+	}
+
+	uint32_t baseVertex = static_cast<uint32_t>(mesh.vertices.size());
+
+	for (cgltf_size i = 0; i < positions->count; i++) {
+		MeshVertex vertex{};
+		float local[3] = {};
+		cgltf_accessor_read_float(positions, i, local, 3);
+
+		//bake the node transform, the container holds a single object space
+		for (int axis = 0; axis < 3; axis++) {
+			vertex.pos[axis] = world[axis] * local[0] + world[4 + axis] * local[1] + world[8 + axis] * local[2] + world[12 + axis];
+		}
+
+		float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		if (colors != nullptr) {
+			cgltf_accessor_read_float(colors, i, color, 4);
+		}
+		vertex.color[0] = color[0];
+		vertex.color[1] = color[1];
+		vertex.color[2] = color[2];
+
+		if (texcoords != nullptr) {
+			cgltf_accessor_read_float(texcoords, i, vertex.texture, 2);
+		}
+
+		mesh.vertices.push_back(vertex);
+	}
+
+	if (primitive.indices != nullptr) {
+		for (cgltf_size i = 0; i < primitive.indices->count; i++) {
+			mesh.indices.push_back(baseVertex + static_cast<uint32_t>(cgltf_accessor_read_index(primitive.indices, i)));
+		}
+	}
+	else {
+		for (cgltf_size i = 0; i < positions->count; i++) {
+			mesh.indices.push_back(baseVertex + static_cast<uint32_t>(i));
+		}
+	}
+}
+
+static bool importGltf(const std::string& path, MeshData& mesh) {
+
+	cgltf_options options{};
+	cgltf_data* data = nullptr;
+
+	if (cgltf_parse_file(&options, path.c_str(), &data) != cgltf_result_success) {
+		std::cout << "Failed to parse " << path << std::endl;
+		return false;
+	}
+	if (cgltf_load_buffers(&options, data, path.c_str()) != cgltf_result_success) {
+		std::cout << "Failed to load buffers of " << path << std::endl;
+		cgltf_free(data);
+		return false;
+	}
+
+	//walk nodes rather than meshes so instanced meshes land at every placement
+	for (cgltf_size i = 0; i < data->nodes_count; i++) {
+		const cgltf_node& node = data->nodes[i];
+		if (node.mesh == nullptr) {
+			continue;
+		}
+
+		float world[16];
+		cgltf_node_transform_world(&node, world);
+
+		for (cgltf_size j = 0; j < node.mesh->primitives_count; j++) {
+			importGltfPrimitive(node.mesh->primitives[j], world, mesh);
+		}
+	}
+
+	cgltf_free(data);
+	return true;
+}
+#endif
+
+//a float container from an earlier run, packed vertices are quantized and cannot be optimized again without loss
+static bool importMesh(const std::string& path, MeshData& mesh) {
+
+	MeshFile file;
+	if (!file.open(path) || file.header().vertexFormat != static_cast<uint32_t>(MeshVertexFormat::Float32)) {
+		return false;
+	}
+
+	const MeshStreamHeader* vertices = file.stream(MeshStreamType::Vertex);
+	const MeshStreamHeader* indices = file.stream(MeshStreamType::Index);
+	mesh.vertices.resize(file.header().vertexCount);
+	memcpy(mesh.vertices.data(), file.streamData(*vertices), static_cast<size_t>(vertices->size));
+
+	if (file.header().indexSize == sizeof(uint16_t)) {
+		const uint16_t* source = static_cast<const uint16_t*>(file.streamData(*indices));
+		mesh.indices.assign(source, source + file.header().indexCount);
+	}
+	else {
+		const uint32_t* source = static_cast<const uint32_t*>(file.streamData(*indices));
+		mesh.indices.assign(source, source + file.header().indexCount);
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+
+	//--packed stores quantized vertices, half the size of the float layout
+	//--no-optimize keeps the imported order, useful to compare against
+	bool packed = false;
+	bool optimize = true;
+	int argument = 1;
+	for (; argument < argc - 2; argument++) {
+		std::string flag = argv[argument];
+		if (flag == "--packed") {
+			packed = true;
+		}
+		else if (flag == "--no-optimize") {
+			optimize = false;
+		}
+		else {
+			break;
+		}
+	}
+
+	if (argc < 3 || argument != argc - 2) {
+		std::cout << "usage: " << argv[0] << " [--packed] [--no-optimize] input.(obj|gltf|glb|mesh) output.mesh" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string input = argv[argc - 2];
+	std::string output = argv[argc - 1];
+
+	auto start = std::chrono::steady_clock::now();
+
+	MeshData mesh;
+	bool imported = false;
+	if (endsWith(input, ".obj")) {
+#ifdef MESH_CONVERTER_OBJ
+		imported = importObj(input, mesh);
+#else
+		std::cout << "Built without tinyobjloader, OBJ input is not supported" << std::endl;
+		return EXIT_FAILURE;
+#endif
+	}
+	else if (endsWith(input, ".gltf") || endsWith(input, ".glb")) {
+#ifdef MESH_CONVERTER_GLTF
+		imported = importGltf(input, mesh);
+#else
+		std::cout << "Built without cgltf, glTF input is not supported" << std::endl;
+		return EXIT_FAILURE;
+#endif
+	}
+	else if (endsWith(input, ".mesh")) {
+		imported = importMesh(input, mesh);
+	}
+	else {
+		std::cout << "Unsupported input format " << input << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (!imported || mesh.indices.empty()) {
+		std::cout << "No triangles imported from " << input << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	//the post transform cache is modelled at 16 entries, older and mobile GPUs are at least that large
+	VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+	size_t importedVertices = mesh.vertices.size();
+
+	if (optimize) {
+		optimizeMesh(mesh);
+	}
+
+	VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+	std::cout << "vertices " << importedVertices << " -> " << mesh.vertices.size() << std::endl;
+	std::cout << "ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	std::cout << "index size " << (mesh.vertices.size() <= 65535 ? 16 : 32) << " bit" << std::endl;
+
+	if (!writeMeshFile(output, mesh, packed ? MeshVertexFormat::Packed : MeshVertexFormat::Float32)) {
+		std::cout << "Failed to write " << output << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << input << " -> " << output << ": " << mesh.vertices.size() << " vertices, " << mesh.indices.size() / 3 << " triangles in "
+		<< milliseconds << " ms" << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+//offline texture converter, turns PNGs (or anything else stb_image reads) into the KTX2 or DDS containers the renderer maps at runtime
+//usage: TextureConverter [--format rgba8|bc1|bc3|bc5|bc7] [--linear] [--no-mipmaps] input.png output.(ktx2|dds)
+//the container is picked by the output extension, ETC2 and ASTC containers have to come from external encoders
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "BlockCompression.h"
+#include "Mipmaps.h"
+#include "TextureFile.h"
+
+
+static bool endsWith(const std::string& value, const std::string& suffix) {
+	return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char** argv) {
+
+	//color textures default to BC7 in sRGB, --linear is for data such as roughness, BC5 (normal maps) is always linear
+	std::string formatName = "bc7";
+	bool srgb = true;
+	bool mipmaps = true;
+	int argument = 1;
+	for (; argument < argc - 2; argument++) {
+		std::string flag = argv[argument];
+		if (flag == "--format" && argument + 1 < argc - 2) {
+			formatName = argv[++argument];
+		}
+		else if (flag == "--linear") {
+			srgb = false;
+		}
+		else if (flag == "--no-mipmaps") {
+			mipmaps = false;
+		}
+		else {
+			break;
+		}
+	}
+
+	TextureFormat format = TextureFormat::Undefined;
+	if (formatName == "rgba8") {
+		format = srgb ? TextureFormat::RGBA8Srgb : TextureFormat::RGBA8Unorm;
+	}
+	else if (formatName == "bc1") {
+		format = srgb ? TextureFormat::BC1Srgb : TextureFormat::BC1Unorm;
+	}
+	else if (formatName == "bc3") {
+		format = srgb ? TextureFormat::BC3Srgb : TextureFormat::BC3Unorm;
+	}
+	else if (formatName == "bc5") {
+		format = TextureFormat::BC5Unorm;
+		srgb = false;
+	}
+	else if (formatName == "bc7") {
+		format = srgb ? TextureFormat::BC7Srgb : TextureFormat::BC7Unorm;
+	}
+
+	bool ktx2 = argc >= 3 && endsWith(argv[argc - 1], ".ktx2");
+	bool dds = argc >= 3 && endsWith(argv[argc - 1], ".dds");
+	if (argument != argc - 2 || format == TextureFormat::Undefined || (!ktx2 && !dds)) {
+		std::cout << "usage: " << argv[0] << " [--format rgba8|bc1|bc3|bc5|bc7] [--linear] [--no-mipmaps] input.png output.(ktx2|dds)" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string input = argv[argc - 2];
+	std::string output = argv[argc - 1];
+
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels) {
+		std::cout << "Failed to load " << input << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	TextureData texture;
+	texture.format = format;
+	texture.width = static_cast<uint32_t>(width);
+	texture.height = static_cast<uint32_t>(height);
+
+	//the chain is filtered uncompressed and every level compressed on its own, filtering compressed data would stack the errors
+	std::vector<uint64_t> levelOffsets = { 0 };
+	std::vector<uint8_t> chain(pixels, pixels + size_t(width) * height * 4);
+	if (mipmaps) {
+		chain = buildMipChain(pixels, texture.width, texture.height, srgb, levelOffsets);
+	}
+	stbi_image_free(pixels);
+
+	uint64_t uncompressedBytes = chain.size();
+	uint64_t compressedBytes = 0;
+	for (uint32_t level = 0; level < levelOffsets.size(); level++) {
+		uint32_t levelWidth = std::max(1u, texture.width >> level);
+		uint32_t levelHeight = std::max(1u, texture.height >> level);
+		texture.levels.push_back(compressImage(format, chain.data() + levelOffsets[level], levelWidth, levelHeight));
+		compressedBytes += texture.levels.back().size();
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	bool written = ktx2 ? writeKtx2File(output, texture) : writeDdsFile(output, texture);
+	if (!written) {
+		std::cout << "Failed to write " << output << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << input << " -> " << output << ": " << width << "x" << height << " " << findTextureFormat(format)->name << ", "
+		<< texture.levels.size() << " levels, " << compressedBytes / 1024 << " KiB (RGBA8 " << uncompressedBytes / 1024 << " KiB) in "
+		<< milliseconds << " ms" << std::endl;
+
+	return EXIT_SUCCESS;
+}